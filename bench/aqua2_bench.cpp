@@ -0,0 +1,162 @@
+/********************************************************
+ * aqua2_bench.cpp
+ *
+ * Benchmark scenarios of every I/O path: loopback sockets,
+ * ptys, shared memory and synthetic input devices. Run in
+ * each release and keep the JSON to compare.
+ *
+ * usage: aqua2_bench [--list] [--filter=text] [--json[=file]] [scale]
+ ********************************************************/
+#define AQUA2_BENCH_MAIN
+#include "harness.h"
+
+#include <thread>
+#include <unistd.h>
+
+#include "aqua2/serversocket.h"
+#include "aqua2/virtualserial.h"
+#include "aqua2/shmtransport.h"
+#include "aqua2/gamepad.h"
+#include "aqua2/eventbus.h"
+
+using namespace ssr::aqua2;
+
+class BenchException : public std::exception {
+private:
+  std::string msg_;
+public:
+  BenchException(const std::string& msg) : msg_(msg) {}
+  ~BenchException(void) throw() {}
+  const char* what() const throw() { return msg_.c_str(); }
+};
+
+/// read exactly size bytes
+static void readFully(Socket& socket, char* dst, const int size) {
+  for (int n = 0; n < size; ) {
+    Result<int> r = socket.tryRead(dst + n, size - n, 1.0);
+    if (!r) throw BenchException(std::string("socket read: ") + r.message());
+    n += r.value();
+  }
+}
+
+/// 64 bytes round trip through a loopback TCP connection and an echo thread
+static void tcpEcho(BenchState& state) {
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  Socket client("127.0.0.1", server.getPort());
+  Socket peer = server.accept(1000000);
+  std::thread echo([&peer]() {
+      char buf[256];
+      for (;;) {
+	if (peer.waitAvailable(1, 5.0) != 0) break;
+	Result<int> r = peer.tryRead(buf, sizeof(buf));
+	if (!r || r.value() == 0 || !peer.tryWrite(buf, r.value())) break;
+      }
+    });
+
+  char msg[64] = {0}, buf[64];
+  state.setBytesPerOp(sizeof(msg));
+  state.setUncountedCalls(); // send, recv, poll
+  try {
+    while (state.next()) {
+      if (!client.tryWrite(msg, sizeof(msg))) throw BenchException("socket write failed");
+      readFully(client, buf, sizeof(buf));
+    }
+  } catch (...) {
+    client.close();
+    echo.join();
+    throw;
+  }
+  client.close();
+  echo.join();
+  peer.close();
+}
+
+/// accept with no connection pending: the timeout path of a server loop
+static void acceptTimeout(BenchState& state) {
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  state.setUncountedCalls(); // poll
+  while (state.next()) {
+    if (server.tryAccept(0).error() != ETIMEDOUT) throw BenchException("accept did not time out");
+  }
+}
+
+/// 16 bytes written to the pty master and read from the slave SerialPort
+static void ptyWriteRead(BenchState& state) {
+  VirtualSerialPair pair;
+  uint8_t msg[16] = {0}, buf[16];
+  state.setBytesPerOp(sizeof(msg));
+  state.setUncountedCalls(); // ioctl(FIONREAD), poll
+  while (state.next()) {
+    if (pair.first().tryWrite(msg, sizeof(msg)).valueOr(0) != (int)sizeof(msg)) throw BenchException("pty write failed");
+    if (pair.second().tryRead(buf, sizeof(buf), 1.0).valueOr(0) != (int)sizeof(buf)) throw BenchException("pty read failed");
+  }
+}
+
+/// read from a pty with nothing received: the would-block path of a polling loop
+static void ptyReadEmpty(BenchState& state) {
+  VirtualSerialPair pair;
+  uint8_t buf[16];
+  while (state.next()) {
+    if (pair.first().tryRead(buf, sizeof(buf)).error() != EAGAIN) throw BenchException("pty read did not block");
+  }
+}
+
+/// 64 bytes message published and read through a shared memory ring
+static void shmPublishRead(BenchState& state) {
+  ShmPublisher publisher("", 64, 64);
+  ShmSubscriber subscriber(publisher.getFileDescriptor());
+  char msg[64] = {0}, buf[64];
+  state.setBytesPerOp(sizeof(msg));
+  while (state.next()) {
+    publisher.write(msg, sizeof(msg));
+    if (subscriber.read(buf, sizeof(buf)) != (int)sizeof(buf)) throw BenchException("shm read failed");
+  }
+}
+
+/// one joystick axis event through a pipe, as from /dev/input/js*
+static void gamepadUpdate(BenchState& state) {
+  int fds[2];
+  if (pipe(fds) != 0) throw BenchException("pipe failed");
+  GamePad pad(fds[0], 8, 16);
+  js_event e;
+  e.time = 0;
+  e.type = JS_EVENT_AXIS;
+  e.number = 0;
+  state.setBytesPerOp(sizeof(e));
+  bool ok = true;
+  while (ok && state.next()) {
+    e.time++;
+    e.value = (int16_t)(e.time & 0x7FFF);
+    ok = ::write(fds[1], &e, sizeof(e)) == (ssize_t)sizeof(e) && pad.update() == 1;
+  }
+  ::close(fds[1]);
+  if (!ok) throw BenchException("gamepad update failed");
+}
+
+/// user event posted to an EventBus and dispatched to its handler
+static void eventbusPost(BenchState& state) {
+  EventBus bus;
+  uint64_t received = 0;
+  bus.setHandler([&received](const InputEvent& event) { received += event.value; });
+  state.setUncountedCalls(); // epoll_wait
+  while (state.next()) {
+    bus.post(1, 1);
+    if (bus.spinOnce(0) != 1) throw BenchException("event was not dispatched");
+  }
+}
+
+int main(int argc, char* argv[]) {
+  BenchHarness harness;
+  harness.add("socket/tcp_echo_64", 20000, tcpEcho);
+  harness.add("socket/accept_timeout", 100000, acceptTimeout);
+  harness.add("serial/pty_write_read_16", 50000, ptyWriteRead);
+  harness.add("serial/pty_read_empty", 200000, ptyReadEmpty);
+  harness.add("shm/publish_read_64", 1000000, shmPublishRead);
+  harness.add("input/gamepad_update", 100000, gamepadUpdate);
+  harness.add("input/eventbus_post", 200000, eventbusPost);
+  return harness.main(argc, argv);
+}
@@ -0,0 +1,102 @@
+/********************************************************
+ * axisconditioner_bench.cpp
+ *
+ * AxisConditioner over all axes vs per-consumer scalar code,
+ * and allocations per GamePad::update() with conditioning.
+ *
+ * usage: axisconditioner_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+
+#include "aqua2/gamepad.h"
+
+using namespace ssr::aqua2;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* p = malloc(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/// What each consumer did by hand: deadzone, expo and EMA per axis.
+struct ScalarAxis {
+  float deadzone, expo, alpha, value;
+  float process(float x) {
+    if (std::fabs(x) < deadzone) x = 0.0f;
+    else x = (x > 0 ? x - deadzone : x + deadzone) / (1.0f - deadzone);
+    x = (1.0f - expo) * x + expo * x * x * x;
+    value += alpha * (x - value);
+    return value;
+  }
+};
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int n = AxisConditioner::MAX_AXES;
+  const int rounds = 200000 * scale;
+
+  float in[n], out[n];
+  AxisConditioner conditioner;
+  ScalarAxis scalar[n];
+  for (int i = 0; i < n; i++) {
+    in[i] = std::sin(i * 0.7f);
+    conditioner.setDeadzone(i, 0.05f);
+    conditioner.setExpo(i, 0.3f);
+    if (i % 2) conditioner.setEma(i, 0.2f);
+    else conditioner.setOneEuro(i, 1.0f, 0.3f);
+    scalar[i].deadzone = 0.05f;
+    scalar[i].expo = 0.3f;
+    scalar[i].alpha = 0.2f;
+    scalar[i].value = 0.0f;
+  }
+
+  float sum = 0.0f;
+  uint64_t start = GamePadEvent::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < n; i++) out[i] = scalar[i].process(in[i] + r * 1e-6f);
+    sum += out[r % n];
+  }
+  const double scalarNs = (double)(GamePadEvent::now() - start) / rounds;
+
+  start = GamePadEvent::now();
+  for (int r = 0; r < rounds; r++) {
+    in[r % n] += 1e-6f;
+    conditioner.process(in, out, n, 0.002f);
+    sum += out[r % n];
+  }
+  const double conditionerNs = (double)(GamePadEvent::now() - start) / rounds;
+
+  std::cout << n << " axes (" << sum << ")" << std::endl;
+  std::cout << "scalar deadzone+expo+EMA      " << scalarNs << " ns/update" << std::endl;
+  std::cout << "AxisConditioner (+calibration, one-euro) " << conditionerNs << " ns/update" << std::endl;
+
+#ifdef __linux__
+  int fds[2];
+  if (pipe(fds) != 0) return(1);
+  GamePad pad(fds[0], 8, 12);
+  pad.setAxisConditioner(&conditioner);
+  js_event e;
+  e.time = 0;
+  e.type = JS_EVENT_AXIS;
+  const size_t before = allocations;
+  const int updates = 10000 * scale;
+  for (int r = 0; r < updates; r++) {
+    e.number = r % 8;
+    e.value = (int16_t)(r % 30000);
+    if (write(fds[1], &e, sizeof(e)) != sizeof(e)) return(1);
+    pad.update();
+  }
+  std::cout << "allocations per GamePad::update() " << (double)(allocations - before) / updates << std::endl;
+  close(fds[1]);
+#endif
+  return(0);
+}
@@ -0,0 +1,111 @@
+/********************************************************
+ * codec_bench.cpp
+ *
+ * MessageCodec vs hand-written packing (memcpy and byte swaps).
+ *
+ * usage: codec_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "aqua2/codec.h"
+
+using namespace ssr::aqua2;
+
+struct ServoState {
+  uint8_t id;
+  int16_t position;
+  uint16_t velocity;
+  uint32_t timestamp;
+  float current;
+};
+
+typedef MessageCodec<ServoState,
+		     AQUA2_FIELD(ServoState, id),
+		     AQUA2_FIELD_BE(ServoState, position),
+		     AQUA2_FIELD_BE(ServoState, velocity),
+		     AQUA2_FIELD(ServoState, timestamp),
+		     AQUA2_FIELD(ServoState, current)> ServoStateCodec;
+
+static const size_t MESSAGE_SIZE = ServoStateCodec::SIZE;
+
+/// What the code looked like before MessageCodec (little endian host).
+__attribute__((noinline)) static void handEncode(const ServoState* src, uint8_t* dst, const size_t n) {
+  for (size_t i = 0; i < n; i++, dst += MESSAGE_SIZE) {
+    const uint16_t position = __builtin_bswap16((uint16_t)src[i].position);
+    const uint16_t velocity = __builtin_bswap16(src[i].velocity);
+    dst[0] = src[i].id;
+    memcpy(dst + 1, &position, 2);
+    memcpy(dst + 3, &velocity, 2);
+    memcpy(dst + 5, &src[i].timestamp, 4);
+    memcpy(dst + 9, &src[i].current, 4);
+  }
+}
+
+__attribute__((noinline)) static void handDecode(const uint8_t* src, ServoState* dst, const size_t n) {
+  for (size_t i = 0; i < n; i++, src += MESSAGE_SIZE) {
+    uint16_t position, velocity;
+    dst[i].id = src[0];
+    memcpy(&position, src + 1, 2);
+    memcpy(&velocity, src + 3, 2);
+    dst[i].position = (int16_t)__builtin_bswap16(position);
+    dst[i].velocity = __builtin_bswap16(velocity);
+    memcpy(&dst[i].timestamp, src + 5, 4);
+    memcpy(&dst[i].current, src + 9, 4);
+  }
+}
+
+__attribute__((noinline)) static void codecEncode(const ServoState* src, uint8_t* dst, const size_t n) {
+  for (size_t i = 0; i < n; i++, dst += MESSAGE_SIZE) ServoStateCodec::encode(src[i], dst);
+}
+
+__attribute__((noinline)) static void codecDecode(const uint8_t* src, ServoState* dst, const size_t n) {
+  for (size_t i = 0; i < n; i++, src += MESSAGE_SIZE) ServoStateCodec::decode(src, dst[i]);
+}
+
+template<typename F>
+static double measure(const int rounds, const size_t n, F f) {
+  double best = 1e9;
+  for (int trial = 0; trial < 5; trial++) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) f();
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ((double)rounds * n);
+    if (ns < best) best = ns;
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const size_t n = 1024;
+  const int rounds = 2000 * scale;
+
+  std::vector<ServoState> states(n), decoded(n);
+  for (size_t i = 0; i < n; i++) {
+    states[i].id = (uint8_t)i;
+    states[i].position = (int16_t)(i * 7 - 3000);
+    states[i].velocity = (uint16_t)(i * 13);
+    states[i].timestamp = (uint32_t)(i * 100003);
+    states[i].current = i * 0.25f;
+  }
+  std::vector<uint8_t> hand(n * MESSAGE_SIZE), codec(n * MESSAGE_SIZE);
+
+  const double handEnc = measure(rounds, n, [&]() { handEncode(states.data(), hand.data(), n); });
+  const double codecEnc = measure(rounds, n, [&]() { codecEncode(states.data(), codec.data(), n); });
+  if (hand != codec) {
+    std::cout << "encodings differ" << std::endl;
+    return(1);
+  }
+  const double handDec = measure(rounds, n, [&]() { handDecode(hand.data(), decoded.data(), n); });
+  const double codecDec = measure(rounds, n, [&]() { codecDecode(codec.data(), decoded.data(), n); });
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "message size " << MESSAGE_SIZE << " bytes, " << n << " messages x " << rounds << " rounds" << std::endl;
+  std::cout << "encode  hand-written " << handEnc << " ns/msg, MessageCodec " << codecEnc << " ns/msg" << std::endl;
+  std::cout << "decode  hand-written " << handDec << " ns/msg, MessageCodec " << codecDec << " ns/msg" << std::endl;
+  return(0);
+}
@@ -0,0 +1,125 @@
+/********************************************************
+ * connectionexecutor_bench.cpp
+ *
+ * Loopback request / response server with skewed load:
+ * a few clients send heavy requests, the rest light ones.
+ * ConnectionExecutor on a WorkStealingPool against a
+ * thread per connection.
+ *
+ * usage: connectionexecutor_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+#include "aqua2/connectionexecutor.h"
+#include "aqua2/inputlatency.h"
+
+using namespace ssr::aqua2;
+
+const static int CLIENTS = 32;
+const static int HEAVY_CLIENTS = 4;
+const static uint32_t LIGHT_USEC = 5;
+const static uint32_t HEAVY_USEC = 200;
+
+/// request: work [usec], response: the same 4 bytes
+static void work(const uint32_t usec) {
+  const uint64_t end = InputLatencyMonitor::now() + usec * 1000ULL;
+  while (InputLatencyMonitor::now() < end) ;
+}
+
+static bool readFull(Socket& socket, void* dst, const int size) {
+  for (int n = 0; n < size; ) {
+    const int r = socket.read((char*)dst + n, size - n);
+    if (r <= 0) return false;
+    n += r;
+  }
+  return true;
+}
+
+/// Runs the clients and returns the histograms of response time of light and heavy clients.
+static uint64_t runClients(const unsigned int port, const int requests, LatencyHistogram& light, LatencyHistogram& heavy) {
+  std::vector<std::thread> clients;
+  const uint64_t start = InputLatencyMonitor::now();
+  for (int c = 0; c < CLIENTS; c++) {
+    clients.push_back(std::thread([&, c]() {
+	  Socket socket("127.0.0.1", port);
+	  const uint32_t usec = c < HEAVY_CLIENTS ? HEAVY_USEC : LIGHT_USEC;
+	  LatencyHistogram& h = c < HEAVY_CLIENTS ? heavy : light;
+	  for (int i = 0; i < requests; i++) {
+	    uint32_t response;
+	    const uint64_t t = InputLatencyMonitor::now();
+	    socket.write(&usec, sizeof(usec));
+	    if (!readFull(socket, &response, sizeof(response))) break;
+	    h.add(InputLatencyMonitor::now() - t);
+	  }
+	  socket.close();
+	}));
+  }
+  for (size_t i = 0; i < clients.size(); i++) clients[i].join();
+  return InputLatencyMonitor::now() - start;
+}
+
+static void print(const char* name, const uint64_t elapsed, const LatencyHistogram& light, const LatencyHistogram& heavy) {
+  const LatencyHistogramSnapshot l = light.snapshot(), h = heavy.snapshot();
+  std::cout << name << ": " << (l.count + h.count) * 1e9 / elapsed << " req/s, light p50 " << l.percentile(0.5)
+	    << " ns p99 " << l.percentile(0.99) << " ns, heavy p50 " << h.percentile(0.5) << " ns" << std::endl;
+}
+
+/// 4 byte requests: readFull() waits for the rest of a partial one only
+static bool serve(Socket& socket) {
+  uint32_t usec;
+  if (!readFull(socket, &usec, sizeof(usec))) return false;
+  work(usec);
+  return socket.tryWrite(&usec, sizeof(usec)).valueOr(0) == (int)sizeof(usec);
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int requests = 200 * scale;
+  std::cout << CLIENTS << " clients (" << HEAVY_CLIENTS << " heavy), " << requests << " requests each, "
+	    << std::thread::hardware_concurrency() << " CPU" << std::endl;
+
+  /// thread per connection
+  {
+    ServerSocket server;
+    server.bind(0);
+    server.listen(CLIENTS);
+    std::vector<std::thread> threads;
+    std::thread acceptor([&]() {
+	for (int c = 0; c < CLIENTS; c++) {
+	  Socket socket = server.accept();
+	  threads.push_back(std::thread([socket]() mutable {
+		while (serve(socket)) ;
+		socket.close();
+	      }));
+	}
+      });
+    LatencyHistogram light, heavy;
+    const uint64_t elapsed = runClients(server.getPort(), requests, light, heavy);
+    acceptor.join();
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    print("thread per connection", elapsed, light, heavy);
+    server.close();
+  }
+
+  /// ConnectionExecutor
+  {
+    ServerSocket server;
+    server.bind(0);
+    server.listen(CLIENTS);
+    WorkStealingPool pool;
+    ConnectionExecutor executor(server, pool, serve);
+    executor.start();
+    LatencyHistogram light, heavy;
+    const uint64_t elapsed = runClients(server.getPort(), requests, light, heavy);
+    print("ConnectionExecutor   ", elapsed, light, heavy);
+    std::cout << "  " << pool.getThreads() << " threads, " << executor.getDispatched() << " dispatched, "
+	      << pool.getSteals() << " stolen" << std::endl;
+    executor.stop();
+    server.close();
+  }
+  return(0);
+}
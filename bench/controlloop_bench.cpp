@@ -0,0 +1,70 @@
+/********************************************************
+ * controlloop_bench.cpp
+ *
+ * Period error of a 1 kHz loop: sleep_for() after the
+ * work (as tests/gamepad_test.cpp) against ControlLoop
+ * with and without spin margin.
+ *
+ * usage: controlloop_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <thread>
+#include <cstdlib>
+
+#include "aqua2/controlloop.h"
+
+using namespace ssr::aqua2;
+
+/// about 100 usec of work per cycle
+static void work() {
+  const uint64_t end = ControlLoop::now() + 100000;
+  while (ControlLoop::now() < end) ;
+}
+
+static void print(const char* name, const uint64_t cycles, const uint64_t elapsed, const LatencyHistogramSnapshot& s) {
+  const double rate = cycles * 1e9 / elapsed;
+  std::cout << name << ": " << rate << " Hz (" << (rate - 1000.0) / 10.0 << " %), jitter p50 " << s.percentile(0.5)
+	    << " ns, p99 " << s.percentile(0.99) << " ns, max " << s.max << " ns" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const uint64_t cycles = 2000 * scale;
+
+  /// sleep_for() loop: error of each period from 1 msec
+  {
+    LatencyHistogram error;
+    const uint64_t start = ControlLoop::now();
+    uint64_t last = start;
+    for (uint64_t i = 0; i < cycles; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      const uint64_t t = ControlLoop::now();
+      const uint64_t period = t - last;
+      error.add(period > 1000000 ? period - 1000000 : 1000000 - period);
+      last = t;
+      work();
+    }
+    print("sleep_for(1ms)        ", cycles, ControlLoop::now() - start, error.snapshot());
+  }
+
+  const uint64_t margins[] = {0, 100000};
+  const char* names[] = {"ControlLoop          ", "ControlLoop spin 100u"};
+  for (int m = 0; m < 2; m++) {
+    ControlLoop loop(1000);
+    loop.setSpinMargin(margins[m]);
+    loop.addStage(ControlLoop::COMPUTE, work);
+    try {
+      loop.setRealtimePriority(50);
+      loop.run(1);
+    } catch (ControlLoopException& ex) {
+      std::cout << "(" << ex.what() << ", SCHED_OTHER)" << std::endl;
+      loop.setRealtimePriority(0);
+    }
+    loop.reset();
+    const uint64_t start = ControlLoop::now();
+    loop.run(cycles);
+    const ControlLoopSnapshot s = loop.snapshot();
+    print(names[m], s.cycles + s.skipped, ControlLoop::now() - start, s.jitter);
+  }
+  return(0);
+}
@@ -0,0 +1,87 @@
+/********************************************************
+ * eventbus_bench.cpp
+ *
+ * Input-to-handler latency of EventBus (epoll wakeup)
+ * against a polling loop sleeping 1 msec between checks.
+ *
+ * usage: eventbus_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <sys/socket.h>
+
+#include "aqua2/eventbus.h"
+
+using namespace ssr::aqua2;
+
+static void print(const char* name, const LatencyHistogramSnapshot& s) {
+  std::cout << name << ": mean " << s.mean() << " ns, p50 " << s.percentile(0.5) << " ns, p99 "
+	    << s.percentile(0.99) << " ns, max " << s.max << " ns" << std::endl;
+}
+
+/// Writes its send time every period.
+static void sender(const int fd, const int count, std::atomic<bool>& done) {
+  for (int i = 0; i < count; i++) {
+    std::this_thread::sleep_for(std::chrono::microseconds(500 + (i * 7919) % 500));
+    const uint64_t now = InputLatencyMonitor::now();
+    if (::send(fd, &now, sizeof(now), 0) != sizeof(now)) break;
+  }
+  done = true;
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int count = 2000 * scale;
+
+  /// polling loop
+  {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return(1);
+    struct sockaddr_in addr;
+    Socket socket(fds[0], addr);
+    LatencyHistogram latency;
+    std::atomic<bool> done(false);
+    std::thread thread(sender, fds[1], count, std::ref(done));
+    while (!done || socket.getSizeInRxBuffer() > 0) {
+      while (socket.getSizeInRxBuffer() >= 8) {
+	uint64_t sent;
+	socket.read(&sent, sizeof(sent));
+	latency.add(InputLatencyMonitor::now() - sent);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    thread.join();
+    print("polling every 1 msec", latency.snapshot());
+    ::close(fds[0]);
+    ::close(fds[1]);
+  }
+
+  /// EventBus
+  {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return(1);
+    struct sockaddr_in addr;
+    Socket socket(fds[0], addr);
+    EventBus bus;
+    bus.addSocket(socket);
+    LatencyHistogram latency;
+    bus.setHandler([&](const InputEvent& e) {
+      for (size_t i = 0; i + 8 <= e.size; i += 8) {
+	uint64_t sent;
+	memcpy(&sent, e.data + i, sizeof(sent));
+	latency.add(InputLatencyMonitor::now() - sent);
+      }
+    });
+    std::atomic<bool> done(false);
+    std::thread thread(sender, fds[1], count, std::ref(done));
+    while (!done) bus.spinOnce(10);
+    while (bus.spinOnce(10) > 0) ;
+    thread.join();
+    print("EventBus (epoll wakeup)", latency.snapshot());
+    ::close(fds[0]);
+    ::close(fds[1]);
+  }
+  return(0);
+}
@@ -0,0 +1,63 @@
+/********************************************************
+ * gamepadstate_bench.cpp
+ *
+ * Cost of GamePad state snapshots and publish-to-reader latency.
+ *
+ * usage: gamepadstate_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+#include "aqua2/gamepad.h"
+
+using namespace ssr::aqua2;
+
+static void print(const char* name, const LatencyHistogramSnapshot& s) {
+  std::cout << name << ": mean " << s.mean() << " ns, p50 " << s.percentile(0.5) << " ns, p99 "
+	    << s.percentile(0.99) << " ns, max " << s.max << " ns" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  SeqLock<GamePadState> lock;
+  GamePadState state = GamePadState();
+
+  /// uncontended costs
+  const int n = 1000000 * scale;
+  uint64_t start = GamePadEvent::now();
+  for (int i = 0; i < n; i++) {
+    state.sequence = i;
+    lock.store(state);
+  }
+  const double storeNs = (double)(GamePadEvent::now() - start) / n;
+  uint64_t sum = 0;
+  start = GamePadEvent::now();
+  for (int i = 0; i < n; i++) sum += lock.load().sequence;
+  const double loadNs = (double)(GamePadEvent::now() - start) / n;
+  std::cout << "sizeof(GamePadState) " << sizeof(GamePadState) << " bytes" << std::endl;
+  std::cout << "store " << storeNs << " ns, load " << loadNs << " ns (" << (sum & 1) << ")" << std::endl;
+
+  /// latency from store() to reader observing the new version
+  LatencyHistogram latency;
+  std::atomic<bool> running(true);
+  std::thread reader([&]() {
+    uint64_t version = lock.version();
+    while (running) {
+      if (lock.version() == version) continue;
+      GamePadState s;
+      version = lock.load(s);
+      latency.add(GamePadEvent::now() - s.timestamp);
+    }
+  });
+  for (int i = 0; i < 2000 * scale; i++) {
+    state.timestamp = GamePadEvent::now();
+    lock.store(state);
+    std::this_thread::sleep_for(std::chrono::microseconds(500)); // 2 kHz publisher
+  }
+  running = false;
+  reader.join();
+  print("publish to reader", latency.snapshot());
+  return(0);
+}
@@ -0,0 +1,54 @@
+/********************************************************
+ * gamepadstream_bench.cpp
+ *
+ * Bytes on the wire and loopback latency of GamePadStream
+ * against sending full GamePadState snapshots.
+ *
+ * usage: gamepadstream_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+
+#include "aqua2/gamepadstream.h"
+
+using namespace ssr::aqua2;
+
+static void print(const char* name, const LatencyHistogramSnapshot& s) {
+  std::cout << name << ": mean " << s.mean() << " ns, p50 " << s.percentile(0.5) << " ns, p99 "
+	    << s.percentile(0.99) << " ns, max " << s.max << " ns" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int updates = 5000 * scale;
+
+  GamePadStreamSubscriber subscriber(0);
+  GamePadStreamPublisher publisher("127.0.0.1", subscriber.getPort());
+
+  /// 1 kHz update of an 8 axes / 16 buttons pad: one stick moving, a button every 100 updates
+  GamePadState state;
+  memset(&state, 0, sizeof(state));
+  state.numAxes = 8;
+  state.numButtons = 16;
+  int applied = 0;
+  for (int i = 0; i < updates; i++) {
+    state.sequence++;
+    state.timestamp = GamePadEvent::now();
+    state.axes[0] = std::sin(i * 0.01f);
+    state.axes[1] = std::cos(i * 0.01f);
+    if (i % 100 == 0) state.setButton((i / 100) % 16, !state.button((i / 100) % 16));
+    if (publisher.publish(state) < 0) return(1);
+    applied += subscriber.spinOnce(0);
+  }
+  while (subscriber.spinOnce(10) > 0) ;
+
+  const double seconds = updates / 1000.0;
+  std::cout << updates << " updates, " << publisher.getPacketsSent() << " packets (" << publisher.getKeyframesSent() << " keyframes)" << std::endl;
+  std::cout << "full snapshot  " << sizeof(GamePadState) * updates / seconds << " bytes/s" << std::endl;
+  std::cout << "delta encoded  " << publisher.getBytesSent() / seconds << " bytes/s ("
+	    << (double)publisher.getBytesSent() / publisher.getPacketsSent() << " bytes/packet)" << std::endl;
+  std::cout << "received " << subscriber.getReceivedPackets() << ", lost " << subscriber.getLostPackets() << std::endl;
+  print("UDP loopback latency (publish to spinOnce)", subscriber.latency());
+  return(0);
+}
@@ -0,0 +1,519 @@
+/********************************************************
+ * harness.h
+ *
+ * Micro-benchmark harness of aqua2_bench: named scenarios,
+ * latency percentiles, allocations, system calls and CPU
+ * counters per operation, text or JSON report (Linux only).
+ *
+ * Define AQUA2_BENCH_MAIN in the one source file with main()
+ * to count allocations (replaces global operator new).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <new>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief operator new calls of the process (counted only with AQUA2_BENCH_MAIN).
+     */
+    inline std::atomic<uint64_t>& benchAllocations() {
+      static std::atomic<uint64_t> allocations(0);
+      return allocations;
+    }
+
+
+    /***************************************************
+     * PerfCounter
+     *
+     * @brief One perf_event_open() counter of the calling thread.
+     *
+     * Hardware counters count user space only, which perf_event_paranoid
+     * up to 2 allows; the system call tracepoint needs tracefs and a
+     * paranoid level of -1 (or CAP_PERFMON). available() is false when
+     * the kernel, the hypervisor or the permissions refuse the counter.
+     ***************************************************/
+    class PerfCounter {
+    private:
+      int fd_;
+
+    public:
+      PerfCounter(const uint32_t type, const uint64_t config) : fd_(-1) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = type == PERF_TYPE_HARDWARE ? 1 : 0;
+	attr.exclude_hv = 1;
+	fd_ = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+      }
+
+      ~PerfCounter() {
+	if (fd_ >= 0) ::close(fd_);
+      }
+
+    private:
+      PerfCounter(const PerfCounter&);
+      PerfCounter& operator=(const PerfCounter&);
+
+    public:
+      /**
+       * @brief Counter of raw_syscalls:sys_enter, ie., every system call.
+       */
+      static PerfCounter* syscalls() {
+	const char* paths[] = {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+			       "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+	for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+	  std::ifstream f(paths[i]);
+	  uint64_t id;
+	  if (f >> id) return new PerfCounter(PERF_TYPE_TRACEPOINT, id);
+	}
+	return new PerfCounter(PERF_TYPE_TRACEPOINT, UINT64_MAX);
+      }
+
+      bool available() const { return fd_ >= 0; }
+
+      void start() {
+	if (fd_ < 0) return;
+	ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+      }
+
+      void stop() {
+	if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      }
+
+      uint64_t value() const {
+	uint64_t v = 0;
+	if (fd_ < 0 || ::read(fd_, &v, sizeof(v)) != sizeof(v)) return 0;
+	return v;
+      }
+    };
+
+
+    /**
+     * @brief Result of one scenario. Counters per operation are negative when not available.
+     */
+    struct BenchResult {
+      std::string name;
+      std::string error;
+      uint64_t iterations;
+      double seconds;
+      double opsPerSecond;
+      double bytesPerSecond;
+      double mean;             ///< latency [ns]
+      uint64_t p50;
+      uint64_t p99;
+      uint64_t p999;
+      uint64_t max;
+      double allocationsPerOp;
+      double syscallsPerOp;        ///< every system call (perf tracepoint)
+      double readWriteCallsPerOp;  ///< read(2) / write(2) family only (/proc/thread-self/io), when perf can not count
+      double contextSwitchesPerOp;
+      double cyclesPerOp;
+      double instructionsPerOp;
+    };
+
+
+    /***************************************************
+     * BenchState
+     *
+     * @brief Loop control and measurement of one scenario run.
+     *
+     * A scenario sets up its fixture, loops while next() is true doing
+     * one operation per turn, and tears the fixture down. The first
+     * turns warm up; then each turn is timed and the counters run on the
+     * calling thread. Memory for the samples is allocated before, so
+     * allocations per operation are the ones of the code measured
+     * (and of other threads of the process, eg., an echo server).
+     *
+     * Usage:
+     *   harness.add("serial/pty_echo_16", 100000, [](BenchState& state) {
+     *     VirtualSerialPair pair;
+     *     state.setBytesPerOp(16);
+     *     while (state.next()) { ... }
+     *   });
+     ***************************************************/
+    class BenchState {
+    private:
+      const uint64_t iterations_;
+      const uint64_t warmup_;
+      uint64_t turn_;
+      uint64_t last_;
+      uint64_t start_;
+      uint64_t end_;
+      uint64_t bytesPerOp_;
+      bool uncountedCalls_;
+      std::vector<uint64_t> samples_;
+
+      PerfCounter* syscalls_;
+      PerfCounter* cycles_;
+      PerfCounter* instructions_;
+      int procIo_;
+      uint64_t allocations_;
+      uint64_t procCalls_;
+      uint64_t switches_;
+
+    public:
+      BenchState(const uint64_t iterations) : iterations_(iterations > 0 ? iterations : 1), warmup_(iterations_ / 10 + 1),
+	turn_(0), last_(0), start_(0), end_(0), bytesPerOp_(0), uncountedCalls_(false), samples_(iterations_, 0),
+	syscalls_(PerfCounter::syscalls()),
+	cycles_(new PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES)),
+	instructions_(new PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS)),
+	procIo_(-1), allocations_(0), procCalls_(0), switches_(0) {
+	if (!syscalls_->available()) procIo_ = ::open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+      }
+
+      ~BenchState() {
+	delete syscalls_;
+	delete cycles_;
+	delete instructions_;
+	if (procIo_ >= 0) ::close(procIo_);
+      }
+
+    private:
+      BenchState(const BenchState&);
+      BenchState& operator=(const BenchState&);
+
+    public:
+      static uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+
+      /**
+       * @brief Bytes moved by one operation, to report bytes per second.
+       */
+      void setBytesPerOp(const uint64_t bytes) { bytesPerOp_ = bytes; }
+
+      /**
+       * @brief The operation makes system calls /proc/thread-self/io does not count
+       *        (send, recv, poll, ioctl, epoll_wait, ...). Without perf, the calls of
+       *        the scenario are reported as unknown instead of a partial count.
+       */
+      void setUncountedCalls() { uncountedCalls_ = true; }
+
+      uint64_t getIterations() const { return iterations_; }
+
+      /**
+       * @brief true while one more operation is to be done.
+       */
+      bool next() {
+	const uint64_t turn = turn_++;
+	if (turn < warmup_) return true;
+	if (turn == warmup_) {
+	  begin();
+	  last_ = now();
+	  start_ = last_;
+	  return true;
+	}
+	const uint64_t t = now();
+	samples_[turn - warmup_ - 1] = t - last_;
+	last_ = t;
+	if (turn < warmup_ + iterations_) return true;
+	end_ = t;
+	finish();
+	return false;
+      }
+
+      /**
+       * @brief Summary of the run. Sorts the samples.
+       */
+      BenchResult result(const std::string& name) {
+	BenchResult r;
+	r.name = name;
+	r.iterations = iterations_;
+	r.seconds = (end_ - start_) / 1e9;
+	r.opsPerSecond = r.seconds > 0 ? iterations_ / r.seconds : 0;
+	r.bytesPerSecond = r.opsPerSecond * bytesPerOp_;
+	std::sort(samples_.begin(), samples_.end());
+	double sum = 0;
+	for (size_t i = 0; i < samples_.size(); i++) sum += samples_[i];
+	r.mean = sum / samples_.size();
+	r.p50 = percentile(0.5);
+	r.p99 = percentile(0.99);
+	r.p999 = percentile(0.999);
+	r.max = samples_.back();
+	r.allocationsPerOp = (double)allocations_ / iterations_;
+	r.syscallsPerOp = syscalls_->available() ? (double)syscalls_->value() / iterations_ : -1;
+	r.readWriteCallsPerOp = procIo_ >= 0 && !uncountedCalls_ ? (double)procCalls_ / iterations_ : -1;
+	r.contextSwitchesPerOp = (double)switches_ / iterations_;
+	r.cyclesPerOp = cycles_->available() ? (double)cycles_->value() / iterations_ : -1;
+	r.instructionsPerOp = instructions_->available() ? (double)instructions_->value() / iterations_ : -1;
+	return r;
+      }
+
+    private:
+      uint64_t percentile(const double p) const {
+	size_t i = (size_t)(p * samples_.size());
+	return samples_[i < samples_.size() ? i : samples_.size() - 1];
+      }
+
+      /**
+       * @brief read(2) and write(2) family calls of this thread so far (syscr + syscw).
+       */
+      uint64_t procIoCalls() const {
+	if (procIo_ < 0) return 0;
+	char buf[512];
+	const ssize_t n = pread(procIo_, buf, sizeof(buf) - 1, 0);
+	if (n <= 0) return 0;
+	buf[n] = 0;
+	uint64_t calls = 0;
+	const char* keys[] = {"syscr:", "syscw:"};
+	for (int i = 0; i < 2; i++) {
+	  const char* p = strstr(buf, keys[i]);
+	  if (p) calls += strtoull(p + strlen(keys[i]), NULL, 10);
+	}
+	return calls;
+      }
+
+      static uint64_t contextSwitches() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_THREAD, &usage) != 0) return 0;
+	return usage.ru_nvcsw + usage.ru_nivcsw;
+      }
+
+      void begin() {
+	procCalls_ = procIoCalls();
+	switches_ = contextSwitches();
+	allocations_ = benchAllocations().load(std::memory_order_relaxed);
+	syscalls_->start();
+	cycles_->start();
+	instructions_->start();
+      }
+
+      void finish() {
+	instructions_->stop();
+	cycles_->stop();
+	syscalls_->stop();
+	allocations_ = benchAllocations().load(std::memory_order_relaxed) - allocations_;
+	switches_ = contextSwitches() - switches_;
+	if (procIo_ >= 0) procCalls_ = procIoCalls() - procCalls_ - 1; // the pread() of begin()
+      }
+    };
+
+
+    /***************************************************
+     * BenchHarness
+     *
+     * @brief Registry of named scenarios and the command line of aqua2_bench.
+     *
+     * usage: aqua2_bench [--list] [--filter=text] [--json[=file]] [scale]
+     *   --filter  run the scenarios whose name contains text
+     *   --json    JSON report on stdout, or in file (text on stdout)
+     *   scale     multiplies the iterations of every scenario
+     *
+     * Usage:
+     *   BenchHarness harness;
+     *   harness.add("socket/tcp_echo_64", 20000, tcpEcho);
+     *   return harness.main(argc, argv);
+     ***************************************************/
+    class BenchHarness {
+    public:
+      typedef std::function<void(BenchState&)> Scenario;
+
+    private:
+      struct Entry {
+	std::string name;
+	uint64_t iterations;
+	Scenario scenario;
+      };
+
+      std::vector<Entry> entries_;
+
+    public:
+      void add(const std::string& name, const uint64_t iterations, const Scenario& scenario) {
+	Entry e;
+	e.name = name;
+	e.iterations = iterations;
+	e.scenario = scenario;
+	entries_.push_back(e);
+      }
+
+      /**
+       * @brief Run one scenario. An exception thrown by it is reported in BenchResult::error.
+       */
+      BenchResult run(const std::string& name, const uint64_t iterations, const Scenario& scenario) {
+	BenchState state(iterations);
+	try {
+	  scenario(state);
+	} catch (std::exception& ex) {
+	  BenchResult r = BenchResult();
+	  r.name = name;
+	  r.error = ex.what();
+	  return r;
+	}
+	BenchResult r = state.result(name);
+	if (r.seconds <= 0) r.error = "scenario returned before next() was false";
+	return r;
+      }
+
+      /**
+       * @return exit status: 0, 1 if a scenario failed, 2 for a bad command line.
+       */
+      int main(int argc, char* argv[]) {
+	std::string filter, json;
+	bool toJson = false;
+	double scale = 1.0;
+	for (int i = 1; i < argc; i++) {
+	  const std::string arg = argv[i];
+	  if (arg == "--list") {
+	    for (size_t j = 0; j < entries_.size(); j++) std::cout << entries_[j].name << std::endl;
+	    return 0;
+	  } else if (arg.compare(0, 9, "--filter=") == 0) {
+	    filter = arg.substr(9);
+	  } else if (arg == "--json") {
+	    toJson = true;
+	  } else if (arg.compare(0, 7, "--json=") == 0) {
+	    toJson = true;
+	    json = arg.substr(7);
+	  } else if (arg[0] != '-' && atof(arg.c_str()) > 0) {
+	    scale = atof(arg.c_str());
+	  } else {
+	    std::cerr << "usage: " << argv[0] << " [--list] [--filter=text] [--json[=file]] [scale]" << std::endl;
+	    return 2;
+	  }
+	}
+
+	const bool text = !toJson || !json.empty();
+	std::vector<BenchResult> results;
+	for (size_t i = 0; i < entries_.size(); i++) {
+	  if (entries_[i].name.find(filter) == std::string::npos) continue;
+	  results.push_back(run(entries_[i].name, (uint64_t)(entries_[i].iterations * scale), entries_[i].scenario));
+	  if (text) print(std::cout, results.back());
+	}
+
+	if (toJson) {
+	  if (json.empty()) {
+	    writeJson(std::cout, results);
+	  } else {
+	    std::ofstream f(json.c_str());
+	    writeJson(f, results);
+	    if (!f) {
+	      std::cerr << "can not write " << json << std::endl;
+	      return 1;
+	    }
+	  }
+	}
+	for (size_t i = 0; i < results.size(); i++) {
+	  if (!results[i].error.empty()) return 1;
+	}
+	return 0;
+      }
+
+      static void print(std::ostream& os, const BenchResult& r) {
+	if (!r.error.empty()) {
+	  os << r.name << ": FAILED " << r.error << std::endl;
+	  return;
+	}
+	std::ostringstream s;
+	s.setf(std::ios::fixed);
+	s.precision(1);
+	s << r.name << ": " << r.opsPerSecond << " ops/s, p50 " << r.p50 << " ns, p99 " << r.p99
+	  << " ns, p999 " << r.p999 << " ns, " << r.allocationsPerOp << " allocs/op";
+	if (r.syscallsPerOp >= 0) s << ", " << r.syscallsPerOp << " syscalls/op";
+	else if (r.readWriteCallsPerOp >= 0) s << ", " << r.readWriteCallsPerOp << " read/write calls/op";
+	if (r.instructionsPerOp >= 0) s << ", " << r.instructionsPerOp << " instructions/op";
+	os << s.str() << std::endl;
+      }
+
+      static void writeJson(std::ostream& os, const std::vector<BenchResult>& results) {
+	os << "{\n  \"benchmark\": \"aqua2_bench\",\n  \"results\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+	  const BenchResult& r = results[i];
+	  os << (i > 0 ? ",\n" : "\n") << "    {\"name\": " << quote(r.name);
+	  if (!r.error.empty()) {
+	    os << ", \"error\": " << quote(r.error) << "}";
+	    continue;
+	  }
+	  os << ", \"iterations\": " << r.iterations
+	     << ", \"seconds\": " << number(r.seconds)
+	     << ", \"opsPerSecond\": " << number(r.opsPerSecond)
+	     << ", \"bytesPerSecond\": " << number(r.bytesPerSecond)
+	     << ", \"latencyNs\": {\"mean\": " << number(r.mean) << ", \"p50\": " << r.p50 << ", \"p99\": " << r.p99
+	     << ", \"p999\": " << r.p999 << ", \"max\": " << r.max << "}"
+	     << ", \"allocationsPerOp\": " << number(r.allocationsPerOp)
+	     << ", \"syscallsPerOp\": " << number(r.syscallsPerOp)
+	     << ", \"readWriteCallsPerOp\": " << number(r.readWriteCallsPerOp)
+	     << ", \"contextSwitchesPerOp\": " << number(r.contextSwitchesPerOp)
+	     << ", \"cyclesPerOp\": " << number(r.cyclesPerOp)
+	     << ", \"instructionsPerOp\": " << number(r.instructionsPerOp) << "}";
+	}
+	os << "\n  ]\n}" << std::endl;
+      }
+
+    private:
+      /**
+       * @brief JSON number, null when negative (not available).
+       */
+      static std::string number(const double v) {
+	if (v < 0) return "null";
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.6g", v);
+	return buf;
+      }
+
+      static std::string quote(const std::string& s) {
+	std::string q = "\"";
+	for (size_t i = 0; i < s.size(); i++) {
+	  const char c = s[i];
+	  if (c == '"' || c == '\\') {
+	    q += '\\';
+	    q += c;
+	  } else if ((unsigned char)c < 0x20) {
+	    char buf[8];
+	    snprintf(buf, sizeof(buf), "\\u%04x", c);
+	    q += buf;
+	  } else {
+	    q += c;
+	  }
+	}
+	return q + "\"";
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+
+#ifdef AQUA2_BENCH_MAIN
+void* operator new(size_t size) {
+  ssr::aqua2::benchAllocations().fetch_add(1, std::memory_order_relaxed);
+  if (void* p = malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#endif // ifdef AQUA2_BENCH_MAIN
@@ -0,0 +1,72 @@
+/********************************************************
+ * result_bench.cpp
+ *
+ * Cost of a timeout / would-block: throwing functions
+ * (exception thrown and caught) against try* functions
+ * returning Result.
+ *
+ * usage: result_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+#include "aqua2/serialport.h"
+#include "aqua2/serversocket.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+static uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void print(const char* name, const int count, const uint64_t elapsed) {
+  std::cout << name << ": " << (double)elapsed / count << " ns/call" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int count = 100000 * scale;
+
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  int timeouts = 0;
+  uint64_t start = now();
+  for (int i = 0; i < count; i++) {
+    try {
+      server.accept(0);
+    } catch (TimeoutException& ex) {
+      timeouts++;
+    }
+  }
+  print("ServerSocket::accept(0)    throws TimeoutException", count, now() - start);
+  start = now();
+  for (int i = 0; i < count; i++) {
+    if (server.tryAccept(0).error() == ETIMEDOUT) timeouts++;
+  }
+  print("ServerSocket::tryAccept(0) returns ETIMEDOUT     ", count, now() - start);
+  server.close();
+
+  VirtualSerialPair serial(115200);
+  SerialPort& port = serial.first(); // pty master: EAGAIN when empty
+  char buf[16];
+  int wouldBlock = 0;
+  start = now();
+  for (int i = 0; i < count; i++) {
+    try {
+      port.read(buf, sizeof(buf));
+    } catch (ComAccessException& ex) {
+      wouldBlock++;
+    }
+  }
+  print("SerialPort::read()    throws ComAccessException  ", count, now() - start);
+  start = now();
+  for (int i = 0; i < count; i++) {
+    if (port.tryRead(buf, sizeof(buf)).error() == EAGAIN) wouldBlock++;
+  }
+  print("SerialPort::tryRead() returns EAGAIN             ", count, now() - start);
+
+  return timeouts == 2 * count && wouldBlock == 2 * count ? 0 : 1;
+}
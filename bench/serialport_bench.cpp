@@ -0,0 +1,156 @@
+/********************************************************
+ * serialport_bench.cpp
+ *
+ * Baseline benchmark of SerialPort read paths over VirtualSerialPair.
+ *
+ * usage: serialport_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <sys/resource.h>
+
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+static double cpuSeconds() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+}
+
+static double now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void writeAll(SerialPort& port, const uint8_t* data, size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    try {
+      written += port.write(data + written, size - written);
+    } catch (ComAccessException& ex) {
+      std::this_thread::yield(); // EAGAIN. pty buffer is full.
+    }
+  }
+}
+
+static void report(const char* name, const size_t bytes, const size_t ops, const double elapsed, const double cpu) {
+  std::cout << std::left << std::setw(24) << name << std::right
+	    << std::setw(10) << std::fixed << std::setprecision(2) << bytes / elapsed / 1e6 << " MB/s"
+	    << std::setw(12) << std::setprecision(0) << ops / elapsed << " op/s"
+	    << std::setw(10) << std::setprecision(2) << cpu * 1e9 / bytes << " cpu-ns/byte" << std::endl;
+}
+
+/// read(dst, size) after polling getSizeInRxBuffer()
+static void benchThroughput(VirtualSerialPair& pair, const size_t total) {
+  std::vector<uint8_t> chunk(4096, 0x55);
+  std::thread writer([&]() {
+    for (size_t sent = 0; sent < total; sent += chunk.size()) writeAll(pair.first(), &chunk[0], chunk.size());
+  });
+  std::vector<uint8_t> buf(65536);
+  size_t received = 0, ops = 0;
+  double cpu = cpuSeconds(), start = now();
+  while (received < total) {
+    int size = pair.second().getSizeInRxBuffer();
+    if (size <= 0) continue;
+    received += pair.second().read(&buf[0], std::min<size_t>(size, buf.size()));
+    ops++;
+  }
+  double elapsed = now() - start;
+  cpu = cpuSeconds() - cpu;
+  writer.join();
+  report("read", received, ops, elapsed, cpu);
+}
+
+/// read(dst, size, timeout) with fixed size
+static void benchTimeoutRead(VirtualSerialPair& pair, const size_t total, const size_t size) {
+  std::vector<uint8_t> chunk(4096, 0xAA);
+  std::thread writer([&]() {
+    for (size_t sent = 0; sent < total; sent += chunk.size()) writeAll(pair.first(), &chunk[0], chunk.size());
+  });
+  std::vector<uint8_t> buf(size);
+  size_t received = 0, ops = 0;
+  double cpu = cpuSeconds(), start = now();
+  while (received < total) {
+    if (pair.second().read(&buf[0], size, 1.0) != (int)size) break;
+    received += size;
+    ops++;
+  }
+  double elapsed = now() - start;
+  cpu = cpuSeconds() - cpu;
+  writer.join();
+  report("read(timeout)", received, ops, elapsed, cpu);
+}
+
+static void benchReadLine(VirtualSerialPair& pair, const size_t lines, const bool withTimeout) {
+  const char* line = withTimeout ? "0123456789abcdefghijklmnopqrs\x0A\x0D" : "0123456789abcdefghijklmnopqrs\x0D\x0A";
+  const size_t length = strlen(line);
+  std::thread writer([&]() {
+    std::string block;
+    for (int i = 0; i < 128; i++) block += line;
+    for (size_t sent = 0; sent < lines; sent += 128) writeAll(pair.first(), (const uint8_t*)block.c_str(), block.size());
+  });
+  char buf[256];
+  size_t count = 0;
+  double cpu = cpuSeconds(), start = now();
+  while (count < lines) {
+    int ret = withTimeout ? pair.second().readLineWithTimeout(buf, sizeof(buf), 1.0) : pair.second().readLine(buf, sizeof(buf));
+    if (ret != (int)length) break;
+    count++;
+  }
+  double elapsed = now() - start;
+  cpu = cpuSeconds() - cpu;
+  writer.join();
+  pair.second().flushRxBuffer();
+  report(withTimeout ? "readLineWithTimeout" : "readLine", count * length, count, elapsed, cpu);
+}
+
+/// 16 bytes packet echoed back by second()
+static void benchRoundTrip(VirtualSerialPair& pair, const size_t count) {
+  const size_t size = 16;
+  std::atomic<bool> running(true);
+  std::thread echo([&]() {
+    uint8_t buf[size];
+    while (running) {
+      if (pair.second().read(buf, size, 1.0) == (int)size) writeAll(pair.second(), buf, size);
+    }
+  });
+  uint8_t packet[size] = {0}, buf[size];
+  std::vector<double> latencies;
+  double cpu = cpuSeconds(), start = now();
+  for (size_t i = 0; i < count; i++) {
+    double t = now();
+    writeAll(pair.first(), packet, size);
+    if (pair.first().read(buf, size, 1.0) != (int)size) break;
+    latencies.push_back(now() - t);
+  }
+  double elapsed = now() - start;
+  cpu = cpuSeconds() - cpu;
+  running = false;
+  echo.join();
+  if (latencies.empty()) return;
+  report("round trip", latencies.size() * size * 2, latencies.size(), elapsed, cpu);
+  std::sort(latencies.begin(), latencies.end());
+  std::cout << std::setw(24) << "" << std::setprecision(1)
+	    << "p50 " << latencies[latencies.size() / 2] * 1e6 << " us, "
+	    << "p99 " << latencies[latencies.size() * 99 / 100] * 1e6 << " us, "
+	    << "max " << latencies.back() * 1e6 << " us" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::cout << "libaqua2 / SerialPort benchmark" << std::endl;
+  const size_t scale = argc > 1 ? atoi(argv[1]) : 1;
+
+  VirtualSerialPair pair(115200);
+  benchThroughput(pair, scale * (16 << 20));
+  benchTimeoutRead(pair, scale * (4 << 20), 64);
+  benchReadLine(pair, scale * 20000, false);
+  benchReadLine(pair, scale * 20000, true);
+  benchRoundTrip(pair, scale * 2000);
+  return(0);
+}
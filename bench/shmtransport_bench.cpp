@@ -0,0 +1,105 @@
+/********************************************************
+ * shmtransport_bench.cpp
+ *
+ * Round trip of 64 byte messages between two threads:
+ * ShmPublisher / ShmSubscriber (futex, busy poll) against
+ * Unix domain and TCP loopback sockets.
+ *
+ * usage: shmtransport_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <thread>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+
+#include "aqua2/shmtransport.h"
+#include "aqua2/serversocket.h"
+#include "aqua2/inputlatency.h"
+
+using namespace ssr::aqua2;
+
+const static int MESSAGE_SIZE = 64;
+
+static void print(const char* name, const int count, const uint64_t elapsed, const LatencyHistogram& rtt) {
+  const LatencyHistogramSnapshot s = rtt.snapshot();
+  std::cout << name << ": " << count * 1e9 / elapsed << " round trips/s, p50 " << s.percentile(0.5)
+	    << " ns, p99 " << s.percentile(0.99) << " ns" << std::endl;
+}
+
+static void shm(const char* name, const int count, const uint64_t busyPoll) {
+  ShmPublisher ping("", MESSAGE_SIZE, 64), pong("", MESSAGE_SIZE, 64);
+  ShmSubscriber pingSub(ping.getFileDescriptor()), pongSub(pong.getFileDescriptor());
+  pingSub.setBusyPoll(busyPoll);
+  pongSub.setBusyPoll(busyPoll);
+  std::thread echo([&]() {
+      for (int i = 0; i < count; i++) {
+	uint32_t size;
+	const void* p;
+	while (!(p = pingSub.receive(size))) pingSub.wait(-1);
+	memcpy(pong.allocate(), p, size); // one copy, from ring to ring
+	pingSub.release();
+	pong.commit(size);
+      }
+    });
+  LatencyHistogram rtt;
+  uint8_t msg[MESSAGE_SIZE] = {0};
+  const uint64_t start = InputLatencyMonitor::now();
+  for (int i = 0; i < count; i++) {
+    const uint64_t t = InputLatencyMonitor::now();
+    ping.write(msg, sizeof(msg));
+    while (pongSub.read(msg, sizeof(msg)) == 0) pongSub.wait(-1);
+    rtt.add(InputLatencyMonitor::now() - t);
+  }
+  print(name, count, InputLatencyMonitor::now() - start, rtt);
+  echo.join();
+}
+
+static void stream(const char* name, const int count, const int a, const int b) {
+  std::thread echo([&]() {
+      uint8_t buf[MESSAGE_SIZE];
+      for (int i = 0; i < count; i++) {
+	for (int n = 0; n < MESSAGE_SIZE; ) n += ::recv(b, buf + n, MESSAGE_SIZE - n, 0);
+	::send(b, buf, MESSAGE_SIZE, 0);
+      }
+    });
+  LatencyHistogram rtt;
+  uint8_t msg[MESSAGE_SIZE] = {0};
+  const uint64_t start = InputLatencyMonitor::now();
+  for (int i = 0; i < count; i++) {
+    const uint64_t t = InputLatencyMonitor::now();
+    ::send(a, msg, sizeof(msg), 0);
+    for (int n = 0; n < MESSAGE_SIZE; ) n += ::recv(a, msg + n, MESSAGE_SIZE - n, 0);
+    rtt.add(InputLatencyMonitor::now() - t);
+  }
+  print(name, count, InputLatencyMonitor::now() - start, rtt);
+  echo.join();
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int count = 20000 * scale;
+
+  shm("shm futex         ", count, 0);
+  shm("shm busy poll 50us", count, 50000);
+  if (std::thread::hardware_concurrency() < 2) std::cout << "(one CPU: busy poll spins against its peer)" << std::endl;
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return(1);
+  stream("unix socket       ", count, fds[0], fds[1]);
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  Socket client("127.0.0.1", server.getPort());
+  Socket peer = server.accept();
+  const int one = 1;
+  setsockopt(client.getFileDescriptor(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  setsockopt(peer.getFileDescriptor(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  stream("tcp loopback      ", count, client.getFileDescriptor(), peer.getFileDescriptor());
+  client.close();
+  peer.close();
+  return(0);
+}
@@ -0,0 +1,86 @@
+/********************************************************
+ * terminalscreen_bench.cpp
+ *
+ * 80 x 24 teleoperation dashboard redrawn every frame:
+ * system("clear") + full reprint vs TerminalScreen diff.
+ * Bytes, write() calls and time per frame.
+ *
+ * usage: terminalscreen_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#include "aqua2/terminalscreen.h"
+
+using namespace ssr::aqua2;
+
+static uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double cpuSeconds(const int who) {
+  struct rusage usage;
+  getrusage(who, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+/// 24 lines: title, 8 axes, 12 buttons, status. A few values change every frame.
+static void line(char* buf, const size_t size, const int y, const int frame) {
+  if (y == 0) snprintf(buf, size, "aqua2 teleop  frame %8d", frame);
+  else if (y <= 8) snprintf(buf, size, "axis %d  % .3f", y - 1, ((frame * (y + 1)) % 2000 - 1000) / 1000.0);
+  else if (y <= 20) snprintf(buf, size, "button %2d  %s", y - 9, ((frame / 20 + y) % 7 == 0) ? "ON " : "off");
+  else snprintf(buf, size, "link ok  latency %4d us", 500 + frame % 50);
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int null = open("/dev/null", O_WRONLY);
+  char buf[96];
+
+  /// legacy: clear by a shell, then print everything
+  const int legacyFrames = 20 * scale;
+  FILE* out = fdopen(dup(null), "w");
+  uint64_t legacyBytes = 0;
+  double cpu = cpuSeconds(RUSAGE_SELF) + cpuSeconds(RUSAGE_CHILDREN);
+  uint64_t start = now();
+  for (int f = 0; f < legacyFrames; f++) {
+    if (system("clear > /dev/null 2>&1") < 0) return(1);
+    for (int y = 0; y < 24; y++) {
+      line(buf, sizeof(buf), y, f);
+      legacyBytes += fprintf(out, "%-79s\n", buf);
+    }
+    fflush(out);
+  }
+  const double legacyNs = (double)(now() - start) / legacyFrames;
+  const double legacyCpu = (cpuSeconds(RUSAGE_SELF) + cpuSeconds(RUSAGE_CHILDREN) - cpu) / legacyFrames;
+  fclose(out);
+
+  /// TerminalScreen
+  const int frames = 20000 * scale;
+  TerminalScreen screen(null, -1, 80, 24);
+  screen.present();
+  const uint64_t bytes0 = screen.getBytesWritten(), writes0 = screen.getWrites();
+  cpu = cpuSeconds(RUSAGE_SELF);
+  start = now();
+  for (int f = 0; f < frames; f++) {
+    screen.clear();
+    for (int y = 0; y < 24; y++) {
+      line(buf, sizeof(buf), y, f);
+      screen.print(0, y, buf, y == 0 ? TerminalStyle(TerminalStyle::CYAN, TerminalStyle::DEFAULT, TerminalStyle::BOLD) : TerminalStyle());
+    }
+    screen.present();
+  }
+  const double screenNs = (double)(now() - start) / frames;
+  const double screenCpu = (cpuSeconds(RUSAGE_SELF) - cpu) / frames;
+
+  std::cout << "system(\"clear\") + reprint: " << (double)legacyBytes / legacyFrames << " bytes, "
+	    << "1 fork/exec + 1 write() per frame, " << legacyNs / 1000 << " us/frame (cpu " << legacyCpu * 1e6 << " us)" << std::endl;
+  std::cout << "TerminalScreen:            " << (double)(screen.getBytesWritten() - bytes0) / frames << " bytes, "
+	    << (double)(screen.getWrites() - writes0) / frames << " write() per frame, " << screenNs / 1000 << " us/frame (cpu "
+	    << screenCpu * 1e6 << " us)" << std::endl;
+  std::cout << "at 20 Hz: " << legacyCpu * 20 * 100 << " % vs " << screenCpu * 20 * 100 << " % of a core" << std::endl;
+  return(0);
+}
@@ -0,0 +1,73 @@
+/********************************************************
+ * waitstrategy_bench.cpp
+ *
+ * Wake up latency (write of the sender to return of
+ * waitAvailable()) of SerialPort (pty) and Socket (Unix
+ * domain) reads with each WaitStrategy.
+ *
+ * usage: waitstrategy_bench [scale]
+ ********************************************************/
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <sys/socket.h>
+
+#include "aqua2/serialport.h"
+#include "aqua2/socket.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+/// Sender writes its clock every 200 - 700 usec, receiver measures when it wakes up.
+template<typename Port, typename Write>
+static void measure(const char* name, Port& port, Write write, const uint64_t spinTime, const int count) {
+  WaitStrategy strategy(spinTime);
+  port.setWaitStrategy(&strategy);
+  LatencyHistogram wakeup;
+  std::thread sender([&]() {
+      for (int i = 0; i < count; i++) {
+	std::this_thread::sleep_for(std::chrono::microseconds(200 + (i * 7919) % 500));
+	const uint64_t now = WaitStrategy::now();
+	write(&now, sizeof(now));
+      }
+    });
+  for (int i = 0; i < count; i++) {
+    if (port.waitAvailable(sizeof(uint64_t), 1.0) != 0) break;
+    const uint64_t woken = WaitStrategy::now();
+    uint64_t sent;
+    port.read(&sent, sizeof(sent));
+    wakeup.add(woken - sent);
+  }
+  sender.join();
+  const LatencyHistogramSnapshot w = wakeup.snapshot();
+  const WaitStatistics s = strategy.snapshot();
+  std::cout << name << ": wake up p50 " << w.percentile(0.5) << " ns, p99 " << w.percentile(0.99) << " ns, p999 "
+	    << w.percentile(0.999) << " ns, spun " << s.spun << ", parked " << s.parked << std::endl;
+  port.setWaitStrategy(nullptr);
+}
+
+int main(int argc, char* argv[]) {
+  const int scale = argc > 1 ? atoi(argv[1]) : 1;
+  const int count = 2000 * scale;
+  const uint64_t spins[] = {0, 20000, 1000000, WaitStrategy::SPIN_FOREVER};
+  const char* serialNames[] = {"serial park       ", "serial spin 20us  ", "serial spin 1ms   ", "serial spin always"};
+  const char* socketNames[] = {"socket park       ", "socket spin 20us  ", "socket spin 1ms   ", "socket spin always"};
+  if (std::thread::hardware_concurrency() < 2) std::cout << "(one CPU: spinning delays the sender)" << std::endl;
+
+  VirtualSerialPair serial(115200);
+  for (int i = 0; i < 4; i++) {
+    measure(serialNames[i], serial.second(), [&](const void* p, size_t n) { serial.first().write(p, n); }, spins[i], count);
+  }
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return(1);
+  struct sockaddr_in addr;
+  Socket socket(fds[0], addr);
+  for (int i = 0; i < 4; i++) {
+    measure(socketNames[i], socket, [&](const void* p, size_t n) { if (::send(fds[1], p, n, 0) < 0) {} }, spins[i], count);
+  }
+  ::close(fds[0]);
+  ::close(fds[1]);
+  return(0);
+}
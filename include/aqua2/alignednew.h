@@ -0,0 +1,61 @@
+/********************************************************
+ * alignednew.h
+ *
+ * Heap allocation honouring alignas() of a class before
+ * C++17.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * AlignedNew
+     *
+     * @brief Base class giving T an operator new aligned to alignof(T).
+     *
+     * Plain new of C++14 aligns to alignof(std::max_align_t) (16) only,
+     * so cache line aligned members (eg., of SpscRing and SeqLock) of an
+     * object on the heap may share lines with their neighbours. Classes
+     * allocated by the library and having such members derive from this.
+     *
+     * Usage:
+     *   class GamePad : public AlignedNew<GamePad> { ... };
+     *   GamePad* pad = new GamePad(path);  // 64 bytes aligned
+     ***************************************************/
+    template<typename T>
+    class AlignedNew {
+    public:
+      static void* operator new(const size_t size) {
+	void* p = nullptr;
+#ifdef WIN32
+	p = _aligned_malloc(size, alignof(T));
+#else
+	if (posix_memalign(&p, alignof(T) < sizeof(void*) ? sizeof(void*) : alignof(T), size) != 0) p = nullptr;
+#endif
+	if (!p) throw std::bad_alloc();
+	return p;
+      }
+
+      static void operator delete(void* p) {
+#ifdef WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,224 @@
+/********************************************************
+ * axisconditioner.h
+ *
+ * Per-axis conditioning of GamePad axes: calibration,
+ * radial / axial deadzones, expo curve and EMA / one-euro
+ * filtering.
+ *
+ * Parameters and filter states are kept as structure of
+ * arrays and every stage is a branch-free loop over all
+ * axes, so compilers vectorize it. Nothing is allocated.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <math.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * AxisConditioner
+     *
+     * @brief Conditions up to MAX_AXES normalized axes ([-1, 1]) at once.
+     *
+     * Stages (in order):
+     *   1. calibration : measured min / center / max to [-1, 1]
+     *   2. radial deadzone of stick pairs (x, y) by vector length
+     *   3. axial deadzone and saturation
+     *   4. expo curve  : (1 - e) * x + e * x^3
+     *   5. filter      : none, EMA, or one-euro (speed adaptive low-pass)
+     *
+     * Usage:
+     *   AxisConditioner conditioner;
+     *   conditioner.setRadialDeadzone(0, 1, 0.08f);
+     *   conditioner.setExpo(0, 0.3f);
+     *   conditioner.setOneEuro(0, 1.0f, 0.5f);
+     *   pad.setAxisConditioner(&conditioner);
+     ***************************************************/
+    class AxisConditioner {
+    public:
+      const static int MAX_AXES = 32;
+      const static int MAX_PAIRS = MAX_AXES / 2;
+
+    private:
+      alignas(32) float min_[MAX_AXES];
+      alignas(32) float center_[MAX_AXES];
+      alignas(32) float negativeGain_[MAX_AXES];  ///< 1 / (center - min)
+      alignas(32) float positiveGain_[MAX_AXES];  ///< 1 / (max - center)
+      alignas(32) float deadzone_[MAX_AXES];
+      alignas(32) float rangeGain_[MAX_AXES];     ///< 1 / (saturation - deadzone)
+      alignas(32) float expo_[MAX_AXES];
+      alignas(32) float oneEuro_[MAX_AXES];       ///< 1 for one-euro, 0 for EMA / none
+      alignas(32) float alpha_[MAX_AXES];         ///< EMA smoothing factor (1 = no filter)
+      alignas(32) float minCutoff_[MAX_AXES];
+      alignas(32) float beta_[MAX_AXES];
+      alignas(32) float derivativeCutoff_[MAX_AXES];
+      alignas(32) float value_[MAX_AXES];         ///< filter state
+      alignas(32) float derivative_[MAX_AXES];    ///< one-euro state
+      alignas(32) float previous_[MAX_AXES];      ///< unfiltered input at previous process()
+
+      int pairX_[MAX_PAIRS];
+      int pairY_[MAX_PAIRS];
+      float pairDeadzone_[MAX_PAIRS];
+      float pairGain_[MAX_PAIRS];
+      int numPairs_;
+      bool initialized_;
+
+      static float clamp(const float v, const float lo, const float hi) {
+	return v < lo ? lo : (v > hi ? hi : v); // no fminf / fmaxf: they are library calls without -ffast-math
+      }
+
+    public:
+      AxisConditioner() : numPairs_(0), initialized_(false) {
+	for (int i = 0; i < MAX_AXES; i++) {
+	  setCalibration(i, -1.0f, 0.0f, 1.0f);
+	  setDeadzone(i, 0.0f);
+	  setExpo(i, 0.0f);
+	  disableFilter(i);
+	}
+	reset();
+      }
+
+    public:
+      /**
+       * @brief Map measured min / center / max of axis i to -1 / 0 / 1.
+       */
+      void setCalibration(const int i, const float min, const float center, const float max) {
+	min_[i] = min;
+	center_[i] = center;
+	negativeGain_[i] = center > min ? 1.0f / (center - min) : 0.0f;
+	positiveGain_[i] = max > center ? 1.0f / (max - center) : 0.0f;
+      }
+
+      /**
+       * @brief Axial deadzone. |x| <= deadzone is 0, |x| >= saturation is 1, linear between.
+       */
+      void setDeadzone(const int i, const float deadzone, const float saturation = 1.0f) {
+	deadzone_[i] = deadzone;
+	rangeGain_[i] = saturation > deadzone ? 1.0f / (saturation - deadzone) : 0.0f;
+      }
+
+      /**
+       * @brief Radial deadzone of stick (x, y) applied to vector length, keeping direction.
+       *        Axial deadzone of x and y is reset to none.
+       */
+      void setRadialDeadzone(const int x, const int y, const float deadzone, const float saturation = 1.0f) {
+	int p = 0;
+	while (p < numPairs_ && !(pairX_[p] == x && pairY_[p] == y)) p++;
+	if (p == MAX_PAIRS) return;
+	if (p == numPairs_) numPairs_++;
+	pairX_[p] = x;
+	pairY_[p] = y;
+	pairDeadzone_[p] = deadzone;
+	pairGain_[p] = saturation > deadzone ? 1.0f / (saturation - deadzone) : 0.0f;
+	setDeadzone(x, 0.0f);
+	setDeadzone(y, 0.0f);
+      }
+
+      /**
+       * @brief 0 is linear, 1 is cubic.
+       */
+      void setExpo(const int i, const float expo) { expo_[i] = expo; }
+
+      /**
+       * @brief Exponential moving average. value += alpha * (input - value).
+       */
+      void setEma(const int i, const float alpha) {
+	oneEuro_[i] = 0.0f;
+	alpha_[i] = alpha;
+      }
+
+      /**
+       * @brief One-euro filter (Casiez et al.). Cutoff frequency [Hz] is minCutoff + beta * |speed|.
+       */
+      void setOneEuro(const int i, const float minCutoff, const float beta, const float derivativeCutoff = 1.0f) {
+	oneEuro_[i] = 1.0f;
+	alpha_[i] = 1.0f;
+	minCutoff_[i] = minCutoff;
+	beta_[i] = beta;
+	derivativeCutoff_[i] = derivativeCutoff;
+      }
+
+      void disableFilter(const int i) {
+	oneEuro_[i] = 0.0f;
+	alpha_[i] = 1.0f;
+	minCutoff_[i] = 1.0f;
+	beta_[i] = 0.0f;
+	derivativeCutoff_[i] = 1.0f;
+      }
+
+      /**
+       * @brief Clear filter states. Next process() starts from its input.
+       */
+      void reset() {
+	for (int i = 0; i < MAX_AXES; i++) value_[i] = derivative_[i] = previous_[i] = 0.0f;
+	initialized_ = false;
+      }
+
+      /**
+       * @brief Condition n (<= MAX_AXES) axes. in and out may be the same.
+       * @param dt seconds since previous process(). 0 or less restarts the filters.
+       */
+      void process(const float* in, float* out, const int n, const float dt) {
+	alignas(32) float x[MAX_AXES];
+	const int count = n < MAX_AXES ? n : MAX_AXES;
+	for (int i = 0; i < count; i++) x[i] = in[i];
+	for (int i = count; i < MAX_AXES; i++) x[i] = 0.0f;
+
+	/// Stages run over all MAX_AXES (fixed trip count) to be vectorized.
+	/// 1. calibration
+	for (int i = 0; i < MAX_AXES; i++) {
+	  const float d = x[i] - center_[i];
+	  const float gain = d < 0.0f ? negativeGain_[i] : positiveGain_[i];
+	  x[i] = clamp(d * gain, -1.0f, 1.0f);
+	}
+
+	/// 2. radial deadzone
+	for (int p = 0; p < numPairs_; p++) {
+	  const int a = pairX_[p], b = pairY_[p];
+	  if (a >= count || b >= count) continue;
+	  const float length = sqrtf(x[a] * x[a] + x[b] * x[b]);
+	  const float scaled = clamp((length - pairDeadzone_[p]) * pairGain_[p], 0.0f, 1.0f);
+	  const float k = length > 0.0f ? scaled / length : 0.0f;
+	  x[a] *= k;
+	  x[b] *= k;
+	}
+
+	/// 3. axial deadzone, 4. expo
+	for (int i = 0; i < MAX_AXES; i++) {
+	  const float magnitude = clamp((fabsf(x[i]) - deadzone_[i]) * rangeGain_[i], 0.0f, 1.0f);
+	  const float v = copysignf(magnitude, x[i]);
+	  x[i] = v * (1.0f - expo_[i] + expo_[i] * v * v);
+	}
+
+	/// 5. filter
+	if (!initialized_ || dt <= 0.0f) {
+	  for (int i = 0; i < count; i++) {
+	    value_[i] = previous_[i] = out[i] = x[i];
+	    derivative_[i] = 0.0f;
+	  }
+	  initialized_ = true;
+	  return;
+	}
+	const float rate = 1.0f / dt;
+	const float twoPiDt = 6.2831853f * dt;
+	for (int i = 0; i < MAX_AXES; i++) {
+	  const float speed = (x[i] - previous_[i]) * rate;
+	  const float derivativeAlpha = twoPiDt * derivativeCutoff_[i] / (1.0f + twoPiDt * derivativeCutoff_[i]);
+	  derivative_[i] += derivativeAlpha * (speed - derivative_[i]);
+	  const float cutoff = minCutoff_[i] + beta_[i] * fabsf(derivative_[i]);
+	  const float euroAlpha = twoPiDt * cutoff / (1.0f + twoPiDt * cutoff);
+	  const float alpha = oneEuro_[i] * euroAlpha + (1.0f - oneEuro_[i]) * alpha_[i];
+	  value_[i] += alpha * (x[i] - value_[i]);
+	  previous_[i] = x[i];
+	}
+	for (int i = 0; i < count; i++) out[i] = value_[i];
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
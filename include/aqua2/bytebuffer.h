@@ -0,0 +1,235 @@
+/********************************************************
+ * bytebuffer.h
+ *
+ * Pool backed byte buffer and non-owning byte view
+ * used by functional interfaces of libaqua2.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include <utility>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * ByteBufferPool
+     *
+     * @brief Per-thread size-class slab pool.
+     *
+     * Blocks are rounded up to power of two classes (64 bytes to 64 KiB)
+     * and recycled through per-class free lists, so that allocation
+     * and release in steady state never touch the heap.
+     * Blocks larger than the largest class are allocated directly.
+     ***************************************************/
+    class ByteBufferPool {
+    public:
+      const static size_t MIN_CLASS_SHIFT = 6;
+      const static size_t NUM_CLASSES = 11;
+      const static size_t MAX_FREE_BLOCKS = 64;
+
+      struct Block {
+	Block* next;
+	size_t sizeClass;  ///< NUM_CLASSES for oversized block
+	size_t capacity;
+	size_t reserved;   ///< keeps data 16 bytes aligned
+
+	uint8_t* data() { return (uint8_t*)(this + 1); }
+      };
+
+    private:
+      Block* free_[NUM_CLASSES];
+      size_t count_[NUM_CLASSES];
+
+      ByteBufferPool() {
+	for (size_t i = 0; i < NUM_CLASSES; i++) {
+	  free_[i] = nullptr;
+	  count_[i] = 0;
+	}
+      }
+
+    public:
+      ~ByteBufferPool() {
+	for (size_t i = 0; i < NUM_CLASSES; i++) {
+	  while (free_[i]) {
+	    Block* block = free_[i];
+	    free_[i] = block->next;
+	    ::operator delete(block);
+	  }
+	}
+      }
+
+      /**
+       * @brief Pool of current thread.
+       */
+      static ByteBufferPool& local() {
+	static thread_local ByteBufferPool pool;
+	return pool;
+      }
+
+      static size_t sizeClassOf(const size_t size) {
+	size_t c = 0;
+	while (c < NUM_CLASSES && ((size_t)1 << (c + MIN_CLASS_SHIFT)) < size) c++;
+	return c;
+      }
+
+    public:
+      Block* allocate(const size_t size) {
+	const size_t c = sizeClassOf(size);
+	if (c < NUM_CLASSES && free_[c]) {
+	  Block* block = free_[c];
+	  free_[c] = block->next;
+	  count_[c]--;
+	  return block;
+	}
+	const size_t capacity = c < NUM_CLASSES ? ((size_t)1 << (c + MIN_CLASS_SHIFT)) : size;
+	Block* block = (Block*)::operator new(sizeof(Block) + capacity);
+	block->next = nullptr;
+	block->sizeClass = c;
+	block->capacity = capacity;
+	return block;
+      }
+
+      void release(Block* block) {
+	const size_t c = block->sizeClass;
+	if (c >= NUM_CLASSES || count_[c] >= MAX_FREE_BLOCKS) {
+	  ::operator delete(block);
+	  return;
+	}
+	block->next = free_[c];
+	free_[c] = block;
+	count_[c]++;
+      }
+    };
+
+
+    /***************************************************
+     * ByteView
+     *
+     * @brief Non-owning view of contiguous bytes.
+     ***************************************************/
+    class ByteView {
+    private:
+      const uint8_t* data_;
+      size_t size_;
+
+    public:
+      ByteView() : data_(nullptr), size_(0) {}
+      ByteView(const void* data, const size_t size) : data_((const uint8_t*)data), size_(size) {}
+
+    public:
+      const uint8_t* data() const { return data_; }
+      size_t size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+      const uint8_t& operator[](const size_t i) const { return data_[i]; }
+      const uint8_t* begin() const { return data_; }
+      const uint8_t* end() const { return data_ + size_; }
+
+      /**
+       * @brief Sub view. Clamped to the end of this view.
+       */
+      ByteView slice(const size_t offset, const size_t length = (size_t)-1) const {
+	if (offset >= size_) return ByteView(data_ + size_, 0);
+	return ByteView(data_ + offset, length < size_ - offset ? length : size_ - offset);
+      }
+    };
+
+
+    /***************************************************
+     * ByteBuffer
+     *
+     * @brief Owning byte buffer allocated from ByteBufferPool.
+     *
+     * available() is false when the buffer represents failure
+     * of functional interfaces (eg., read(port, length)).
+     ***************************************************/
+    class ByteBuffer {
+    private:
+      ByteBufferPool::Block* block_;
+      size_t size_;
+      bool _available;
+
+    public:
+      bool available() const { return _available; }
+
+    public:
+      ByteBuffer(const bool flag) : block_(nullptr), size_(0), _available(flag) {}
+
+      ByteBuffer(const size_t size) : block_(size ? ByteBufferPool::local().allocate(size) : nullptr), size_(size), _available(true) {}
+
+      ByteBuffer(const void* src, const size_t size) : ByteBuffer(size) {
+	if (size) memcpy(data(), src, size);
+      }
+
+      ByteBuffer(const ByteBuffer& buffer) : ByteBuffer(buffer.data(), buffer.size()) {
+	_available = buffer._available;
+      }
+
+      ByteBuffer(ByteBuffer&& buffer) : block_(buffer.block_), size_(buffer.size_), _available(buffer._available) {
+	buffer.block_ = nullptr;
+	buffer.size_ = 0;
+      }
+
+      ~ByteBuffer() {
+	if (block_) ByteBufferPool::local().release(block_);
+      }
+
+      ByteBuffer& operator=(const ByteBuffer& buffer) {
+	if (this == &buffer) return *this;
+	resize(buffer.size());
+	if (size_) memcpy(data(), buffer.data(), size_);
+	_available = buffer._available;
+	return *this;
+      }
+
+      ByteBuffer& operator=(ByteBuffer&& buffer) {
+	std::swap(block_, buffer.block_);
+	std::swap(size_, buffer.size_);
+	_available = buffer._available;
+	return *this;
+      }
+
+    public:
+      uint8_t* data() { return block_ ? block_->data() : nullptr; }
+      const uint8_t* data() const { return block_ ? block_->data() : nullptr; }
+      size_t size() const { return size_; }
+      size_t capacity() const { return block_ ? block_->capacity : 0; }
+      bool empty() const { return size_ == 0; }
+
+      uint8_t& operator[](const size_t i) { return data()[i]; }
+      const uint8_t& operator[](const size_t i) const { return data()[i]; }
+      uint8_t& front() { return data()[0]; }
+      const uint8_t& front() const { return data()[0]; }
+      uint8_t* begin() { return data(); }
+      uint8_t* end() { return data() + size_; }
+      const uint8_t* begin() const { return data(); }
+      const uint8_t* end() const { return data() + size_; }
+
+      /**
+       * @brief Change size. Contents are kept. No allocation within capacity().
+       */
+      void resize(const size_t size) {
+	if (size > capacity()) {
+	  ByteBufferPool::Block* block = ByteBufferPool::local().allocate(size);
+	  if (size_) memcpy(block->data(), data(), size_);
+	  if (block_) ByteBufferPool::local().release(block_);
+	  block_ = block;
+	}
+	size_ = size;
+      }
+
+      ByteView view() const { return ByteView(data(), size_); }
+
+      ByteView slice(const size_t offset, const size_t length = (size_t)-1) const { return view().slice(offset, length); }
+
+      operator ByteView() const { return view(); }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,350 @@
+/********************************************************
+ * codec.h
+ *
+ * Compile-time binary message codec for Socket and SerialPort.
+ *
+ * A message is declared once as a list of fields. Offsets and
+ * total size are computed at compile time, and encode / decode
+ * are straight-line unaligned moves, byte swapped only when the
+ * field order differs from the host.
+ *
+ *   struct ServoCommand { uint8_t id; int16_t position; float speed; };
+ *   typedef MessageCodec<ServoCommand,
+ *                        MessageConstant<uint8_t, 0xAA>,
+ *                        AQUA2_FIELD(ServoCommand, id),
+ *                        AQUA2_FIELD_BE(ServoCommand, position),
+ *                        AQUA2_FIELD(ServoCommand, speed)> ServoCommandCodec;
+ *   typedef CheckedCodec<ServoCommandCodec, Crc16Modbus> ServoCommandFrame;
+ *
+ *   uint8_t buf[ServoCommandFrame::SIZE];
+ *   ServoCommandFrame::encode(command, buf);
+ *   writeMessage<ServoCommandFrame>(port, command);
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "bytebuffer.h"
+
+namespace ssr {
+  namespace aqua2 {
+
+    struct LittleEndian {};
+    struct BigEndian {};
+
+    namespace detail {
+
+      /// Unsigned integer type holding bit pattern of T
+      template<typename T, bool = std::is_enum<T>::value> struct BitsOf {
+	typedef typename std::make_unsigned<T>::type type;
+      };
+      template<typename T> struct BitsOf<T, true> {
+	typedef typename std::make_unsigned<typename std::underlying_type<T>::type>::type type;
+      };
+      template<> struct BitsOf<bool, false> { typedef uint8_t type; };
+      template<> struct BitsOf<float, false> { typedef uint32_t type; };
+      template<> struct BitsOf<double, false> { typedef uint64_t type; };
+
+      inline uint8_t byteSwap(const uint8_t v) { return v; }
+#if defined(__GNUC__) || defined(__clang__)
+      inline uint16_t byteSwap(const uint16_t v) { return __builtin_bswap16(v); }
+      inline uint32_t byteSwap(const uint32_t v) { return __builtin_bswap32(v); }
+      inline uint64_t byteSwap(const uint64_t v) { return __builtin_bswap64(v); }
+#else
+      inline uint16_t byteSwap(const uint16_t v) { return (uint16_t)((v >> 8) | (v << 8)); }
+      inline uint32_t byteSwap(const uint32_t v) { return ((uint32_t)byteSwap((uint16_t)v) << 16) | byteSwap((uint16_t)(v >> 16)); }
+      inline uint64_t byteSwap(const uint64_t v) { return ((uint64_t)byteSwap((uint32_t)v) << 32) | byteSwap((uint32_t)(v >> 32)); }
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      typedef BigEndian HostEndian;
+#else
+      typedef LittleEndian HostEndian;
+#endif
+
+      /// Identity when Endian is host byte order, byte swap otherwise. Resolved at compile time.
+      template<typename U> inline U toEndian(const U v, HostEndian) { return v; }
+      template<typename U, typename Endian> inline U toEndian(const U v, Endian) { return byteSwap(v); }
+
+      /// Unaligned store / load. memcpy of fixed size compiles to single mov.
+      template<typename U, typename Endian> inline void store(uint8_t* p, const U v, Endian) {
+	const U u = toEndian(v, Endian());
+	memcpy(p, &u, sizeof(U));
+      }
+
+      template<typename U, typename Endian> inline U load(const uint8_t* p, Endian) {
+	U u;
+	memcpy(&u, p, sizeof(U));
+	return toEndian(u, Endian());
+      }
+
+      template<typename T, typename Endian> struct ScalarCodec {
+	static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "MessageField supports arithmetic, enum and array of them");
+	typedef typename BitsOf<T>::type bits_type;
+	static_assert(sizeof(bits_type) == sizeof(T), "unsupported field type");
+	static const size_t SIZE = sizeof(T);
+
+	static void encode(uint8_t* p, const T& v) {
+	  bits_type u;
+	  memcpy(&u, &v, sizeof(u));
+	  store<bits_type>(p, u, Endian());
+	}
+
+	static void decode(const uint8_t* p, T& v) {
+	  const bits_type u = load<bits_type>(p, Endian());
+	  memcpy(&v, &u, sizeof(u));
+	}
+      };
+
+      template<typename T, size_t N, typename Endian> struct ScalarCodec<T[N], Endian> {
+	typedef ScalarCodec<T, Endian> element;
+	static const size_t SIZE = element::SIZE * N;
+
+	static void encode(uint8_t* p, const T (&v)[N]) {
+	  for (size_t i = 0; i < N; i++) element::encode(p + i * element::SIZE, v[i]);
+	}
+
+	static void decode(const uint8_t* p, T (&v)[N]) {
+	  for (size_t i = 0; i < N; i++) element::decode(p + i * element::SIZE, v[i]);
+	}
+      };
+
+      template<size_t Offset, typename... Fields> struct FieldList;
+
+      template<size_t Offset> struct FieldList<Offset> {
+	static const size_t SIZE = 0;
+	template<typename C> static void encode(uint8_t*, const C&) {}
+	template<typename C> static void decode(const uint8_t*, C&) {}
+      };
+
+      template<size_t Offset, typename F, typename... Rest> struct FieldList<Offset, F, Rest...> {
+	typedef FieldList<Offset + F::SIZE, Rest...> next;
+	static const size_t SIZE = F::SIZE + next::SIZE;
+
+	template<typename C> static void encode(uint8_t* p, const C& m) {
+	  F::encode(p + Offset, m);
+	  next::encode(p, m);
+	}
+
+	template<typename C> static void decode(const uint8_t* p, C& m) {
+	  F::decode(p + Offset, m);
+	  next::decode(p, m);
+	}
+      };
+
+      template<size_t I, typename... Fields> struct OffsetOf;
+      template<typename F, typename... Rest> struct OffsetOf<0, F, Rest...> {
+	static const size_t value = 0;
+      };
+      template<size_t I, typename F, typename... Rest> struct OffsetOf<I, F, Rest...> {
+	static const size_t value = F::SIZE + OffsetOf<I - 1, Rest...>::value;
+      };
+
+    } // namespace detail
+
+
+    /**
+     * @brief Field bound to member of message struct C.
+     *
+     * T is arithmetic, enum or array of them. Use AQUA2_FIELD / AQUA2_FIELD_BE.
+     */
+    template<typename C, typename T, T C::*Member, typename Endian = LittleEndian>
+    struct MessageField {
+      typedef detail::ScalarCodec<T, Endian> codec;
+      static const size_t SIZE = codec::SIZE;
+
+      static void encode(uint8_t* p, const C& m) { codec::encode(p, m.*Member); }
+      static void decode(const uint8_t* p, C& m) { codec::decode(p, m.*Member); }
+    };
+
+#define AQUA2_FIELD(C, member) ::ssr::aqua2::MessageField<C, decltype(C::member), &C::member>
+#define AQUA2_FIELD_BE(C, member) ::ssr::aqua2::MessageField<C, decltype(C::member), &C::member, ::ssr::aqua2::BigEndian>
+
+    /**
+     * @brief Constant (eg., header, message type). Not checked by decode.
+     */
+    template<typename T, T Value, typename Endian = LittleEndian>
+    struct MessageConstant {
+      typedef detail::ScalarCodec<T, Endian> codec;
+      static const size_t SIZE = codec::SIZE;
+
+      template<typename C> static void encode(uint8_t* p, const C&) { codec::encode(p, Value); }
+      template<typename C> static void decode(const uint8_t*, C&) {}
+    };
+
+    /**
+     * @brief N zero bytes. Skipped by decode.
+     */
+    template<size_t N>
+    struct MessagePadding {
+      static const size_t SIZE = N;
+
+      template<typename C> static void encode(uint8_t* p, const C&) { memset(p, 0, N); }
+      template<typename C> static void decode(const uint8_t*, C&) {}
+    };
+
+
+    /***************************************************
+     * MessageCodec
+     *
+     * @brief Encoder / decoder of message C with fixed layout Fields.
+     ***************************************************/
+    template<typename C, typename... Fields>
+    struct MessageCodec {
+      typedef C message_type;
+      typedef detail::FieldList<0, Fields...> fields;
+
+      /// Encoded size in bytes
+      static const size_t SIZE = fields::SIZE;
+
+      /// Byte offset of I-th field
+      template<size_t I> static constexpr size_t offset() { return detail::OffsetOf<I, Fields...>::value; }
+
+      /**
+       * @brief Encode into dst which has at least SIZE bytes.
+       */
+      static void encode(const C& m, uint8_t* dst) { fields::encode(dst, m); }
+
+      template<size_t N> static void encode(const C& m, uint8_t (&dst)[N]) {
+	static_assert(N >= SIZE, "buffer is smaller than message");
+	fields::encode(&dst[0], m);
+      }
+
+      static void encode(const C& m, ByteBuffer& dst) {
+	dst.resize(SIZE);
+	fields::encode(dst.data(), m);
+      }
+
+      /**
+       * @brief Decode from src which has at least SIZE bytes.
+       */
+      static void decode(const uint8_t* src, C& m) { fields::decode(src, m); }
+
+      template<size_t N> static void decode(const uint8_t (&src)[N], C& m) {
+	static_assert(N >= SIZE, "buffer is smaller than message");
+	fields::decode(&src[0], m);
+      }
+
+      /**
+       * @return false if src is shorter than SIZE.
+       */
+      static bool decode(const ByteView& src, C& m) {
+	if (src.size() < SIZE) return false;
+	fields::decode(src.data(), m);
+	return true;
+      }
+    };
+
+
+    /**
+     * @brief CRC-16/MODBUS trailer (little endian).
+     */
+    struct Crc16Modbus {
+      static const size_t SIZE = 2;
+
+      struct Table {
+	uint16_t t[256];
+	constexpr Table() : t() {
+	  for (int i = 0; i < 256; i++) {
+	    uint16_t c = (uint16_t)i;
+	    for (int b = 0; b < 8; b++) c = (c & 1) ? (uint16_t)((c >> 1) ^ 0xA001) : (uint16_t)(c >> 1);
+	    t[i] = c;
+	  }
+	}
+      };
+
+      static uint16_t compute(const uint8_t* p, const size_t size) {
+	static constexpr Table table;
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < size; i++) crc = (crc >> 8) ^ table.t[(crc ^ p[i]) & 0xFF];
+	return crc;
+      }
+
+      static void append(uint8_t* p, const size_t size) { detail::store<uint16_t>(p + size, compute(p, size), LittleEndian()); }
+      static bool verify(const uint8_t* p, const size_t size) { return detail::load<uint16_t>(p + size, LittleEndian()) == compute(p, size); }
+    };
+
+    /**
+     * @brief CRC-32 (IEEE 802.3) trailer (little endian).
+     */
+    struct Crc32 {
+      static const size_t SIZE = 4;
+
+      struct Table {
+	uint32_t t[256];
+	constexpr Table() : t() {
+	  for (uint32_t i = 0; i < 256; i++) {
+	    uint32_t c = i;
+	    for (int b = 0; b < 8; b++) c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : c >> 1;
+	    t[i] = c;
+	  }
+	}
+      };
+
+      static uint32_t compute(const uint8_t* p, const size_t size) {
+	static constexpr Table table;
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++) crc = (crc >> 8) ^ table.t[(crc ^ p[i]) & 0xFF];
+	return ~crc;
+      }
+
+      static void append(uint8_t* p, const size_t size) { detail::store<uint32_t>(p + size, compute(p, size), LittleEndian()); }
+      static bool verify(const uint8_t* p, const size_t size) { return detail::load<uint32_t>(p + size, LittleEndian()) == compute(p, size); }
+    };
+
+
+    /***************************************************
+     * CheckedCodec
+     *
+     * @brief MessageCodec followed by checksum trailer (eg., Crc16Modbus).
+     ***************************************************/
+    template<typename Codec, typename Checksum>
+    struct CheckedCodec {
+      typedef typename Codec::message_type message_type;
+      static const size_t SIZE = Codec::SIZE + Checksum::SIZE;
+
+      static void encode(const message_type& m, uint8_t* dst) {
+	Codec::encode(m, dst);
+	Checksum::append(dst, Codec::SIZE);
+      }
+
+      template<size_t N> static void encode(const message_type& m, uint8_t (&dst)[N]) {
+	static_assert(N >= SIZE, "buffer is smaller than message");
+	encode(m, &dst[0]);
+      }
+
+      static void encode(const message_type& m, ByteBuffer& dst) {
+	dst.resize(SIZE);
+	encode(m, dst.data());
+      }
+
+      /**
+       * @return false if src is too short or checksum does not match.
+       */
+      static bool decode(const ByteView& src, message_type& m) {
+	if (src.size() < SIZE || !Checksum::verify(src.data(), Codec::SIZE)) return false;
+	Codec::decode(src.data(), m);
+	return true;
+      }
+    };
+
+
+    /**
+     * @brief Encode message on stack and write to port (SerialPort, Socket or anything with write(const void*, size)).
+     * @return return value of port.write()
+     */
+    template<typename Codec, typename Port>
+    inline int writeMessage(Port& port, const typename Codec::message_type& m) {
+      uint8_t buf[Codec::SIZE];
+      Codec::encode(m, buf);
+      return port.write(buf, Codec::SIZE);
+    }
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,253 @@
+/********************************************************
+ * connectionexecutor.h
+ *
+ * Serves connections accepted by ServerSocket on a
+ * WorkStealingPool (Linux only).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include "serversocket.h"
+#include "workstealingpool.h"
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <string>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief This exception is thrown when ConnectionExecutor can not wait for the sockets.
+     */
+    class ConnectionExecutorException : public std::exception {
+    private:
+      std::string msg_;
+    public:
+      ConnectionExecutorException(const std::string& msg) : msg_(msg) {}
+      ~ConnectionExecutorException(void) throw() {}
+      const char* what() const throw() { return msg_.c_str(); }
+    };
+
+
+    /***************************************************
+     * ConnectionExecutor
+     *
+     * @brief Accepts connections and runs the handler of each readable one on a pool.
+     *
+     * One thread waits on the ServerSocket and every connection with epoll.
+     * A connection with input becomes a task of the WorkStealingPool, and
+     * is not watched (EPOLLONESHOT) until its handler returns, so handlers
+     * of one connection never run at the same time. Busy connections are
+     * spread over the pool threads and idle threads steal queued ones,
+     * instead of a thread per client sleeping most of the time.
+     *
+     * The handler is called when the socket has input (or was closed by
+     * the peer). It reads what is available without waiting for more, and
+     * returns false to close the connection (eg., read() returned 0). An
+     * exception thrown by it closes the connection too. Reply with
+     * Socket::tryWrite(): Socket::write() raises SIGPIPE (and kills the
+     * process) when the peer has already closed.
+     *
+     * Usage:
+     *   ServerSocket server;
+     *   server.bind(5000);
+     *   server.listen(64);
+     *   WorkStealingPool pool;
+     *   ConnectionExecutor executor(server, pool, [](Socket& socket) {
+     *     char buf[256];
+     *     const int n = socket.read(buf, sizeof(buf));
+     *     if (n <= 0) return false;
+     *     return socket.tryWrite(buf, n).valueOr(0) == n;
+     *   });
+     *   executor.start();
+     ***************************************************/
+    class ConnectionExecutor {
+    public:
+      typedef std::function<bool(Socket&)> Handler;
+
+      const static int MAX_EVENTS = 64;
+
+    private:
+      struct Connection {
+	Socket socket;
+	int fd;
+	Connection(const Socket& s) : socket(s), fd(s.getFileDescriptor()) {}
+      };
+
+      ServerSocket& server_;
+      WorkStealingPool& pool_;
+      Handler handler_;
+      int epoll_;
+      int wake_;
+      std::thread thread_;
+      std::atomic<bool> running_;
+      std::mutex mutex_;
+      std::set<Connection*> connections_;
+      std::atomic<int> serving_;
+      std::atomic<uint64_t> accepted_;
+      std::atomic<uint64_t> dispatched_;
+
+    public:
+      ConnectionExecutor(ServerSocket& server, WorkStealingPool& pool, const Handler& handler) :
+	server_(server), pool_(pool), handler_(handler), epoll_(-1), wake_(-1), running_(false), serving_(0), accepted_(0), dispatched_(0) {
+	if ((epoll_ = epoll_create1(EPOLL_CLOEXEC)) < 0) throw ConnectionExecutorException("epoll_create1 failed");
+	if ((wake_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+	  ::close(epoll_);
+	  throw ConnectionExecutorException("eventfd failed");
+	}
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = &wake_;
+	epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &ev);
+	ev.data.ptr = &server_;
+	if (epoll_ctl(epoll_, EPOLL_CTL_ADD, server_.getFileDescriptor(), &ev) < 0) {
+	  ::close(wake_);
+	  ::close(epoll_);
+	  throw ConnectionExecutorException("ServerSocket can not be watched");
+	}
+      }
+
+      /**
+       * @brief Stops and closes the connections. The ServerSocket is left open.
+       */
+      ~ConnectionExecutor() {
+	stop();
+	::close(wake_);
+	::close(epoll_);
+      }
+
+    private:
+      ConnectionExecutor(const ConnectionExecutor&);
+      ConnectionExecutor& operator=(const ConnectionExecutor&);
+
+    public:
+      /**
+       * @brief Start the thread accepting and dispatching connections.
+       */
+      void start() {
+	if (running_) return;
+	running_ = true;
+	thread_ = std::thread(&ConnectionExecutor::run, this);
+      }
+
+      /**
+       * @brief Stop accepting, wait for running handlers and close every connection.
+       */
+      void stop() {
+	if (running_) {
+	  running_ = false;
+	  const uint64_t one = 1;
+	  if (::write(wake_, &one, sizeof(one)) < 0) {}
+	  thread_.join();
+	}
+	while (serving_.load() > 0) std::this_thread::yield();
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (std::set<Connection*>::iterator it = connections_.begin(); it != connections_.end(); ++it) {
+	  epoll_ctl(epoll_, EPOLL_CTL_DEL, (*it)->fd, NULL);
+	  (*it)->socket.close();
+	  delete *it;
+	}
+	connections_.clear();
+      }
+
+      bool isRunning() const { return running_; }
+
+      /**
+       * @brief Connections open now.
+       */
+      size_t getConnections() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return connections_.size();
+      }
+
+      uint64_t getAccepted() const { return accepted_.load(std::memory_order_relaxed); }
+
+      /**
+       * @brief Handler calls submitted to the pool.
+       */
+      uint64_t getDispatched() const { return dispatched_.load(std::memory_order_relaxed); }
+
+    private:
+      void run() {
+	struct epoll_event events[MAX_EVENTS];
+	while (running_) {
+	  const int n = epoll_wait(epoll_, events, MAX_EVENTS, -1);
+	  if (n < 0) {
+	    if (errno == EINTR) continue;
+	    break;
+	  }
+	  for (int i = 0; i < n; i++) {
+	    void* p = events[i].data.ptr;
+	    if (p == &wake_) continue;
+	    if (p == &server_) {
+	      accept();
+	      continue;
+	    }
+	    Connection* c = (Connection*)p;
+	    serving_.fetch_add(1);
+	    dispatched_.fetch_add(1, std::memory_order_relaxed);
+	    pool_.submit([this, c]() { serve(c); });
+	  }
+	}
+      }
+
+      void accept() {
+	/// never blocks the dispatcher when the connection went away after epoll_wait()
+	Result<Socket> socket = server_.tryAccept(0);
+	if (!socket) return;
+	Connection* c = new Connection(socket.value());
+	{
+	  std::lock_guard<std::mutex> lock(mutex_);
+	  connections_.insert(c);
+	}
+	accepted_.fetch_add(1, std::memory_order_relaxed);
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	ev.data.ptr = c;
+	if (epoll_ctl(epoll_, EPOLL_CTL_ADD, c->fd, &ev) < 0) close(c);
+      }
+
+      void serve(Connection* c) {
+	bool keep = false;
+	try {
+	  keep = handler_(c->socket);
+	} catch (...) {
+	  keep = false; // eg., SocketException, bad_alloc: close, and never leave serving_ up
+	}
+	if (keep) {
+	  struct epoll_event ev;
+	  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	  ev.data.ptr = c;
+	  keep = epoll_ctl(epoll_, EPOLL_CTL_MOD, c->fd, &ev) == 0;
+	}
+	if (!keep) close(c);
+	serving_.fetch_sub(1);
+      }
+
+      void close(Connection* c) {
+	epoll_ctl(epoll_, EPOLL_CTL_DEL, c->fd, NULL);
+	{
+	  std::lock_guard<std::mutex> lock(mutex_);
+	  connections_.erase(c);
+	}
+	c->socket.close();
+	delete c;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifdef __linux__
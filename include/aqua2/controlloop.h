@@ -0,0 +1,370 @@
+/********************************************************
+ * controlloop.h
+ *
+ * Fixed-rate control loop running read / compute / write
+ * stages of GamePad, SerialPort and Socket (Linux only).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include "gamepad.h"
+#include "serialport.h"
+#include "socket.h"
+#include "histogram.h"
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief This exception is thrown when real-time settings of ControlLoop can not be applied.
+     */
+    class ControlLoopException : public std::exception {
+    private:
+      std::string msg_;
+    public:
+      ControlLoopException(const std::string& msg) : msg_(msg) {}
+      ~ControlLoopException(void) throw() {}
+      const char* what() const throw() { return msg_.c_str(); }
+    };
+
+    /**
+     * @brief Copy of ControlLoop statistics.
+     */
+    struct ControlLoopSnapshot {
+      uint64_t cycles;                     ///< cycles run
+      uint64_t overruns;                   ///< cycles whose stages finished after the next deadline
+      uint64_t skipped;                    ///< deadlines skipped after overruns
+      LatencyHistogramSnapshot jitter;     ///< wake up - deadline [ns]
+      LatencyHistogramSnapshot execution;  ///< wake up - end of the last stage [ns]
+      LatencyHistogramSnapshot overrun;    ///< end of the last stage - next deadline, of overrun cycles [ns]
+    };
+
+
+    /***************************************************
+     * ControlLoop
+     *
+     * @brief Runs registered stages every period at absolute deadlines.
+     *
+     * run() sleeps with clock_nanosleep(TIMER_ABSTIME) on CLOCK_MONOTONIC
+     * until each deadline, so the period does not drift with the time the
+     * stages take (as sleep_for() after the work does). Stages run in
+     * order READ, COMPUTE, WRITE, and in order of registration within a
+     * phase. A cycle which ends after the next deadline is an overrun;
+     * the deadlines already passed are skipped (keeping the phase) instead
+     * of being run back to back.
+     *
+     * Optional real-time settings are applied to the thread calling run()
+     * and restored when it returns:
+     *   - setRealtimePriority() : SCHED_FIFO (needs CAP_SYS_NICE or RLIMIT_RTPRIO)
+     *   - setCpuAffinity()      : pin to one CPU (isolcpus / nohz_full ones are the best)
+     *   - setLockMemory()       : mlockall() and prefault stack, no page fault in the loop
+     *   - setSpinMargin()       : wake this earlier and spin to the deadline
+     * A spin margin of 50 - 100 usec takes the timer wake up latency (tens
+     * of usec on a stock kernel) out of the jitter; SCHED_FIFO and a pinned
+     * CPU keep other threads from adding to its tail.
+     *
+     * Nothing is allocated in the loop. Statistics can be taken by
+     * snapshot() from any thread. An exception thrown by a stage ends run().
+     *
+     * Usage:
+     *   ControlLoop loop(1000);  // 1 kHz
+     *   loop.setRealtimePriority(80);
+     *   loop.addGamePad(pad);
+     *   loop.addSerialPort(port, [&](const uint8_t* data, int size) { parser.parse(data, size); });
+     *   loop.addStage(ControlLoop::COMPUTE, [&]() { controller.compute(pad.axis); });
+     *   loop.addStage(ControlLoop::WRITE, [&]() { port.write(command, sizeof(command)); });
+     *   loop.run();  // until loop.stop()
+     ***************************************************/
+    class ControlLoop {
+    public:
+      typedef std::function<void()> Stage;
+      typedef std::function<void(const uint8_t*, int)> ReadHandler;
+
+      const static int READ = 0;
+      const static int COMPUTE = 1;
+      const static int WRITE = 2;
+
+      const static int READ_BUFFER_SIZE = 256;
+      const static size_t PREFAULT_STACK_SIZE = 64 * 1024;
+
+    private:
+      struct Entry {
+	int phase;
+	Stage stage;
+      };
+
+      uint64_t period_;
+      uint64_t spinMargin_;
+      int priority_;
+      int cpu_;
+      bool lockMemory_;
+      std::vector<Entry> stages_;
+      std::atomic<bool> running_;
+      uint64_t deadline_;
+
+      std::atomic<uint64_t> cycles_;
+      std::atomic<uint64_t> overruns_;
+      std::atomic<uint64_t> skipped_;
+      LatencyHistogram jitter_;
+      LatencyHistogram execution_;
+      LatencyHistogram overrun_;
+
+    public:
+      /**
+       * @param frequency cycles per second [Hz]
+       */
+      ControlLoop(const double frequency) : spinMargin_(0), priority_(0), cpu_(-1), lockMemory_(false), running_(false), deadline_(0) {
+	setFrequency(frequency);
+	reset();
+      }
+
+    private:
+      ControlLoop(const ControlLoop&);
+      ControlLoop& operator=(const ControlLoop&);
+
+    public:
+      static uint64_t now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+      }
+
+      void setFrequency(const double frequency) {
+	if (frequency <= 0) throw ControlLoopException("frequency must be positive");
+	period_ = (uint64_t)(1e9 / frequency + 0.5);
+      }
+
+      /**
+       * @brief Period [ns].
+       */
+      uint64_t getPeriod() const { return period_; }
+
+      /**
+       * @brief Deadline of the current cycle (CLOCK_MONOTONIC ns). Use in stages instead of now() for a steady dt.
+       */
+      uint64_t getDeadline() const { return deadline_; }
+
+      /**
+       * @brief SCHED_FIFO priority (1 - 99) of the loop. 0 to leave the scheduler.
+       */
+      void setRealtimePriority(const int priority) { priority_ = priority; }
+
+      /**
+       * @brief CPU to pin the loop to. -1 to leave it.
+       */
+      void setCpuAffinity(const int cpu) { cpu_ = cpu; }
+
+      void setLockMemory(const bool lock) { lockMemory_ = lock; }
+
+      /**
+       * @brief Wake up margin [ns] before each deadline and busy-wait the rest. 0 to sleep only.
+       */
+      void setSpinMargin(const uint64_t margin) { spinMargin_ = margin; }
+
+      void addStage(const int phase, const Stage& stage) {
+	if (phase < READ || phase > WRITE) throw ControlLoopException("invalid phase");
+	if (running_) throw ControlLoopException("stages can not be added while running");
+	Entry e;
+	e.phase = phase;
+	e.stage = stage;
+	size_t i = stages_.size();
+	while (i > 0 && stages_[i - 1].phase > phase) i--;
+	stages_.insert(stages_.begin() + i, e);
+      }
+
+      /**
+       * @brief GamePad::update() in READ phase.
+       */
+      void addGamePad(GamePad& pad) {
+	addStage(READ, [&pad]() { pad.update(); });
+      }
+
+      /**
+       * @brief Bytes received by SerialPort to handler in READ phase, without blocking.
+       */
+      void addSerialPort(SerialPort& port, const ReadHandler& handler) {
+	std::vector<uint8_t> buffer(READ_BUFFER_SIZE);
+	addStage(READ, [&port, handler, buffer]() mutable {
+	    int available = port.getSizeInRxBuffer();
+	    while (available > 0) {
+	      const int n = port.read(&buffer[0], available < READ_BUFFER_SIZE ? available : READ_BUFFER_SIZE);
+	      if (n <= 0) break;
+	      handler(&buffer[0], n);
+	      available -= n;
+	    }
+	  });
+      }
+
+      /**
+       * @brief Bytes received by Socket to handler in READ phase, without blocking.
+       */
+      void addSocket(Socket& socket, const ReadHandler& handler) {
+	std::vector<uint8_t> buffer(READ_BUFFER_SIZE);
+	addStage(READ, [&socket, handler, buffer]() mutable {
+	    int available = socket.getSizeInRxBuffer();
+	    while (available > 0) {
+	      const int n = socket.read(&buffer[0], available < READ_BUFFER_SIZE ? available : READ_BUFFER_SIZE);
+	      if (n <= 0) break;
+	      handler(&buffer[0], n);
+	      available -= n;
+	    }
+	  });
+      }
+
+      /**
+       * @brief Run cycles until stop() (or the number of cycles if not 0).
+       */
+      void run(const uint64_t cycles = 0) {
+	Realtime realtime(*this);
+	running_ = true;
+	deadline_ = now() + period_;
+	try {
+	  for (uint64_t c = 0; running_ && (cycles == 0 || c < cycles); c++) {
+	    waitUntil(deadline_);
+	    const uint64_t wake = now();
+	    jitter_.add(wake - deadline_);
+	    for (size_t i = 0; i < stages_.size(); i++) stages_[i].stage();
+	    const uint64_t end = now();
+	    execution_.add(end - wake);
+	    relaxedIncrement(cycles_);
+
+	    deadline_ += period_;
+	    if (end > deadline_) {
+	      relaxedIncrement(overruns_);
+	      overrun_.add(end - deadline_);
+	      const uint64_t missed = (end - deadline_) / period_ + 1;
+	      relaxedIncrement(skipped_, missed);
+	      deadline_ += missed * period_;
+	    }
+	  }
+	} catch (...) {
+	  running_ = false;
+	  throw;
+	}
+	running_ = false;
+      }
+
+      /**
+       * @brief Stop run() after the current cycle (from any thread or a stage).
+       */
+      void stop() { running_ = false; }
+
+      bool isRunning() const { return running_; }
+
+      void reset() {
+	cycles_.store(0, std::memory_order_relaxed);
+	overruns_.store(0, std::memory_order_relaxed);
+	skipped_.store(0, std::memory_order_relaxed);
+	jitter_.reset();
+	execution_.reset();
+	overrun_.reset();
+      }
+
+      ControlLoopSnapshot snapshot() const {
+	ControlLoopSnapshot s;
+	s.cycles = cycles_.load(std::memory_order_relaxed);
+	s.overruns = overruns_.load(std::memory_order_relaxed);
+	s.skipped = skipped_.load(std::memory_order_relaxed);
+	s.jitter = jitter_.snapshot();
+	s.execution = execution_.snapshot();
+	s.overrun = overrun_.snapshot();
+	return s;
+      }
+
+    private:
+      void waitUntil(const uint64_t deadline) const {
+	const uint64_t wake = deadline > spinMargin_ ? deadline - spinMargin_ : 0;
+	struct timespec ts;
+	ts.tv_sec = wake / 1000000000ULL;
+	ts.tv_nsec = wake % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) ;
+	if (spinMargin_) while (now() < deadline) ;
+      }
+
+      /**
+       * @brief Applies real-time settings to the calling thread and restores them.
+       */
+      class Realtime {
+      private:
+	bool scheduled_;
+	int oldPolicy_;
+	struct sched_param oldParam_;
+	bool pinned_;
+	cpu_set_t oldCpus_;
+	bool locked_;
+
+      public:
+	Realtime(const ControlLoop& loop) : scheduled_(false), pinned_(false), locked_(false) {
+	  try {
+	    if (loop.lockMemory_) {
+	      if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) throw ControlLoopException(std::string("mlockall failed: ") + strerror(errno));
+	      locked_ = true;
+	      prefaultStack();
+	    }
+	    if (loop.cpu_ >= 0) {
+	      if (pthread_getaffinity_np(pthread_self(), sizeof(oldCpus_), &oldCpus_) != 0) throw ControlLoopException("pthread_getaffinity_np failed");
+	      cpu_set_t cpus;
+	      CPU_ZERO(&cpus);
+	      CPU_SET(loop.cpu_, &cpus);
+	      const int r = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	      if (r != 0) throw ControlLoopException(std::string("pthread_setaffinity_np failed: ") + strerror(r));
+	      pinned_ = true;
+	    }
+	    if (loop.priority_ > 0) {
+	      if (pthread_getschedparam(pthread_self(), &oldPolicy_, &oldParam_) != 0) throw ControlLoopException("pthread_getschedparam failed");
+	      struct sched_param param;
+	      memset(&param, 0, sizeof(param));
+	      param.sched_priority = loop.priority_;
+	      const int r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	      if (r != 0) throw ControlLoopException(std::string("SCHED_FIFO failed: ") + strerror(r));
+	      scheduled_ = true;
+	    }
+	  } catch (...) {
+	    restore();
+	    throw;
+	  }
+	}
+
+	~Realtime() { restore(); }
+
+      private:
+	Realtime(const Realtime&);
+	Realtime& operator=(const Realtime&);
+
+	void restore() {
+	  if (scheduled_) pthread_setschedparam(pthread_self(), oldPolicy_, &oldParam_);
+	  if (pinned_) pthread_setaffinity_np(pthread_self(), sizeof(oldCpus_), &oldCpus_);
+	  if (locked_) munlockall();
+	  scheduled_ = pinned_ = locked_ = false;
+	}
+
+	static void prefaultStack() {
+	  uint8_t stack[PREFAULT_STACK_SIZE];
+	  volatile uint8_t* page = stack; // stores through volatile are not optimized out
+	  for (size_t i = 0; i < PREFAULT_STACK_SIZE; i += 4096) page[i] = 0;
+	  __asm__ __volatile__("" : : "r"(page) : "memory");
+	}
+      };
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifdef __linux__
@@ -0,0 +1,391 @@
+/********************************************************
+ * eventbus.h
+ *
+ * One event loop for keyboard, GamePad, SerialPort, Socket
+ * and events posted by other threads (Linux only).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include "keyinput.h"
+#include "gamepad.h"
+#include "serialport.h"
+#include "socket.h"
+
+#ifdef __linux__
+
+#include <string>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <algorithm>
+#include <functional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief This exception is thrown when a source can not be added to EventBus.
+     */
+    class EventBusException : public std::exception {
+    private:
+      std::string msg_;
+    public:
+      EventBusException(const std::string& msg) : msg_(msg) {}
+      ~EventBusException(void) throw() {}
+      const char* what() const throw() { return msg_.c_str(); }
+    };
+
+    /**
+     * @brief Typed event delivered by EventBus (64 bytes, copied by value).
+     */
+    struct InputEvent {
+      const static uint8_t KEY = 0;           ///< key of KeyInput
+      const static uint8_t GAMEPAD = 1;       ///< axis / button change of GamePad
+      const static uint8_t SERIAL = 2;        ///< bytes received by SerialPort
+      const static uint8_t SOCKET = 3;        ///< bytes received by Socket
+      const static uint8_t USER = 4;          ///< posted by EventBus::post()
+      const static uint8_t DISCONNECTED = 5;  ///< source was removed (unplugged, closed by peer)
+
+      const static size_t DATA_SIZE = 40;
+
+      uint64_t timestamp;  ///< steady clock nanoseconds, earliest stamp of the input
+      uint64_t sequence;   ///< order of arrival at EventBus
+      uint16_t source;     ///< id returned by EventBus::add*()
+      uint8_t type;
+      uint8_t size;        ///< bytes in data (SERIAL / SOCKET / USER)
+      union {
+	int32_t key;       ///< KEY: character or AQUA2_KEY_*
+	struct {
+	  uint8_t type;    ///< GamePadEvent::AXIS or BUTTON
+	  uint8_t number;
+	  uint8_t init;
+	  float value;
+	} gamepad;         ///< GAMEPAD
+	uint64_t value;    ///< USER
+	uint8_t data[DATA_SIZE];  ///< SERIAL / SOCKET / USER
+      };
+    };
+
+
+    /***************************************************
+     * EventBus
+     *
+     * @brief Waits all sources with one epoll and delivers one stream of events.
+     *
+     * spinOnce() sleeps until any source has input (or a thread posted),
+     * drains every ready source, sorts the batch by timestamp and calls
+     * the handler for each event. Events are stored in a preallocated
+     * batch, nothing is allocated per event. Bytes from SerialPort and
+     * Socket are split into DATA_SIZE chunks. Sources which do not fit a
+     * batch are drained by the next spinOnce() (GamePad changes beyond it
+     * are counted by getDroppedEvents()).
+     *
+     * Timestamps: KeyInput read time, GamePad::getInputTime() (kernel time
+     * on evdev), read time of SerialPort / Socket. Events are ordered by
+     * timestamp within a spinOnce() and by arrival across them.
+     *
+     * Sources are not owned. A source whose device is gone is removed
+     * after a DISCONNECTED event.
+     *
+     * Usage:
+     *   EventBus bus;
+     *   KeyInput keys;
+     *   const int keyboard = bus.addKeyInput(keys);
+     *   const int pad = bus.addGamePad(gamePad);
+     *   bus.setHandler([&](const InputEvent& e) { ... });
+     *   while (true) bus.spinOnce(-1);
+     ***************************************************/
+    class EventBus {
+    public:
+      typedef std::function<void(const InputEvent&)> Handler;
+
+      const static size_t MAX_BATCH = 1024;
+      const static size_t POST_CAPACITY = 1024;
+      const static int MAX_READY = 32;
+      const static int ESCAPE_POLL_MSEC = 5;
+
+    private:
+      const static uint32_t WAKE_ID = 0xFFFFFFFF;
+
+      struct Source {
+	uint8_t type;
+	int fd;
+	void* object;
+	bool active;
+      };
+
+      int epoll_;
+      int wake_;
+      std::vector<Source> sources_;
+      std::vector<InputEvent> batch_;
+      size_t count_;
+      std::array<InputEvent, POST_CAPACITY> posted_;
+      size_t postHead_;
+      size_t postSize_;
+      std::mutex postMutex_;
+      Handler handler_;
+      uint64_t sequence_;
+      uint64_t dropped_;
+
+    public:
+      EventBus() : batch_(MAX_BATCH), count_(0), postHead_(0), postSize_(0), sequence_(0), dropped_(0) {
+	if ((epoll_ = epoll_create1(EPOLL_CLOEXEC)) < 0) throw EventBusException("epoll_create1 failed");
+	if ((wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+	  ::close(epoll_);
+	  throw EventBusException("eventfd failed");
+	}
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u32 = WAKE_ID;
+	epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &ev);
+      }
+
+      virtual ~EventBus() {
+	::close(wake_);
+	::close(epoll_);
+      }
+
+    private:
+      EventBus(const EventBus&);
+      EventBus& operator=(const EventBus&);
+
+    public:
+      void setHandler(const Handler& handler) { handler_ = handler; }
+
+      /**
+       * @brief epoll file descriptor. Readable when spinOnce() has work (for external event loops).
+       */
+      int getFileDescriptor() const { return epoll_; }
+
+      uint64_t getDroppedEvents() const { return dropped_; }
+
+      /// @return source id of events
+      int addKeyInput(KeyInput& input) { return add(InputEvent::KEY, input.getFileDescriptor(), &input); }
+      int addGamePad(GamePad& pad) { return add(InputEvent::GAMEPAD, pad.getFileDescriptor(), &pad); }
+      int addSerialPort(SerialPort& port) { return add(InputEvent::SERIAL, port.getFileDescriptor(), &port); }
+      int addSocket(Socket& socket) { return add(InputEvent::SOCKET, socket.getFileDescriptor(), &socket); }
+
+      /**
+       * @brief Stop watching source (without DISCONNECTED event).
+       */
+      void remove(const int id) {
+	if (id < 0 || id >= (int)sources_.size() || !sources_[id].active) return;
+	epoll_ctl(epoll_, EPOLL_CTL_DEL, sources_[id].fd, nullptr);
+	sources_[id].active = false;
+      }
+
+      bool isActive(const int id) const { return id >= 0 && id < (int)sources_.size() && sources_[id].active; }
+
+      /**
+       * @brief Queue event from any thread (eg., callback thread) and wake spinOnce().
+       *        timestamp 0 is replaced by the current time.
+       * @return false if the queue is full.
+       */
+      bool post(const InputEvent& event) {
+	bool wake;
+	{
+	  std::lock_guard<std::mutex> lock(postMutex_);
+	  if (postSize_ == POST_CAPACITY) return false;
+	  InputEvent& e = posted_[(postHead_ + postSize_) % POST_CAPACITY];
+	  e = event;
+	  if (!e.timestamp) e.timestamp = InputLatencyMonitor::now();
+	  wake = postSize_++ == 0;
+	}
+	if (wake) {
+	  const uint64_t one = 1;
+	  if (::write(wake_, &one, sizeof(one)) < 0) return true; // counter is already non-zero
+	}
+	return true;
+      }
+
+      /**
+       * @brief Post USER event with value.
+       */
+      bool post(const uint16_t source, const uint64_t value) {
+	InputEvent e;
+	memset(&e, 0, sizeof(e));
+	e.type = InputEvent::USER;
+	e.source = source;
+	e.size = sizeof(value);
+	e.value = value;
+	return post(e);
+      }
+
+      /**
+       * @brief Wait input once and deliver events to the handler in timestamp order.
+       * @param timeoutMsec maximum time to wait. 0 to poll, -1 for infinite.
+       * @return number of events delivered.
+       */
+      int spinOnce(int timeoutMsec) {
+	for (size_t id = 0; id < sources_.size(); id++) {
+	  if (!sources_[id].active || sources_[id].type != InputEvent::KEY) continue;
+	  const KeyInput* input = (const KeyInput*)sources_[id].object;
+	  if (input->available()) timeoutMsec = 0;
+	  else if (input->isIncomplete() && (timeoutMsec < 0 || timeoutMsec > ESCAPE_POLL_MSEC)) timeoutMsec = ESCAPE_POLL_MSEC;
+	}
+	struct epoll_event ready[MAX_READY];
+	const int n = epoll_wait(epoll_, ready, MAX_READY, timeoutMsec);
+
+	count_ = 0;
+	for (int i = 0; i < n; i++) {
+	  if (ready[i].data.u32 == WAKE_ID) {
+	    uint64_t value;
+	    if (::read(wake_, &value, sizeof(value)) < 0) { /* already drained */ }
+	    drainPosted();
+	  } else if (ready[i].data.u32 < sources_.size()) {
+	    drain(ready[i].data.u32);
+	  }
+	}
+	for (size_t id = 0; id < sources_.size(); id++) {
+	  if (sources_[id].active && sources_[id].type == InputEvent::KEY) drainKeys(id, false);
+	}
+
+	std::sort(batch_.begin(), batch_.begin() + count_, [](const InputEvent& a, const InputEvent& b) {
+	  return a.timestamp != b.timestamp ? a.timestamp < b.timestamp : a.sequence < b.sequence;
+	});
+	if (handler_) {
+	  for (size_t i = 0; i < count_; i++) handler_(batch_[i]);
+	}
+	return (int)count_;
+      }
+
+    private:
+      int add(const uint8_t type, const int fd, void* object) {
+	if (fd < 0) throw EventBusException("invalid file descriptor");
+	if (sources_.size() >= WAKE_ID || sources_.size() > 0xFFFF) throw EventBusException("too many sources");
+	Source source;
+	source.type = type;
+	source.fd = fd;
+	source.object = object;
+	source.active = true;
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u32 = (uint32_t)sources_.size();
+	if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev) < 0) throw EventBusException("epoll_ctl failed (already added?)");
+	sources_.push_back(source);
+	return (int)ev.data.u32;
+      }
+
+      size_t room() const { return MAX_BATCH - count_; }
+
+      InputEvent& push(const size_t id, const uint8_t type, const uint64_t timestamp) {
+	InputEvent& e = batch_[count_++];
+	e.timestamp = timestamp;
+	e.sequence = sequence_++;
+	e.source = (uint16_t)id;
+	e.type = type;
+	e.size = 0;
+	return e;
+      }
+
+      void disconnect(const size_t id) {
+	remove((int)id);
+	if (room() > 0) push(id, InputEvent::DISCONNECTED, InputLatencyMonitor::now());
+	else dropped_++;
+      }
+
+      void drain(const size_t id) {
+	if (!sources_[id].active) return;
+	switch (sources_[id].type) {
+	case InputEvent::KEY: drainKeys(id, true); break;
+	case InputEvent::GAMEPAD: drainGamePad(id); break;
+	case InputEvent::SERIAL: drainSerial(id); break;
+	case InputEvent::SOCKET: drainSocket(id); break;
+	}
+      }
+
+      void drainKeys(const size_t id, const bool readable) {
+	KeyInput& input = *(KeyInput*)sources_[id].object;
+	if (readable || input.isIncomplete()) {
+	  if (input.update() < 0 && !input.available()) {
+	    disconnect(id);
+	    return;
+	  }
+	}
+	KeyInput::KeyEvent k;
+	while (room() > 0 && input.get(k)) push(id, InputEvent::KEY, k.stamp).key = k.key;
+      }
+
+      void drainGamePad(const size_t id) {
+	GamePad& pad = *(GamePad*)sources_[id].object;
+	const int ret = pad.update();
+	GamePadEvents changes = pad.events();
+	for (GamePadEvents::iterator it = changes.begin(); it != changes.end(); ++it) {
+	  if (room() == 0) {
+	    dropped_++;
+	    continue;
+	  }
+	  InputEvent& e = push(id, InputEvent::GAMEPAD, pad.getInputTime(*it));
+	  e.gamepad.type = it->type;
+	  e.gamepad.number = it->number;
+	  e.gamepad.init = it->init;
+	  e.gamepad.value = it->value;
+	}
+	if (ret < 0) disconnect(id);
+      }
+
+      void pushBytes(const size_t id, const uint8_t type, const uint8_t* data, size_t size, const uint64_t timestamp) {
+	while (size > 0) {
+	  const size_t n = size < InputEvent::DATA_SIZE ? size : InputEvent::DATA_SIZE;
+	  InputEvent& e = push(id, type, timestamp);
+	  e.size = (uint8_t)n;
+	  memcpy(e.data, data, n);
+	  data += n;
+	  size -= n;
+	}
+      }
+
+      void drainSerial(const size_t id) {
+	SerialPort& port = *(SerialPort*)sources_[id].object;
+	uint8_t buffer[4096];
+	const size_t max = std::min(sizeof(buffer), room() * InputEvent::DATA_SIZE);
+	if (max == 0) return; // level triggered: next spinOnce()
+	int n;
+	try {
+	  n = port.read(buffer, (unsigned int)max);
+	} catch (ComAccessException& ex) {
+	  if (errno != EAGAIN && errno != EINTR) disconnect(id);
+	  return;
+	}
+	if (n > 0) pushBytes(id, InputEvent::SERIAL, buffer, n, InputLatencyMonitor::now());
+      }
+
+      void drainSocket(const size_t id) {
+	uint8_t buffer[4096];
+	const size_t max = std::min(sizeof(buffer), room() * InputEvent::DATA_SIZE);
+	if (max == 0) return;
+	const ssize_t n = ::recv(sources_[id].fd, buffer, max, MSG_DONTWAIT);
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+	  disconnect(id);
+	  return;
+	}
+	if (n > 0) pushBytes(id, InputEvent::SOCKET, buffer, n, InputLatencyMonitor::now());
+      }
+
+      void drainPosted() {
+	std::lock_guard<std::mutex> lock(postMutex_);
+	while (postSize_ > 0 && room() > 0) {
+	  const InputEvent& p = posted_[postHead_];
+	  InputEvent& e = batch_[count_++];
+	  e = p;
+	  e.sequence = sequence_++;
+	  postHead_ = (postHead_ + 1) % POST_CAPACITY;
+	  postSize_--;
+	}
+	if (postSize_ > 0) {
+	  const uint64_t one = 1; // left for next spinOnce()
+	  if (::write(wake_, &one, sizeof(one)) < 0) return;
+	}
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifdef __linux__
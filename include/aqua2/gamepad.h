@@ -12,28 +12,41 @@
 #include <iostream>
 #include <vector>
 #include <exception>
+#include <chrono>
+#include <array>
+
+#include "spscring.h"
+#include "seqlock.h"
+#include "axisconditioner.h"
+#include "histogram.h"
+#include "inputlatency.h"
+#include "alignednew.h"
 
 
 #ifdef WIN32
 #pragma comment(lib, "winmm.lib")
 #include <windows.h>
 
-#elif LINUX
+#elif defined(__linux__)
 
-#include <iomanip>
-#include <vector>
-#include <cstdio>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <stdint.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <stdlib.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include <linux/joystick.h>
+#include <linux/input.h>
 
 #elif __APPLE__
 #include <IOKit/hid/IOHIDManager.h>
 #include <thread>
 #endif
 
+#ifdef __APPLE__
 extern "C" {
 
 static void device_input(void* ctx, IOReturn result, void* sender, IOHIDValueRef value);
@@ -55,6 +68,7 @@ static void device_attached(void* ctx, IOReturn result, void* sender, IOHIDDevic
 
 static void device_detached(void* ctx, IOReturn result, void* sender, IOHIDDeviceRef device);
 }
+#endif
 
 namespace ssr { 
   namespace aqua2 {
@@ -63,22 +77,115 @@ namespace ssr {
   class DeviceNotFoundException : public std::exception {
   };
 
-  class GamePad {
+  /**
+   * @brief Axis or button change recorded by GamePad.
+   */
+  struct GamePadEvent {
+    const static uint8_t AXIS = 0;
+    const static uint8_t BUTTON = 1;
+
+    uint64_t timestamp;  ///< nanoseconds, event time given by device driver (evdev: CLOCK_MONOTONIC, joydev: msec resolution), else received
+    uint64_t received;   ///< nanoseconds, steady clock when the event was read
+    uint8_t type;        ///< AXIS or BUTTON
+    uint8_t number;      ///< index of GamePad::axis or GamePad::buttons
+    uint8_t init;        ///< 1 if initial state reported at open
+    uint8_t reserved;
+    float value;         ///< axis value, or 1.0 (pressed) / 0.0 (released)
+
+    static uint64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+  };
+
+  /**
+   * @brief Fixed-size POD snapshot of GamePad.
+   *
+   * Bit i of buttons is button i. Axes and buttons beyond MAX_AXES /
+   * MAX_BUTTONS are available only through GamePad::axis / buttons.
+   */
+  struct GamePadState {
+    const static int MAX_AXES = 32;
+    const static int MAX_BUTTONS = 64;
+
+    uint64_t sequence;         ///< number of update() calls
+    uint64_t timestamp;        ///< nanoseconds, steady clock at update()
+    uint64_t buttons;          ///< button bits
+    uint64_t previousButtons;  ///< button bits at previous update()
+    std::array<float, MAX_AXES> axes;
+    uint8_t numAxes;
+    uint8_t numButtons;
+
+    bool button(const int i) const { return (buttons >> i) & 1; }
+
+    /// pressed since previous update()
+    bool pressed(const int i) const { return (pressedMask() >> i) & 1; }
+
+    /// released since previous update()
+    bool released(const int i) const { return (releasedMask() >> i) & 1; }
+
+    uint64_t pressedMask() const { return buttons & ~previousButtons; }
+    uint64_t releasedMask() const { return ~buttons & previousButtons; }
+
+    float axis(const int i) const { return axes[i]; }
+
+    void setButton(const int i, const bool value) {
+      const uint64_t bit = (uint64_t)1 << i;
+      buttons = value ? (buttons | bit) : (buttons & ~bit);
+    }
+  };
+
+  typedef SpscRing<GamePadEvent, 1024> GamePadEventQueue;
+  typedef GamePadEventQueue::View GamePadEvents;
+
+#if defined(__linux__)
+  /**
+   * @brief Source of js_event records which GamePad can read instead of device (eg., GamePadReplayer).
+   */
+  class GamePadSource {
+  public:
+    virtual ~GamePadSource() {}
+    /// readable fd delivering struct js_event records. GamePad reads its dup().
+    virtual int getFileDescriptor() const = 0;
+    virtual int getNumAxes() const = 0;
+    virtual int getNumButtons() const = 0;
+    virtual std::string getName() const = 0;
+  };
+
+  /**
+   * @brief Receives every axis / button change applied by GamePad::update() as joydev record.
+   *
+   * Event device changes are converted: number is axis / button index, axis value
+   * is calibrated to [-32767, 32767] and time is in msec of CLOCK_MONOTONIC.
+   */
+  class GamePadInputObserver {
+  public:
+    virtual ~GamePadInputObserver() {}
+    virtual void onInput(const struct js_event& event, const uint64_t received) = 0;
+  };
+#endif
+
+  /// cache line aligned event queue and state: allocated with AlignedNew
+  class GamePad : public AlignedNew<GamePad> {
   public:
     std::vector<float> axis;
     std::vector<bool> buttons;
     std::vector<bool> old_buttons;
 
+  private:
+    GamePadEventQueue eventQueue_;
+    size_t eventBatch_ = 0;
+    std::atomic<uint64_t> droppedEvents_{0};
+    GamePadState state_{};              ///< written by update()
+    SeqLock<GamePadState> published_;   ///< state_ at the end of update()
+    std::array<float, GamePadState::MAX_AXES> rawAxes_{};  ///< axes before conditioner_
+    AxisConditioner* conditioner_ = nullptr;
+    InputLatencyMonitor* latencyMonitor_ = nullptr;
+    bool kernelClock_ = false;          ///< GamePadEvent::timestamp is CLOCK_MONOTONIC (evdev)
+    static_assert(AxisConditioner::MAX_AXES == GamePadState::MAX_AXES, "AxisConditioner must cover all axes of GamePadState");
+
 
   private:
-#ifdef LINUX
-    int joy_fd;
-    int num_of_axis;
-    int num_of_buttons(0);
-    std::vector<char> joy_button;
-    std::vector<int> joy_axis;
-    char name_of_joystick[80];
-#elif WIN32
+#ifdef WIN32
     JOYINFOEX joyInfo_;
     int num_of_axis;
     int num_of_buttons;
@@ -87,24 +194,50 @@ namespace ssr {
     IOHIDManagerRef ioHIDManagerRef_;
     std::vector<std::pair<std::string,IOHIDDeviceRef>> devices_;
     std::thread* thread_;
-    std::vector<float> axis_buf_;
-    std::vector<bool> buttons_buf_;
+    GamePadState hidState_{};             ///< written by HID thread
+    SeqLock<GamePadState> hidLock_;       ///< hidState_ to update()
+#elif defined(__linux__)
+  public:
+    const static int JOYDEV = 0;
+    const static int EVDEV = 1;
+
+    /// Events read by one read() call in update()
+    const static int MAX_EVENTS_PER_READ = 64;
+
+  private:
+    int joy_fd;
+    int protocol_;
+    int num_of_axis;
+    int num_of_buttons;
+    float axisScale_;
+    std::vector<float> axisOffset_;   ///< raw value mapped to 0.0
+    std::vector<float> axisGain_;     ///< raw value to [-1, 1] (before axisScale_)
+    std::vector<int16_t> absIndex_;   ///< evdev ABS_* code to axis index
+    std::vector<int16_t> keyIndex_;   ///< evdev KEY_* / BTN_* code to button index
+    char name_of_joystick[80];
+    GamePadInputObserver* inputObserver_ = nullptr;
+
+    GamePad(const GamePad&);
+    GamePad& operator=(const GamePad&);
 #endif
   public:
 
+    /**
+     * @param filename Linux: joystick (/dev/input/js*, default /dev/input/js0)
+     *                 or event (/dev/input/event*) device. Ignored on Windows and macOS.
+     */
     GamePad(const char* filename) {
-#if LINUX
-      if((joy_fd=open(filename, O_RDONLY)) < 0) { throw new JoystickNotFoundException();}
-  
-      ioctl(joy_fd, JSIOCGAXES, &num_of_axis);
-      ioctl(joy_fd, JSIOCGBUTTONS, &num_of_buttons);
-      ioctl(joy_fd, JSIOCGNAME(80), &name_of_joystick);
-      
-      buttons.resize(num_of_buttons,0);
-      old_buttons.resize(num_of_buttons,0);
-      axis.resize(num_of_axis,0);
-  
-      fcntl(joy_fd, F_SETFL, O_NONBLOCK);   // using non-blocking mode
+#if defined(__linux__)
+      const char* path = (filename && filename[0]) ? filename : "/dev/input/js0";
+      if ((joy_fd = ::open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) < 0) {
+	throw DeviceNotFoundException();
+      }
+      int version;
+      if (ioctl(joy_fd, EVIOCGVERSION, &version) == 0) {
+	setupEvdev();
+      } else {
+	setupJoydev();
+      }
 
 #elif WIN32
  
@@ -152,15 +285,46 @@ namespace ssr {
       num_of_buttons = 16;
       num_of_axis = 7;
       axis.resize(num_of_axis,0);
-      axis_buf_.resize(num_of_axis,0);
       buttons.resize(num_of_buttons, 0);
-      buttons_buf_.resize(num_of_buttons, 0);
       old_buttons.resize(num_of_buttons, 0);
+      state_.numAxes = hidState_.numAxes = (uint8_t)num_of_axis;
+      state_.numButtons = hidState_.numButtons = (uint8_t)num_of_buttons;
+      hidLock_.store(hidState_);
+      published_.store(state_);
 #endif
     }
 
+#if defined(__linux__)
+    /**
+     * @brief Read events from fd (eg., pipe fed with js_event records). fd is closed by destructor.
+     * @param protocol JOYDEV (struct js_event) or EVDEV (struct input_event, ABS_* / BTN_* codes in order)
+     */
+    GamePad(const int fd, const int numAxis, const int numButtons, const int protocol = JOYDEV) : joy_fd(fd) {
+      fcntl(joy_fd, F_SETFL, fcntl(joy_fd, F_GETFL) | O_NONBLOCK);
+      strcpy(name_of_joystick, "fd");
+      init(protocol, numAxis, numButtons);
+      if (protocol == EVDEV) {
+	for (int i = 0; i < numAxis && i < ABS_CNT; i++) absIndex_[i] = i;
+	for (int i = 0; i < numButtons && BTN_MISC + i < KEY_CNT; i++) keyIndex_[BTN_MISC + i] = i;
+      }
+    }
+
+    /**
+     * @brief Read js_event records from source (eg., GamePadReplayer).
+     */
+    GamePad(const GamePadSource& source) : joy_fd(::dup(source.getFileDescriptor())) {
+      if (joy_fd < 0) throw DeviceNotFoundException();
+      fcntl(joy_fd, F_SETFL, fcntl(joy_fd, F_GETFL) | O_NONBLOCK);
+      strncpy(name_of_joystick, source.getName().c_str(), sizeof(name_of_joystick) - 1);
+      name_of_joystick[sizeof(name_of_joystick) - 1] = 0;
+      init(JOYDEV, source.getNumAxes(), source.getNumButtons());
+    }
+#endif
 
     ~GamePad() {
+#if defined(__linux__)
+        if (joy_fd >= 0) ::close(joy_fd);
+#endif
 
 
 #ifdef __APPLE__
@@ -172,11 +336,23 @@ namespace ssr {
 #endif
     }
   public:
-    void update() {
+    /**
+     * @brief Update axis / buttons. old_buttons keeps buttons before this call.
+     *
+     * On Linux all queued events are drained (MAX_EVENTS_PER_READ per read())
+     * and applied in order.
+     * @return number of events applied, -1 if device is not available (eg., unplugged).
+     */
+    int update() {
 #ifdef WIN32
+      eventQueue_.consume(eventBatch_);
       if(JOYERR_NOERROR != joyGetPosEx(0, &joyInfo_)) {
-        return;
+        eventBatch_ = 0;
+        return -1;
       }
+      const uint64_t received = GamePadEvent::now();
+      float prev[7];
+      for (int i = 0; i < 7; i++) prev[i] = axis[i];
       for (size_t i = 0; i < buttons.size(); i++) {
           old_buttons[i] = buttons[i];
           if (joyInfo_.dwButtons & (0x00000001 << i)) {
@@ -187,11 +363,11 @@ namespace ssr {
           }
       }
 
-      axis[0] = ((float)joyInfo_.dwXpos - 32767.0f) / 32767.0f;
-      axis[1] = ((float)joyInfo_.dwYpos - 32767.0f) / 32767.0f;
-      axis[3] = ((float)joyInfo_.dwZpos - 32767.0f) / 32767.0f;
-      axis[2] = ((float)joyInfo_.dwUpos - 32767.0f) / 32767.0f;
-      axis[4] = ((float)joyInfo_.dwRpos - 32767.0f) / 32767.0f;
+      axis[0] = normalizeAxis(joyInfo_.dwXpos, 0, 65535);
+      axis[1] = normalizeAxis(joyInfo_.dwYpos, 0, 65535);
+      axis[3] = normalizeAxis(joyInfo_.dwZpos, 0, 65535);
+      axis[2] = normalizeAxis(joyInfo_.dwUpos, 0, 65535);
+      axis[4] = normalizeAxis(joyInfo_.dwRpos, 0, 65535);
 
       switch (joyInfo_.dwPOV) {
       case 0:
@@ -231,27 +407,367 @@ namespace ssr {
           axis[6] = 0.0f;
           break;
       }
-#elif LINUX
-      js_event js;
-      read(joy_fd, &js, sizeof(js_event));
-      switch (js.type & ~JS_EVENT_INIT) {
+      for (size_t i = 0; i < buttons.size(); i++) {
+          if (buttons[i] != old_buttons[i]) pushEvent(GamePadEvent::BUTTON, (uint8_t)i, buttons[i] ? 1.0f : 0.0f, received, received);
+      }
+      for (int i = 0; i < 7; i++) {
+          if (axis[i] != prev[i]) pushEvent(GamePadEvent::AXIS, (uint8_t)i, axis[i], received, received);
+      }
+      eventBatch_ = eventQueue_.size();
+      state_.numAxes = 7;
+      state_.numButtons = 16;
+      state_.previousButtons = state_.buttons;
+      for (int i = 0; i < 16; i++) state_.setButton(i, buttons[i]);
+      for (int i = 0; i < 7; i++) state_.axes[i] = rawAxes_[i] = axis[i];
+      conditionAxes(received);
+      publish(received);
+      measureLatency();
+      return (int)eventBatch_;
+#elif defined(__linux__)
+      eventQueue_.consume(eventBatch_);
+      old_buttons = buttons;
+      state_.previousButtons = state_.buttons;
+      const int count = protocol_ == EVDEV ? drain<struct input_event>() : drain<struct js_event>();
+      eventBatch_ = eventQueue_.size();
+      const uint64_t now = GamePadEvent::now();
+      conditionAxes(now);
+      publish(now);
+      measureLatency();
+      return count;
+#elif __APPLE__
+    eventQueue_.consume(eventBatch_);
+    eventBatch_ = eventQueue_.size();
+    const uint64_t previous = state_.buttons;
+    const uint64_t sequence = state_.sequence;
+    const uint64_t timestamp = state_.timestamp;
+    hidLock_.load(state_);
+    state_.previousButtons = previous;
+    state_.sequence = sequence;
+    state_.timestamp = timestamp;
+    for (size_t i = 0; i < axis.size(); i++) axis[i] = rawAxes_[i] = state_.axes[i];
+    for (size_t i = 0; i < buttons.size(); i++) {
+        old_buttons[i] = buttons[i];
+        buttons[i] = state_.button((int)i);
+    }
+    const uint64_t now = GamePadEvent::now();
+    conditionAxes(now);
+    publish(now);
+    measureLatency();
+    return (int)eventBatch_;
+#endif
+    }
+
+    /**
+     * @brief Torn-free copy of the state published by the last update(). Callable from any thread.
+     */
+    GamePadState state() const { return published_.load(); }
+
+    /**
+     * @brief Version of state(). Changes on every update().
+     */
+    uint64_t stateVersion() const { return published_.version(); }
+
+    /**
+     * @brief Button i was pressed / released by the last update() (thread calling update() only).
+     */
+    bool pressed(const int i) const { return state_.pressed(i); }
+    bool released(const int i) const { return state_.released(i); }
+
+    /**
+     * @brief Every axis / button change applied by the last update(), in order.
+     *
+     * The view is valid until the next update(). Changes which did not fit
+     * the queue (GamePadEventQueue::capacity() between two update() calls)
+     * are counted by getDroppedEvents().
+     */
+    GamePadEvents events() const { return eventQueue_.peek(eventBatch_); }
+
+    uint64_t getDroppedEvents() const { return droppedEvents_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief value in [min, max] to [-1, 1].
+     */
+    static float normalizeAxis(const double value, const double min, const double max) {
+      return max > min ? (float)(2.0 * (value - min) / (max - min) - 1.0) : 0.0f;
+    }
+
+    /**
+     * @brief Apply conditioner to axis and state() in update(). Events keep unconditioned values. nullptr to detach.
+     */
+    void setAxisConditioner(AxisConditioner* conditioner) {
+      conditioner_ = conditioner;
+      if (conditioner_) conditioner_->reset();
+    }
+
+    AxisConditioner* getAxisConditioner() const { return conditioner_; }
+
+    /**
+     * @brief Measure latency of every change consumed by update(). nullptr to detach.
+     *
+     * Changes are stamped at kernel event time (evdev), HID callback (macOS)
+     * or read() / poll in update() (joydev, Windows), and consumed when
+     * update() returns.
+     */
+    void setLatencyMonitor(InputLatencyMonitor* monitor) {
+      latencyMonitor_ = monitor;
+      if (!latencyMonitor_) return;
+#ifdef __APPLE__
+      latencyMonitor_->setSource(InputLatencyMonitor::CALLBACK_TIME);
+#else
+      latencyMonitor_->setSource(kernelClock_ ? InputLatencyMonitor::KERNEL_TIME : InputLatencyMonitor::READ_TIME);
+#endif
+    }
+
+    InputLatencyMonitor* getLatencyMonitor() const { return latencyMonitor_; }
+
+    /**
+     * @brief Earliest steady clock time of the change: kernel event time (evdev), else received.
+     */
+    uint64_t getInputTime(const GamePadEvent& e) const { return kernelClock_ ? e.timestamp : e.received; }
+
+  private:
+    void measureLatency() {
+      if (!latencyMonitor_) return;
+      const uint64_t now = GamePadEvent::now();
+      latencyMonitor_->poll(now);
+      GamePadEvents batch = events();
+      for (GamePadEvents::iterator it = batch.begin(); it != batch.end(); ++it) {
+	if (!it->init) latencyMonitor_->consume(getInputTime(*it), now);
+      }
+    }
+
+    void conditionAxes(const uint64_t now) {
+      if (!conditioner_) return;
+      const float dt = state_.timestamp ? (now - state_.timestamp) * 1e-9f : 0.0f;
+      conditioner_->process(rawAxes_.data(), state_.axes.data(), state_.numAxes, dt);
+      for (int i = 0; i < state_.numAxes && i < (int)axis.size(); i++) axis[i] = state_.axes[i];
+    }
+
+    void publish(const uint64_t timestamp) {
+      state_.sequence++;
+      state_.timestamp = timestamp;
+      published_.store(state_);
+    }
+
+    /**
+     * @brief Called from the thread producing events (update(), or HID callback thread on macOS).
+     */
+    void pushEvent(const uint8_t type, const uint8_t number, const float value, const uint64_t timestamp, const uint64_t received, const bool init = false) {
+      GamePadEvent e;
+      e.timestamp = timestamp;
+      e.received = received;
+      e.type = type;
+      e.number = number;
+      e.init = init ? 1 : 0;
+      e.reserved = 0;
+      e.value = value;
+      if (!eventQueue_.push(e)) relaxedIncrement(droppedEvents_);
+    }
+
+  public:
+
+#if defined(__linux__)
+    int getFileDescriptor() const { return joy_fd; }
+
+    int getProtocol() const { return protocol_; }
+
+    std::string getName() const { return name_of_joystick; }
+
+    int getNumAxes() const { return num_of_axis; }
+
+    int getNumButtons() const { return num_of_buttons; }
+
+    /**
+     * @brief Observer called for every change in update() (eg., GamePadRecorder). nullptr to detach.
+     */
+    void setInputObserver(GamePadInputObserver* observer) { inputObserver_ = observer; }
+
+    GamePadInputObserver* getInputObserver() const { return inputObserver_; }
+
+    /**
+     * @brief axis = scale * (raw value normalized to [-1, 1]). Default 1.0.
+     */
+    void setAxisScale(const float scale) {
+      for (int i = 0; i < num_of_axis; i++) {
+	axis[i] = axisScale_ ? axis[i] / axisScale_ * scale : 0.0f;
+	if (i < GamePadState::MAX_AXES) {
+	  state_.axes[i] = axis[i];
+	  rawAxes_[i] = axisScale_ ? rawAxes_[i] / axisScale_ * scale : 0.0f;
+	}
+      }
+      axisScale_ = scale;
+    }
+
+    float getAxisScale() const { return axisScale_; }
+
+  private:
+    void init(const int protocol, const int numAxis, const int numButtons) {
+      protocol_ = protocol;
+      num_of_axis = numAxis;
+      num_of_buttons = numButtons;
+      axisScale_ = 1.0f;
+      axis.assign(num_of_axis, 0.0f);
+      buttons.assign(num_of_buttons, false);
+      old_buttons.assign(num_of_buttons, false);
+      axisOffset_.assign(num_of_axis, 0.0f);
+      axisGain_.assign(num_of_axis, 1.0f / 32767.0f);
+      rawAxes_.fill(0.0f);
+      state_ = GamePadState();
+      state_.numAxes = (uint8_t)(num_of_axis < GamePadState::MAX_AXES ? num_of_axis : GamePadState::MAX_AXES);
+      state_.numButtons = (uint8_t)(num_of_buttons < GamePadState::MAX_BUTTONS ? num_of_buttons : GamePadState::MAX_BUTTONS);
+      published_.store(state_);
+      if (protocol_ == EVDEV) {
+	absIndex_.assign(ABS_CNT, -1);
+	keyIndex_.assign(KEY_CNT, -1);
+      }
+    }
+
+    void setupJoydev() {
+      uint8_t axes = 0, btns = 0;
+      ioctl(joy_fd, JSIOCGAXES, &axes);
+      ioctl(joy_fd, JSIOCGBUTTONS, &btns);
+      if (ioctl(joy_fd, JSIOCGNAME(sizeof(name_of_joystick)), name_of_joystick) < 0) strcpy(name_of_joystick, "Unknown");
+      init(JOYDEV, axes, btns);
+    }
+
+    static bool testBit(const uint8_t* bits, const int n) { return (bits[n / 8] >> (n % 8)) & 1; }
+
+    /**
+     * @brief Map absolute axes (except multi-touch) and buttons in code order like joydev.
+     */
+    void setupEvdev() {
+      uint8_t absBits[ABS_CNT / 8 + 1], keyBits[KEY_CNT / 8 + 1];
+      memset(absBits, 0, sizeof(absBits));
+      memset(keyBits, 0, sizeof(keyBits));
+      ioctl(joy_fd, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits);
+      ioctl(joy_fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits);
+      if (ioctl(joy_fd, EVIOCGNAME(sizeof(name_of_joystick)), name_of_joystick) < 0) strcpy(name_of_joystick, "Unknown");
+      int clock = CLOCK_MONOTONIC;
+      kernelClock_ = ioctl(joy_fd, EVIOCSCLOCKID, &clock) == 0;
+
+      int numAxis = 0, numButtons = 0;
+      for (int code = 0; code < ABS_MT_SLOT; code++) if (testBit(absBits, code)) numAxis++;
+      for (int code = BTN_MISC; code < KEY_CNT; code++) if (testBit(keyBits, code)) numButtons++;
+      init(EVDEV, numAxis, numButtons);
+
+      int index = 0;
+      for (int code = 0; code < ABS_MT_SLOT; code++) {
+	if (!testBit(absBits, code)) continue;
+	absIndex_[code] = index;
+	struct input_absinfo info;
+	if (ioctl(joy_fd, EVIOCGABS(code), &info) == 0 && info.maximum > info.minimum) {
+	  axisOffset_[index] = (info.maximum + info.minimum) / 2.0f;
+	  axisGain_[index] = 2.0f / (info.maximum - info.minimum);
+	}
+	index++;
+      }
+      index = 0;
+      for (int code = BTN_MISC; code < KEY_CNT; code++) {
+	if (testBit(keyBits, code)) keyIndex_[code] = index++;
+      }
+      resync(true);
+    }
+
+    /**
+     * @brief Reload whole state from evdev (at open and after SYN_DROPPED) and record it as events.
+     */
+    void resync(const bool init) {
+      const uint64_t received = GamePadEvent::now();
+      for (int code = 0; code < ABS_MT_SLOT; code++) {
+	const int i = absIndex_[code];
+	struct input_absinfo info;
+	if (i >= 0 && ioctl(joy_fd, EVIOCGABS(code), &info) == 0) setAxis(i, info.value, received, received, init);
+      }
+      uint8_t keyState[KEY_CNT / 8 + 1];
+      memset(keyState, 0, sizeof(keyState));
+      if (ioctl(joy_fd, EVIOCGKEY(sizeof(keyState)), keyState) < 0) return;
+      for (int code = BTN_MISC; code < KEY_CNT; code++) {
+	const int i = keyIndex_[code];
+	if (i >= 0) setButton(i, testBit(keyState, code), received, received, init);
+      }
+    }
+
+    void setAxis(const int i, const int value, const uint64_t timestamp, const uint64_t received, const bool init = false) {
+      axis[i] = (value - axisOffset_[i]) * axisGain_[i] * axisScale_;
+      if (i < GamePadState::MAX_AXES) state_.axes[i] = rawAxes_[i] = axis[i];
+      pushEvent(GamePadEvent::AXIS, (uint8_t)i, axis[i], timestamp, received, init);
+      if (inputObserver_) {
+	float raw = (value - axisOffset_[i]) * axisGain_[i] * 32767.0f;
+	raw = raw > 32767.0f ? 32767.0f : (raw < -32767.0f ? -32767.0f : raw);
+	notifyInput(JS_EVENT_AXIS, i, (int16_t)lrintf(raw), timestamp, received, init);
+      }
+    }
+
+    void setButton(const int i, const bool value, const uint64_t timestamp, const uint64_t received, const bool init = false) {
+      buttons[i] = value;
+      if (i < GamePadState::MAX_BUTTONS) state_.setButton(i, value);
+      pushEvent(GamePadEvent::BUTTON, (uint8_t)i, value ? 1.0f : 0.0f, timestamp, received, init);
+      if (inputObserver_) notifyInput(JS_EVENT_BUTTON, i, value ? 1 : 0, timestamp, received, init);
+    }
+
+    void notifyInput(const uint8_t type, const int i, const int16_t value, const uint64_t timestamp, const uint64_t received, const bool init) {
+      struct js_event e;
+      e.time = (uint32_t)(timestamp / 1000000);
+      e.value = value;
+      e.type = init ? (type | JS_EVENT_INIT) : type;
+      e.number = (uint8_t)i;
+      inputObserver_->onInput(e, received);
+    }
+
+    void apply(const struct js_event& e, const uint64_t received) {
+      const uint64_t timestamp = (uint64_t)e.time * 1000000;
+      const bool init = (e.type & JS_EVENT_INIT) != 0;
+      switch (e.type & ~JS_EVENT_INIT) {
       case JS_EVENT_AXIS:
-	if((int)js.number>=joy_axis.size())  {std::cerr<<"err:"<<(int)js.number<<std::endl;}
-	axis[(int)js.number]= js.value / 300.0;
+	if (e.number < num_of_axis) setAxis(e.number, e.value, timestamp, received, init);
 	break;
       case JS_EVENT_BUTTON:
-	if((int)js.number>=joy_button.size())  {std::cerr<<"err:"<<(int)js.number<<std::endl;}
-	button_old[(int)js.number] = button[(int)js.number];
-	button[(int)js.number]= js.value;
+	if (e.number < num_of_buttons) setButton(e.number, e.value != 0, timestamp, received, init);
 	break;
       }
-#elif __APPLE__
-    axis = axis_buf_;
-    old_buttons = buttons;
-    buttons = buttons_buf_;
-#endif
     }
 
+    void apply(const struct input_event& e, const uint64_t received) {
+      const uint64_t timestamp = (uint64_t)e.input_event_sec * 1000000000 + (uint64_t)e.input_event_usec * 1000;
+      switch (e.type) {
+      case EV_ABS:
+	if (e.code < ABS_CNT && absIndex_[e.code] >= 0) setAxis(absIndex_[e.code], e.value, timestamp, received);
+	break;
+      case EV_KEY:
+	if (e.code < KEY_CNT && keyIndex_[e.code] >= 0) setButton(keyIndex_[e.code], e.value != 0, timestamp, received);
+	break;
+      case EV_SYN:
+	if (e.code == SYN_DROPPED) resync(false);
+	break;
+      }
+    }
+
+    /**
+     * @brief Read all queued events into stack buffer and apply them in order.
+     */
+    template<typename Event>
+    int drain() {
+      Event events[MAX_EVENTS_PER_READ];
+      int count = 0;
+      for (;;) {
+	const ssize_t n = ::read(joy_fd, events, sizeof(events));
+	if (n < 0) {
+	  if (errno == EINTR) continue;
+	  if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+	  return -1; // ENODEV: unplugged
+	}
+	if (n == 0) return -1;
+	const uint64_t received = GamePadEvent::now();
+	const int num = (int)(n / sizeof(Event));
+	for (int i = 0; i < num; i++) apply(events[i], received);
+	count += num;
+	if ((size_t)n < sizeof(events)) break;
+      }
+      return count;
+    }
+  public:
+#endif
+
 
 #ifdef __APPLE__
     void attachDevice(CFStringRef name, IOHIDDeviceRef device) {
@@ -276,72 +792,90 @@ namespace ssr {
         }
     }
 
-    void inputDevice(int a, int b, int c, double d) {
+    /**
+     * @brief Called from HID thread.
+     */
+    void inputDevice(int a, int b, int c, double d, double min = 0.0, double max = 255.0) {
+        applyInput(a, b, c, d, min, max);
+        hidLock_.store(hidState_);
+    }
+
+  private:
+    void applyInput(int a, int b, int c, double d, double min, double max) {
+        const uint64_t received = GamePadEvent::now();
         switch(c) {
         case 48:
-            axis_buf_[0] = (double)d / 128.0  - 1.0;
+            hidState_.axes[0] = normalizeAxis(d, min, max);
+            pushEvent(GamePadEvent::AXIS, 0, hidState_.axes[0], received, received);
             return;
         case 49:
-            axis_buf_[1] = (double)d*2 / 254.0 - 1.0;
+            hidState_.axes[1] = normalizeAxis(d, min, max);
+            pushEvent(GamePadEvent::AXIS, 1, hidState_.axes[1], received, received);
             return;
         case 50:
-            axis_buf_[3] = (double)d*2 / 256.0 - 1.0;
+            hidState_.axes[3] = normalizeAxis(d, min, max);
+            pushEvent(GamePadEvent::AXIS, 3, hidState_.axes[3], received, received);
             return;
         case 53:
-            axis_buf_[4] = (double)d*2 / 254.0 - 1.0;
+            hidState_.axes[4] = normalizeAxis(d, min, max);
+            pushEvent(GamePadEvent::AXIS, 4, hidState_.axes[4], received, received);
             return;
         }
 
         if (c == 57) {
             switch ((int)d) {
             case 0:
-                axis_buf_[5] = 0.0f;
-                axis_buf_[6] = -1.0f;
+                hidState_.axes[5] = 0.0f;
+                hidState_.axes[6] = -1.0f;
                 break;
             case 90:
-                axis_buf_[5] = +1.0f;
-                axis_buf_[6] = 0.0f;
+                hidState_.axes[5] = +1.0f;
+                hidState_.axes[6] = 0.0f;
                 break;
             case 180:
-                axis_buf_[5] = 0.0f;
-                axis_buf_[6] = +1.0f;
+                hidState_.axes[5] = 0.0f;
+                hidState_.axes[6] = +1.0f;
                 break;
             case 270:
-                axis_buf_[5] = -1.0f;
-                axis_buf_[6] = 0.0f;
+                hidState_.axes[5] = -1.0f;
+                hidState_.axes[6] = 0.0f;
                 break;
             case 45:
-                axis_buf_[5] = +1.0f;
-                axis_buf_[6] = -1.0f;
+                hidState_.axes[5] = +1.0f;
+                hidState_.axes[6] = -1.0f;
                 break;
             case 135:
-                axis_buf_[5] = +1.0f;
-                axis_buf_[6] = +1.0f;
+                hidState_.axes[5] = +1.0f;
+                hidState_.axes[6] = +1.0f;
                 break;
             case 225:
-                axis_buf_[5] = -1.0f;
-                axis_buf_[6] = +1.0f;
+                hidState_.axes[5] = -1.0f;
+                hidState_.axes[6] = +1.0f;
                 break;
             case 315:
-                axis_buf_[5] = -1.0f;
-                axis_buf_[6] = -1.0f;
+                hidState_.axes[5] = -1.0f;
+                hidState_.axes[6] = -1.0f;
                 break;
             default:
-                axis_buf_[5] = 0.0f;
-                axis_buf_[6] = 0.0f;
+                hidState_.axes[5] = 0.0f;
+                hidState_.axes[6] = 0.0f;
                 break;
             }
+            pushEvent(GamePadEvent::AXIS, 5, hidState_.axes[5], received, received);
+            pushEvent(GamePadEvent::AXIS, 6, hidState_.axes[6], received, received);
             return;
         }
 
         if(a == 2) {
-            buttons_buf_[c] = (int)d;
+            if (c < GamePadState::MAX_BUTTONS) hidState_.setButton(c, (int)d != 0);
+            pushEvent(GamePadEvent::BUTTON, (uint8_t)c, (int)d ? 1.0f : 0.0f, received, received);
             return;
         }
 
         //if (b != 65280)
         // std::cout << "inputDevice(" << a << ", " << b << ", " << c << ", " << d << ")" << std::endl;
     }
+  public:
 
 
 #endif
@@ -361,12 +895,18 @@ namespace ssr {
   
 }
 
+#ifdef __APPLE__
 extern "C" {
 static void device_input(void* ctx, IOReturn result, void* sender, IOHIDValueRef value)
 {
     IOHIDElementRef element = IOHIDValueGetElement(value);
+    double min = (double)IOHIDElementGetPhysicalMin(element), max = (double)IOHIDElementGetPhysicalMax(element);
+    if (max <= min) {
+        min = (double)IOHIDElementGetLogicalMin(element);
+        max = (double)IOHIDElementGetLogicalMax(element);
+    }
     if (ctx) static_cast<ssr::aqua2::GamePad*>(ctx)->inputDevice((int)IOHIDElementGetType(element), (int)IOHIDElementGetUsagePage(element), (int)IOHIDElementGetUsage(element), 
-    IOHIDValueGetScaledValue(value, kIOHIDValueScaleTypePhysical));//(int)IOHIDValueGetIntegerValue(value));
+    IOHIDValueGetScaledValue(value, kIOHIDValueScaleTypePhysical), min, max);//(int)IOHIDValueGetIntegerValue(value));
 }
 
 void device_attached(void* ctx, IOReturn result, void* sender, IOHIDDeviceRef device) {
@@ -379,4 +919,5 @@ static void device_detached(void* ctx, IOReturn result, void* sender, IOHIDDevic
 
 }
 
-}
\ No newline at end of file
+} // extern "C"
+#endif
@@ -0,0 +1,299 @@
+/********************************************************
+ * gamepadmanager.h
+ *
+ * Multiplexes all joystick devices on one thread (Linux only).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include "gamepad.h"
+
+#ifdef __linux__
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <fstream>
+#include <dirent.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * GamePadManager
+     *
+     * @brief Discovers joystick devices (/dev/input/js*), watches attach /
+     *        detach with inotify and waits all of them with one epoll.
+     *
+     * Each device gets a stable ID: a controller plugged again (same
+     * uniq / phys in sysfs, or same path) gets its old ID back. IDs
+     * are never reused by other devices.
+     *
+     * spinOnce() costs one epoll_wait() when no pad has input. Pads are
+     * updated when they have input, and once more after that so that
+     * GamePad::pressed() / released() edges last exactly one spin.
+     *
+     * Usage:
+     *   GamePadManager manager;
+     *   manager.addListener([](int id, int event) { ... });
+     *   while (true) {
+     *     manager.spinOnce(10);
+     *     for (size_t id = 0; id < manager.getNumIds(); id++) {
+     *       GamePad* pad = manager.getPad(id);
+     *       if (pad) { ... }
+     *     }
+     *   }
+     ***************************************************/
+    class GamePadManager {
+    public:
+      const static int CONNECTED = 0;
+      const static int DISCONNECTED = 1;
+
+      /// Maximum epoll events handled by one spinOnce()
+      const static int MAX_EVENTS = 16;
+
+      /// Opens the device at path. Throws DeviceNotFoundException or returns nullptr on failure.
+      typedef std::function<GamePad*(const std::string&)> Factory;
+
+    private:
+      const static uint32_t INOTIFY_ID = 0xFFFFFFFF;
+
+      struct Slot {
+	std::string key;
+	std::string path;
+	GamePad* pad;
+	bool ready;
+	bool dirty;
+      };
+
+      std::string directory_;
+      std::string prefix_;
+      Factory factory_;
+      std::vector<Slot> slots_;
+      std::vector<std::function<void(const int, const int)> > listeners_;
+      int epoll_;
+      int inotify_;
+
+    public:
+      /**
+       * @param directory device directory
+       * @param prefix device file name is prefix followed by number (eg., "js" or "event")
+       * @param factory how to open devices. Default is new GamePad(path).
+       */
+      GamePadManager(const std::string& directory = "/dev/input", const std::string& prefix = "js", const Factory& factory = Factory()) :
+	directory_(directory), prefix_(prefix), factory_(factory), epoll_(-1), inotify_(-1) {
+	epoll_ = epoll_create1(EPOLL_CLOEXEC);
+	inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_ >= 0) {
+	  inotify_add_watch(inotify_, directory_.c_str(), IN_CREATE | IN_ATTRIB | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM);
+	  struct epoll_event ev;
+	  ev.events = EPOLLIN;
+	  ev.data.u32 = INOTIFY_ID;
+	  epoll_ctl(epoll_, EPOLL_CTL_ADD, inotify_, &ev);
+	}
+	scan();
+      }
+
+      virtual ~GamePadManager() {
+	for (size_t i = 0; i < slots_.size(); i++) delete slots_[i].pad;
+	if (inotify_ >= 0) ::close(inotify_);
+	if (epoll_ >= 0) ::close(epoll_);
+      }
+
+    private:
+      GamePadManager(const GamePadManager&);
+      GamePadManager& operator=(const GamePadManager&);
+
+    public:
+      /**
+       * @brief Add listener called with ID and CONNECTED or DISCONNECTED.
+       *        Pads already connected are reported immediately.
+       */
+      void addListener(const std::function<void(const int, const int)>& listener) {
+	listeners_.push_back(listener);
+	for (size_t i = 0; i < slots_.size(); i++) {
+	  if (slots_[i].pad) listener((int)i, CONNECTED);
+	}
+      }
+
+      /**
+       * @brief Number of IDs given so far (connected or not).
+       */
+      size_t getNumIds() const { return slots_.size(); }
+
+      size_t getNumConnected() const {
+	size_t n = 0;
+	for (size_t i = 0; i < slots_.size(); i++) if (slots_[i].pad) n++;
+	return n;
+      }
+
+      /**
+       * @return pad of id, or nullptr if it is not connected.
+       */
+      GamePad* getPad(const size_t id) const { return id < slots_.size() ? slots_[id].pad : nullptr; }
+
+      bool isConnected(const size_t id) const { return getPad(id) != nullptr; }
+
+      /**
+       * @brief Device path of id when it was connected last time.
+       */
+      std::string getPath(const size_t id) const { return id < slots_.size() ? slots_[id].path : std::string(); }
+
+      /**
+       * @brief epoll file descriptor. Readable when spinOnce() has work (for external event loops).
+       */
+      int getFileDescriptor() const { return epoll_; }
+
+      /**
+       * @brief Wait input / attach / detach once and update pads.
+       * @param timeoutMsec maximum time to wait. 0 to poll.
+       * @return number of pads updated.
+       */
+      int spinOnce(const int timeoutMsec) {
+	struct epoll_event events[MAX_EVENTS];
+	const int n = epoll_wait(epoll_, events, MAX_EVENTS, timeoutMsec);
+	bool notified = false;
+	for (int i = 0; i < n; i++) {
+	  if (events[i].data.u32 == INOTIFY_ID) notified = true;
+	  else if (events[i].data.u32 < slots_.size()) slots_[events[i].data.u32].ready = true;
+	}
+
+	int updated = 0;
+	for (size_t id = 0; id < slots_.size(); id++) {
+	  Slot& slot = slots_[id];
+	  if (!slot.pad || !(slot.ready || slot.dirty)) continue;
+	  slot.ready = false;
+	  const int ret = slot.pad->update();
+	  if (ret < 0) {
+	    detach(id);
+	    continue;
+	  }
+	  slot.dirty = ret > 0;
+	  updated++;
+	}
+	if (notified) handleNotification();
+	return updated;
+      }
+
+      /**
+       * @brief Attach devices in directory which are not attached yet.
+       */
+      void scan() {
+	DIR* dir = opendir(directory_.c_str());
+	if (!dir) return;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != nullptr) {
+	  if (matches(entry->d_name)) attach(entry->d_name);
+	}
+	closedir(dir);
+      }
+
+    private:
+      bool matches(const char* name) const {
+	if (strncmp(name, prefix_.c_str(), prefix_.length()) != 0) return false;
+	const char* p = name + prefix_.length();
+	if (!*p) return false;
+	for (; *p; p++) if (*p < '0' || *p > '9') return false;
+	return true;
+      }
+
+      void notify(const int id, const int event) {
+	for (size_t i = 0; i < listeners_.size(); i++) listeners_[i](id, event);
+      }
+
+      static std::string readLine(const std::string& filename) {
+	std::ifstream file(filename.c_str());
+	std::string line;
+	std::getline(file, line);
+	return line;
+      }
+
+      /**
+       * @brief Identity of the controller: uniq (serial number) or phys (USB port) from sysfs, else path.
+       */
+      std::string deviceKey(const std::string& name, const std::string& path) const {
+	if (directory_ == "/dev/input") {
+	  const std::string sys = "/sys/class/input/" + name + "/device/";
+	  const std::string uniq = readLine(sys + "uniq");
+	  if (!uniq.empty()) return "uniq:" + uniq;
+	  const std::string phys = readLine(sys + "phys");
+	  if (!phys.empty()) return "phys:" + phys;
+	}
+	return "path:" + path;
+      }
+
+      void attach(const std::string& name) {
+	const std::string path = directory_ + "/" + name;
+	for (size_t i = 0; i < slots_.size(); i++) {
+	  if (slots_[i].pad && slots_[i].path == path) return;
+	}
+	GamePad* pad = nullptr;
+	try {
+	  pad = factory_ ? factory_(path) : new GamePad(path.c_str());
+	} catch (DeviceNotFoundException& ex) {
+	  return; // eg., not readable yet. Retried on IN_ATTRIB.
+	}
+	if (!pad) return;
+
+	const std::string key = deviceKey(name, path);
+	size_t id = slots_.size();
+	for (size_t i = 0; i < slots_.size(); i++) {
+	  if (!slots_[i].pad && slots_[i].key == key) {
+	    id = i;
+	    break;
+	  }
+	}
+	if (id == slots_.size()) slots_.push_back(Slot());
+	Slot& slot = slots_[id];
+	slot.key = key;
+	slot.path = path;
+	slot.pad = pad;
+	slot.ready = false;
+	slot.dirty = true; // initial state events
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u32 = (uint32_t)id;
+	epoll_ctl(epoll_, EPOLL_CTL_ADD, pad->getFileDescriptor(), &ev);
+	notify((int)id, CONNECTED);
+      }
+
+      void detach(const size_t id) {
+	Slot& slot = slots_[id];
+	epoll_ctl(epoll_, EPOLL_CTL_DEL, slot.pad->getFileDescriptor(), nullptr);
+	delete slot.pad;
+	slot.pad = nullptr;
+	slot.ready = slot.dirty = false;
+	notify((int)id, DISCONNECTED);
+      }
+
+      void handleNotification() {
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t n;
+	while ((n = ::read(inotify_, buf, sizeof(buf))) > 0) {
+	  for (char* p = buf; p < buf + n;) {
+	    const struct inotify_event* e = (const struct inotify_event*)p;
+	    p += sizeof(struct inotify_event) + e->len;
+	    if (!e->len || !matches(e->name)) continue;
+	    if (e->mask & (IN_CREATE | IN_ATTRIB | IN_MOVED_TO)) {
+	      attach(e->name);
+	    } else if (e->mask & (IN_DELETE | IN_MOVED_FROM)) {
+	      const std::string path = directory_ + "/" + e->name;
+	      for (size_t i = 0; i < slots_.size(); i++) {
+		if (slots_[i].pad && slots_[i].path == path) detach(i);
+	      }
+	    }
+	  }
+	}
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifdef __linux__
@@ -0,0 +1,307 @@
+/********************************************************
+ * gamepadrecorder.h
+ *
+ * GamePad input recorder and replayer (Linux only).
+ *
+ * GamePadRecorder logs every change applied by GamePad::update()
+ * as joydev records with receive time. GamePadReplayer is a
+ * GamePadSource, so GamePad can be constructed from it and used
+ * exactly like a device, in real time or in virtual time as fast
+ * as possible.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include "gamepad.h"
+
+#ifdef __linux__
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <poll.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief This exception is thrown when GamePad log file is failed to open, write or read.
+     */
+    class GamePadLogException : public std::exception {
+    private:
+      std::string msg_;
+    public:
+      GamePadLogException(const std::string& msg) : msg_(msg) {}
+      ~GamePadLogException(void) throw() {}
+      const char* what() const throw() { return msg_.c_str(); }
+    };
+
+    /**
+     * Log file layout:
+     *   GamePadLogHeader
+     *   GamePadLogRecord * N
+     * Records with event.type == 0 only carry delay longer than UINT32_MAX usec.
+     */
+    struct GamePadLogHeader {
+      char magic[4];        ///< "AQ2G"
+      uint16_t version;
+      uint8_t numAxes;
+      uint8_t numButtons;
+      uint64_t startTime;   ///< steady clock in nanoseconds at the beginning of recording
+      char name[80];
+    };
+
+    struct GamePadLogRecord {
+      uint32_t delay;         ///< usec since previous record (or startTime)
+      struct js_event event;  ///< as given to GamePadInputObserver
+    };
+
+
+    /***************************************************
+     * GamePadRecorder
+     *
+     * @brief Records input of GamePad (12 bytes per change).
+     *
+     * onInput() is called from GamePad::update() and never throws. When
+     * the log can not be written (eg., disk full), the recorder stops
+     * logging and hasError() turns true.
+     *
+     * Usage:
+     *   GamePad pad("/dev/input/js0");
+     *   GamePadRecorder recorder("session.aq2g", pad);
+     *   pad.setInputObserver(&recorder);
+     ***************************************************/
+    class GamePadRecorder : public GamePadInputObserver {
+    private:
+      FILE* file_;
+      uint64_t last_;
+      uint64_t count_;
+      bool error_;
+      char buffer_[64 * 1024];
+
+    public:
+      GamePadRecorder(const char* filename, const GamePad& pad) : last_(GamePadEvent::now()), count_(0), error_(false) {
+	if ((file_ = fopen(filename, "wb")) == nullptr) throw GamePadLogException(std::string("Can not open ") + filename);
+	setvbuf(file_, buffer_, _IOFBF, sizeof(buffer_));
+	GamePadLogHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "AQ2G", 4);
+	header.version = 1;
+	header.numAxes = (uint8_t)pad.getNumAxes();
+	header.numButtons = (uint8_t)pad.getNumButtons();
+	header.startTime = last_;
+	strncpy(header.name, pad.getName().c_str(), sizeof(header.name) - 1);
+	if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+	  fclose(file_);
+	  throw GamePadLogException("Can not write GamePad log header");
+	}
+      }
+
+      virtual ~GamePadRecorder() {
+	fclose(file_);
+      }
+
+    private:
+      GamePadRecorder(const GamePadRecorder&);
+      GamePadRecorder& operator=(const GamePadRecorder&);
+
+    public:
+      uint64_t getNumRecords() const { return count_; }
+
+      /**
+       * @brief true once writing the log failed. No record is logged after that.
+       */
+      bool hasError() const { return error_; }
+
+      void flush() {
+	if (!error_ && fflush(file_) != 0) error_ = true;
+      }
+
+      virtual void onInput(const struct js_event& event, const uint64_t received) {
+	if (error_) return;
+	uint64_t delay = received > last_ ? (received - last_) / 1000 : 0;
+	last_ += delay * 1000;
+	GamePadLogRecord record;
+	while (delay > 0xFFFFFFFFULL) {
+	  memset(&record, 0, sizeof(record));
+	  record.delay = 0xFFFFFFFF;
+	  if (fwrite(&record, sizeof(record), 1, file_) != 1) {
+	    error_ = true;
+	    return;
+	  }
+	  delay -= 0xFFFFFFFF;
+	}
+	record.delay = (uint32_t)delay;
+	record.event = event;
+	if (fwrite(&record, sizeof(record), 1, file_) != 1) {
+	  error_ = true;
+	  return;
+	}
+	count_++;
+      }
+    };
+
+
+    /***************************************************
+     * GamePadReplayer
+     *
+     * @brief Plays GamePad log into a pipe which GamePad(replayer) reads.
+     *
+     * Real time (possibly scaled):
+     *   GamePadReplayer replayer("session.aq2g");
+     *   GamePad pad(replayer);
+     *   replayer.start(1.0);
+     *   while (replayer.isPlaying()) { pad.update(); ... }
+     *
+     * Virtual time, as fast as possible and deterministic:
+     *   while (replayer.advance(0.01)) { pad.update(); control(0.01); }
+     ***************************************************/
+    class GamePadReplayer : public GamePadSource {
+    private:
+      GamePadLogHeader header_;
+      std::vector<GamePadLogRecord> records_;
+      std::vector<uint64_t> times_;  ///< nanoseconds since startTime
+      std::atomic<size_t> next_;
+      std::atomic<uint64_t> cursor_;
+      int fds_[2];
+      std::atomic<bool> running_;
+      std::atomic<bool> playing_;
+      std::thread* thread_;
+
+    public:
+      GamePadReplayer(const char* filename) : next_(0), cursor_(0), running_(false), playing_(false), thread_(nullptr) {
+	FILE* file = fopen(filename, "rb");
+	if (!file) throw GamePadLogException(std::string("Can not open ") + filename);
+	if (fread(&header_, sizeof(header_), 1, file) != 1 || memcmp(header_.magic, "AQ2G", 4) != 0) {
+	  fclose(file);
+	  throw GamePadLogException(std::string("Not a GamePad log: ") + filename);
+	}
+	GamePadLogRecord record;
+	uint64_t time = 0;
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+	  time += (uint64_t)record.delay * 1000;
+	  if (record.event.type == 0) continue;
+	  records_.push_back(record);
+	  times_.push_back(time);
+	}
+	fclose(file);
+	if (pipe2(fds_, O_CLOEXEC | O_NONBLOCK) != 0) throw GamePadLogException("Can not create pipe");
+	fcntl(fds_[1], F_SETPIPE_SZ, 1024 * 1024);
+      }
+
+      virtual ~GamePadReplayer() {
+	stop();
+	::close(fds_[0]);
+	::close(fds_[1]);
+      }
+
+    private:
+      GamePadReplayer(const GamePadReplayer&);
+      GamePadReplayer& operator=(const GamePadReplayer&);
+
+    public:
+      virtual int getFileDescriptor() const { return fds_[0]; }
+      virtual int getNumAxes() const { return header_.numAxes; }
+      virtual int getNumButtons() const { return header_.numButtons; }
+      virtual std::string getName() const { return std::string(header_.name, strnlen(header_.name, sizeof(header_.name))); }
+
+      size_t getNumRecords() const { return records_.size(); }
+
+      /**
+       * @brief Length of the log in seconds.
+       */
+      double getDuration() const { return times_.empty() ? 0.0 : times_.back() * 1e-9; }
+
+      /**
+       * @brief Replay position in seconds since the beginning of recording.
+       */
+      double getPosition() const { return cursor_ * 1e-9; }
+
+      bool isFinished() const { return next_ >= records_.size(); }
+
+      /**
+       * @brief Move replay position forward by seconds and write records recorded until then.
+       *
+       * Records which do not fit the pipe are written by the next call.
+       * @return false if all records had been written before this call.
+       */
+      bool advance(const double seconds) {
+	if (isFinished()) return false;
+	cursor_ += (uint64_t)(seconds * 1e9);
+	flushUntil(cursor_);
+	return true;
+      }
+
+      /**
+       * @brief Replay in background thread.
+       * @param speed 1.0 for real time, 2.0 for twice faster. 0 for as fast as the pipe is read.
+       */
+      void start(const double speed = 1.0) {
+	if (thread_) return;
+	running_ = playing_ = true;
+	thread_ = new std::thread([this, speed]() {
+	  const uint64_t begin = GamePadEvent::now();
+	  const uint64_t offset = cursor_;
+	  while (running_ && !isFinished()) {
+	    if (speed > 0) {
+	      const uint64_t due = offset + (uint64_t)((times_[next_] - offset) / speed);
+	      const uint64_t now = GamePadEvent::now() - begin;
+	      if (due > now) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(due - now < 10000000 ? due - now : 10000000));
+		continue;
+	      }
+	    }
+	    cursor_ = times_[next_];
+	    if (!flushUntil(cursor_)) {
+	      struct pollfd pfd;
+	      pfd.fd = fds_[1];
+	      pfd.events = POLLOUT;
+	      poll(&pfd, 1, 10);
+	    }
+	  }
+	  playing_ = false;
+	});
+      }
+
+      void stop() {
+	if (!thread_) return;
+	running_ = false;
+	thread_->join();
+	delete thread_;
+	thread_ = nullptr;
+      }
+
+      /**
+       * @brief true while start()ed replay has records to write.
+       */
+      bool isPlaying() const { return playing_; }
+
+    private:
+      /**
+       * @return false if pipe is full.
+       */
+      bool flushUntil(const uint64_t time) {
+	struct js_event batch[GamePad::MAX_EVENTS_PER_READ];
+	while (next_ < records_.size() && times_[next_] <= time) {
+	  size_t n = 0;
+	  while (n < (size_t)GamePad::MAX_EVENTS_PER_READ && next_ + n < records_.size() && times_[next_ + n] <= time) {
+	    batch[n] = records_[next_ + n].event;
+	    n++;
+	  }
+	  const ssize_t written = ::write(fds_[1], batch, n * sizeof(struct js_event));
+	  if (written <= 0) return false;
+	  next_ += written / sizeof(struct js_event);
+	}
+	return true;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifdef __linux__
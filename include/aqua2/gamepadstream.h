@@ -0,0 +1,519 @@
+/********************************************************
+ * gamepadstream.h
+ *
+ * Delta-encoded GamePadState streaming over UDP or TCP (Linux only).
+ *
+ * GamePadStreamPublisher sends only the axes and buttons which
+ * changed since the previous packet, quantized to int16 / bits,
+ * and a full keyframe periodically. GamePadStreamSubscriber
+ * rebuilds GamePadState and measures end-to-end latency.
+ *
+ * Packet (little endian):
+ *   uint8  magic (0xA2)
+ *   uint8  flags (KEYFRAME | AXES | BUTTONS | CHANGED)
+ *   uint16 sequence
+ *   uint64 timestamp   GamePadState::timestamp of publisher [ns]
+ *   KEYFRAME: uint8 numAxes, uint8 numButtons
+ *   AXES:     uint32 axis mask, int16 value of each axis in the mask
+ *   BUTTONS:  (numButtons + 7) / 8 bytes of button bits
+ * On TCP each packet is preceded by uint16 length.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include "gamepad.h"
+#include "socket.h"
+#include "seqlock.h"
+#include "alignednew.h"
+#include "histogram.h"
+#include "codec.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netinet/tcp.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief Wire format shared by GamePadStreamPublisher and GamePadStreamSubscriber.
+     */
+    struct GamePadStreamFormat {
+      const static uint8_t MAGIC = 0xA2;
+
+      const static uint8_t KEYFRAME = 0x01;  ///< full state with numAxes / numButtons
+      const static uint8_t AXES = 0x02;      ///< axis mask and values follow
+      const static uint8_t BUTTONS = 0x04;   ///< button bits follow
+      const static uint8_t CHANGED = 0x08;   ///< state changed since previous packet (latency is measured)
+
+      const static size_t HEADER_SIZE = 12;
+      const static size_t MAX_PACKET_SIZE = HEADER_SIZE + 2 + 4 + 2 * GamePadState::MAX_AXES + GamePadState::MAX_BUTTONS / 8;
+
+      static int16_t quantize(const float value, const float range) {
+	const float v = value / range * 32767.0f;
+	return (int16_t)(v >= 32767.0f ? 32767 : (v <= -32767.0f ? -32767 : (v < 0 ? v - 0.5f : v + 0.5f)));
+      }
+
+      static float dequantize(const int16_t value, const float range) { return value * range / 32767.0f; }
+
+      static uint64_t buttonMask(const int numButtons) {
+	return numButtons >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << numButtons) - 1);
+      }
+    };
+
+
+    /***************************************************
+     * GamePadStreamPublisher
+     *
+     * @brief Sends GamePadState to GamePadStreamSubscriber.
+     *
+     * Call publish() after every GamePad::update(). A packet is sent at
+     * once when the quantized state changed, and a keyframe is sent when
+     * keyframe interval passed since the last one (also without change),
+     * so publish() should be called at least that often.
+     *
+     * Usage:
+     *   GamePadStreamPublisher publisher("robot.local", 5600);  // UDP
+     *   while (true) {
+     *     pad.update();
+     *     publisher.publish(pad);
+     *   }
+     ***************************************************/
+    class GamePadStreamPublisher {
+    public:
+      const static int DEFAULT_KEYFRAME_INTERVAL_MSEC = 100;
+
+    private:
+      int fd_;
+      bool udp_;
+      float range_;
+      uint64_t keyframeInterval_;  ///< nanoseconds
+      bool hasLast_;
+      uint16_t sequence_;
+      uint64_t lastKeyframe_;
+      uint64_t lastStateSequence_;
+      uint8_t numAxes_;
+      uint8_t numButtons_;
+      int16_t axes_[GamePadState::MAX_AXES];  ///< last sent values
+      uint64_t buttons_;
+      uint64_t packets_;
+      uint64_t keyframes_;
+      uint64_t bytes_;
+
+    public:
+      /**
+       * @brief Stream over connected TCP socket. TCP_NODELAY is set on it.
+       */
+      GamePadStreamPublisher(Socket& socket, const int keyframeIntervalMsec = DEFAULT_KEYFRAME_INTERVAL_MSEC) :
+	fd_(socket.getFileDescriptor()), udp_(false) {
+	init(keyframeIntervalMsec);
+	const int one = 1;
+	setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      }
+
+      /**
+       * @brief Stream as UDP datagrams to host:port.
+       */
+      GamePadStreamPublisher(const char* host, const unsigned int port, const int keyframeIntervalMsec = DEFAULT_KEYFRAME_INTERVAL_MSEC) :
+	fd_(-1), udp_(true) {
+	init(keyframeIntervalMsec);
+	struct addrinfo hints, *addr;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo(host, nullptr, &hints, &addr) != 0) throw SocketException("getaddrinfo failed.");
+	struct sockaddr_in sockaddr_ = *(struct sockaddr_in*)addr->ai_addr;
+	freeaddrinfo(addr);
+	sockaddr_.sin_port = htons(port);
+	if ((fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0) throw SocketException("socket function failed.");
+	if (::connect(fd_, (struct sockaddr*)&sockaddr_, sizeof(sockaddr_)) < 0) {
+	  ::close(fd_);
+	  throw SocketException("connect failed.");
+	}
+      }
+
+      virtual ~GamePadStreamPublisher() {
+	if (udp_) ::close(fd_);
+      }
+
+    private:
+      GamePadStreamPublisher(const GamePadStreamPublisher&);
+      GamePadStreamPublisher& operator=(const GamePadStreamPublisher&);
+
+      void init(const int keyframeIntervalMsec) {
+	range_ = 1.0f;
+	setKeyframeInterval(keyframeIntervalMsec);
+	hasLast_ = false;
+	sequence_ = 0;
+	lastKeyframe_ = lastStateSequence_ = 0;
+	numAxes_ = numButtons_ = 0;
+	memset(axes_, 0, sizeof(axes_));
+	buttons_ = 0;
+	packets_ = keyframes_ = bytes_ = 0;
+      }
+
+    public:
+      /**
+       * @brief Axis value mapped to full int16 range (eg., GamePad::getAxisScale()). Same on subscriber.
+       */
+      void setAxisRange(const float range) { range_ = range; }
+
+      void setKeyframeInterval(const int msec) { keyframeInterval_ = (uint64_t)msec * 1000000; }
+
+      /**
+       * @brief Force keyframe at next publish().
+       */
+      void requestKeyframe() { hasLast_ = false; }
+
+      uint64_t getPacketsSent() const { return packets_; }
+      uint64_t getKeyframesSent() const { return keyframes_; }
+      uint64_t getBytesSent() const { return bytes_; }
+
+      /**
+       * @brief Encode packet for state (delta from the previous encoded packet).
+       * @param dst at least GamePadStreamFormat::MAX_PACKET_SIZE bytes
+       * @return packet size. 0 if there is nothing to send.
+       */
+      size_t encode(const GamePadState& state, const uint64_t now, uint8_t* dst) {
+	const bool keyframe = !hasLast_ || now - lastKeyframe_ >= keyframeInterval_ ||
+	  state.numAxes != numAxes_ || state.numButtons != numButtons_;
+	if (!keyframe && state.sequence == lastStateSequence_) return 0;
+	lastStateSequence_ = state.sequence;
+
+	const int numAxes = state.numAxes < GamePadState::MAX_AXES ? state.numAxes : GamePadState::MAX_AXES;
+	const int numButtons = state.numButtons < GamePadState::MAX_BUTTONS ? state.numButtons : GamePadState::MAX_BUTTONS;
+	int16_t axes[GamePadState::MAX_AXES];
+	uint32_t changedAxes = 0;
+	for (int i = 0; i < numAxes; i++) {
+	  axes[i] = GamePadStreamFormat::quantize(state.axes[i], range_);
+	  if (axes[i] != axes_[i]) changedAxes |= (uint32_t)1 << i;
+	}
+	const uint64_t buttons = state.buttons & GamePadStreamFormat::buttonMask(numButtons);
+	const bool changed = changedAxes || buttons != buttons_ || !hasLast_;
+	if (!keyframe && !changed) return 0;
+
+	uint8_t flags = changed ? GamePadStreamFormat::CHANGED : 0;
+	if (keyframe) {
+	  flags |= GamePadStreamFormat::KEYFRAME | GamePadStreamFormat::AXES | GamePadStreamFormat::BUTTONS;
+	  changedAxes = numAxes >= 32 ? 0xFFFFFFFF : (((uint32_t)1 << numAxes) - 1);
+	} else {
+	  if (changedAxes) flags |= GamePadStreamFormat::AXES;
+	  if (buttons != buttons_) flags |= GamePadStreamFormat::BUTTONS;
+	}
+
+	uint8_t* p = dst;
+	*p++ = GamePadStreamFormat::MAGIC;
+	*p++ = flags;
+	detail::store(p, sequence_++, LittleEndian()); p += 2;
+	detail::store(p, state.timestamp, LittleEndian()); p += 8;
+	if (flags & GamePadStreamFormat::KEYFRAME) {
+	  *p++ = (uint8_t)numAxes;
+	  *p++ = (uint8_t)numButtons;
+	}
+	if (flags & GamePadStreamFormat::AXES) {
+	  detail::store(p, changedAxes, LittleEndian()); p += 4;
+	  for (int i = 0; i < numAxes; i++) {
+	    if (!((changedAxes >> i) & 1)) continue;
+	    detail::store(p, (uint16_t)axes[i], LittleEndian()); p += 2;
+	  }
+	}
+	if (flags & GamePadStreamFormat::BUTTONS) {
+	  for (int i = 0; i < numButtons; i += 8) *p++ = (uint8_t)(buttons >> i);
+	}
+
+	memcpy(axes_, axes, sizeof(int16_t) * numAxes);
+	buttons_ = buttons;
+	numAxes_ = (uint8_t)numAxes;
+	numButtons_ = (uint8_t)numButtons;
+	hasLast_ = true;
+	if (keyframe) {
+	  lastKeyframe_ = now;
+	  keyframes_++;
+	}
+	return p - dst;
+      }
+
+      /**
+       * @return bytes sent. 0 if there was nothing to send, -1 on error (eg., TCP peer closed).
+       */
+      int publish(const GamePadState& state, const uint64_t now = GamePadEvent::now()) {
+	uint8_t frame[2 + GamePadStreamFormat::MAX_PACKET_SIZE];
+	uint8_t* packet = udp_ ? frame : frame + 2;
+	const size_t size = encode(state, now, packet);
+	if (size == 0) return 0;
+	if (!udp_) detail::store(frame, (uint16_t)size, LittleEndian());
+	const size_t length = udp_ ? size : size + 2;
+	const ssize_t sent = ::send(fd_, frame, length, MSG_NOSIGNAL);
+	if (sent != (ssize_t)length) {
+	  if (udp_ && sent < 0 && (errno == ECONNREFUSED || errno == EAGAIN || errno == ENOBUFS)) return 0; // lost like on the wire
+	  return -1;
+	}
+	packets_++;
+	bytes_ += length;
+	return (int)length;
+      }
+
+      int publish(const GamePad& pad) { return publish(pad.state()); }
+    };
+
+
+    /***************************************************
+     * GamePadStreamSubscriber
+     *
+     * @brief Receives GamePadStreamPublisher and rebuilds GamePadState.
+     *
+     * spinOnce() works like GamePad::update(): state() is published once
+     * per call and pressed() / released() edges last one call. Deltas
+     * are applied from the first keyframe. Lost UDP packets are counted
+     * and isSynchronized() is false until the next keyframe (values in
+     * later deltas are absolute, so only axes / buttons changed in lost
+     * packets may be stale). Late or duplicated deltas are discarded.
+     * A keyframe always resynchronizes, even when its sequence looks old
+     * (eg., the publisher restarted).
+     *
+     * Latency is measured for packets carrying changes, from publisher's
+     * GamePad::update() to spinOnce(). Both ends use steady clock, so it is
+     * exact on one host. Across hosts, set the clock offset (eg., from PTP).
+     *
+     * Usage:
+     *   GamePadStreamSubscriber subscriber(5600);  // UDP
+     *   while (true) {
+     *     subscriber.spinOnce(10);
+     *     GamePadState state = subscriber.state();
+     *   }
+     ***************************************************/
+    class GamePadStreamSubscriber : public AlignedNew<GamePadStreamSubscriber> {
+    private:
+      int fd_;
+      bool udp_;
+      float range_;
+      int64_t clockOffset_;
+      bool hasKeyframe_;
+      bool synchronized_;
+      uint16_t expected_;
+      GamePadState state_;
+      SeqLock<GamePadState> published_;
+      LatencyHistogram latency_;
+      uint64_t packets_;
+      uint64_t keyframes_;
+      uint64_t lost_;
+      uint64_t discarded_;
+      uint8_t buffer_[4096];  ///< TCP stream
+      size_t length_;
+
+    public:
+      /**
+       * @brief Receive from connected TCP socket.
+       */
+      GamePadStreamSubscriber(Socket& socket) : fd_(socket.getFileDescriptor()), udp_(false) {
+	init();
+      }
+
+      /**
+       * @brief Receive UDP datagrams on port (0 for any free port, see getPort()).
+       */
+      GamePadStreamSubscriber(const unsigned int port) : fd_(-1), udp_(true) {
+	init();
+	if ((fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0) throw SocketException("socket function failed.");
+	struct sockaddr_in sockaddr_;
+	memset(&sockaddr_, 0, sizeof(sockaddr_));
+	sockaddr_.sin_family = AF_INET;
+	sockaddr_.sin_addr.s_addr = INADDR_ANY;
+	sockaddr_.sin_port = htons(port);
+	if (::bind(fd_, (struct sockaddr*)&sockaddr_, sizeof(sockaddr_)) < 0) {
+	  ::close(fd_);
+	  throw SocketException("Bind Failed.");
+	}
+      }
+
+      virtual ~GamePadStreamSubscriber() {
+	if (udp_) ::close(fd_);
+      }
+
+    private:
+      GamePadStreamSubscriber(const GamePadStreamSubscriber&);
+      GamePadStreamSubscriber& operator=(const GamePadStreamSubscriber&);
+
+      void init() {
+	range_ = 1.0f;
+	clockOffset_ = 0;
+	hasKeyframe_ = synchronized_ = false;
+	expected_ = 0;
+	memset(&state_, 0, sizeof(state_));
+	packets_ = keyframes_ = lost_ = discarded_ = 0;
+	length_ = 0;
+      }
+
+    public:
+      int getFileDescriptor() const { return fd_; }
+
+      /**
+       * @brief Bound UDP port.
+       */
+      unsigned int getPort() const {
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	if (getsockname(fd_, (struct sockaddr*)&addr, &len) < 0) throw SocketException("getsockname failed.");
+	return ntohs(addr.sin_port);
+      }
+
+      void setAxisRange(const float range) { range_ = range; }
+
+      /**
+       * @brief Subscriber steady clock minus publisher steady clock in nanoseconds.
+       */
+      void setClockOffset(const int64_t ns) { clockOffset_ = ns; }
+
+      /**
+       * @brief Copy of the state at the end of the last spinOnce(). Any thread.
+       */
+      GamePadState state() const { return published_.load(); }
+
+      uint64_t stateVersion() const { return published_.version(); }
+
+      /**
+       * @brief true after a keyframe and no packet lost since.
+       */
+      bool isSynchronized() const { return synchronized_; }
+
+      uint64_t getReceivedPackets() const { return packets_; }
+      uint64_t getKeyframes() const { return keyframes_; }
+      uint64_t getLostPackets() const { return lost_; }
+      uint64_t getDiscardedPackets() const { return discarded_; }
+
+      /**
+       * @brief End-to-end latency of changes in nanoseconds.
+       */
+      LatencyHistogramSnapshot latency() const { return latency_.snapshot(); }
+
+      void resetLatency() { latency_.reset(); }
+
+      /**
+       * @brief Wait packets and apply them.
+       * @param timeoutMsec maximum time to wait. 0 to poll.
+       * @return number of packets applied, -1 if TCP connection is closed.
+       */
+      int spinOnce(const int timeoutMsec) {
+	struct pollfd pfd;
+	pfd.fd = fd_;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	poll(&pfd, 1, timeoutMsec);
+
+	int applied = 0;
+	const uint64_t now = GamePadEvent::now();
+	state_.previousButtons = state_.buttons;
+	if (udp_) {
+	  uint8_t packet[GamePadStreamFormat::MAX_PACKET_SIZE + 1];
+	  ssize_t n;
+	  while ((n = ::recv(fd_, packet, sizeof(packet), MSG_DONTWAIT)) > 0) {
+	    if (apply(packet, n, now)) applied++;
+	  }
+	} else if (pfd.revents) {
+	  const ssize_t n = ::recv(fd_, buffer_ + length_, sizeof(buffer_) - length_, MSG_DONTWAIT);
+	  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) return -1;
+	  if (n > 0) length_ += n;
+	  size_t offset = 0;
+	  while (length_ - offset >= 2) {
+	    const size_t size = detail::load<uint16_t>(buffer_ + offset, LittleEndian());
+	    if (length_ - offset < 2 + size) break;
+	    if (apply(buffer_ + offset + 2, size, now)) applied++;
+	    offset += 2 + size;
+	  }
+	  memmove(buffer_, buffer_ + offset, length_ - offset);
+	  length_ -= offset;
+	}
+	state_.sequence++;
+	state_.timestamp = now;
+	published_.store(state_);
+	return applied;
+      }
+
+      /**
+       * @brief Apply one packet to the state (without publishing it).
+       * @param now receive time (steady clock nanoseconds) for latency
+       * @return false if the packet is broken, a late delta or before the first keyframe.
+       */
+      bool apply(const uint8_t* packet, const size_t size, const uint64_t now) {
+	if (size < GamePadStreamFormat::HEADER_SIZE || packet[0] != GamePadStreamFormat::MAGIC) return discard();
+	const uint8_t flags = packet[1];
+	const uint16_t sequence = detail::load<uint16_t>(packet + 2, LittleEndian());
+	const uint64_t timestamp = detail::load<uint64_t>(packet + 4, LittleEndian());
+	const uint8_t* p = packet + GamePadStreamFormat::HEADER_SIZE;
+	const uint8_t* end = packet + size;
+
+	const bool keyframe = (flags & GamePadStreamFormat::KEYFRAME) != 0;
+	if (!keyframe && !hasKeyframe_) return discard();
+	if (hasKeyframe_) {
+	  const uint16_t gap = (uint16_t)(sequence - expected_);
+	  if (gap >= 0x8000) {
+	    if (!keyframe) return discard(); // late or duplicated
+	  } else if (gap > 0) {
+	    lost_ += gap;
+	    synchronized_ = false;
+	  }
+	}
+
+	uint8_t numAxes = state_.numAxes, numButtons = state_.numButtons;
+	if (keyframe) {
+	  if (end - p < 2) return discard();
+	  numAxes = p[0];
+	  numButtons = p[1];
+	  p += 2;
+	  if (numAxes > GamePadState::MAX_AXES || numButtons > GamePadState::MAX_BUTTONS) return discard();
+	}
+	uint32_t mask = 0;
+	if (flags & GamePadStreamFormat::AXES) {
+	  if (end - p < 4) return discard();
+	  mask = detail::load<uint32_t>(p, LittleEndian());
+	  p += 4;
+	  if (numAxes < 32 && (mask >> numAxes)) return discard();
+	  if (end - p < 2 * __builtin_popcount(mask)) return discard();
+	}
+	const size_t buttonBytes = (numButtons + 7) / 8;
+	if ((flags & GamePadStreamFormat::BUTTONS) && (size_t)(end - p) < 2 * (size_t)__builtin_popcount(mask) + buttonBytes) return discard();
+
+	for (int i = 0; i < numAxes; i++) {
+	  if (!((mask >> i) & 1)) continue;
+	  state_.axes[i] = GamePadStreamFormat::dequantize((int16_t)detail::load<uint16_t>(p, LittleEndian()), range_);
+	  p += 2;
+	}
+	if (flags & GamePadStreamFormat::BUTTONS) {
+	  uint64_t buttons = 0;
+	  for (size_t i = 0; i < buttonBytes; i++) buttons |= (uint64_t)p[i] << (8 * i);
+	  state_.buttons = buttons & GamePadStreamFormat::buttonMask(numButtons);
+	}
+	if (keyframe) {
+	  for (int i = numAxes; i < GamePadState::MAX_AXES; i++) state_.axes[i] = 0.0f;
+	  state_.numAxes = numAxes;
+	  state_.numButtons = numButtons;
+	  hasKeyframe_ = synchronized_ = true;
+	  keyframes_++;
+	}
+	expected_ = (uint16_t)(sequence + 1);
+	packets_++;
+
+	if (flags & GamePadStreamFormat::CHANGED) {
+	  const int64_t sent = (int64_t)timestamp + clockOffset_;
+	  if (sent > 0 && (uint64_t)sent <= now) latency_.add(now - (uint64_t)sent);
+	}
+	return true;
+      }
+
+    private:
+      bool discard() {
+	discarded_++;
+	return false;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifdef __linux__
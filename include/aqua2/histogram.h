@@ -0,0 +1,114 @@
+/********************************************************
+ * histogram.h
+ *
+ * Lock-free log2 latency histogram.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief Add n to counter which has only one writer thread (no lock prefixed instruction).
+     */
+    inline void relaxedIncrement(std::atomic<uint64_t>& c, const uint64_t n = 1) {
+      c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Copy of LatencyHistogram.
+     *
+     * Bucket i counts samples in [2^i, 2^(i+1)) nanoseconds. Bucket 0 also counts 0.
+     */
+    struct LatencyHistogramSnapshot {
+      const static int NUM_BUCKETS = 40;
+
+      uint64_t buckets[NUM_BUCKETS];
+      uint64_t count;
+      uint64_t total;  ///< nanoseconds
+      uint64_t max;    ///< nanoseconds
+
+      double mean() const { return count ? (double)total / count : 0.0; }
+
+      /**
+       * @brief Upper bound of the bucket containing p-th quantile (0.0 - 1.0) in nanoseconds.
+       */
+      uint64_t percentile(const double p) const {
+	if (count == 0) return 0;
+	const uint64_t rank = (uint64_t)(p * (count - 1)) + 1;
+	uint64_t sum = 0;
+	for (int i = 0; i < NUM_BUCKETS; i++) {
+	  sum += buckets[i];
+	  if (sum >= rank) {
+	    const uint64_t upper = ((uint64_t)2 << i) - 1;
+	    return upper < max ? upper : max;
+	  }
+	}
+	return max;
+      }
+    };
+
+
+    /**
+     * @brief Log2 bucketed latency histogram.
+     *
+     * add() is wait-free and cheap (no lock prefixed instruction) as long as
+     * one thread adds samples. Any thread can take snapshot().
+     */
+    class LatencyHistogram {
+    public:
+      const static int NUM_BUCKETS = LatencyHistogramSnapshot::NUM_BUCKETS;
+
+    private:
+      std::atomic<uint64_t> buckets_[NUM_BUCKETS];
+      std::atomic<uint64_t> count_;
+      std::atomic<uint64_t> total_;
+      std::atomic<uint64_t> max_;
+
+    public:
+      LatencyHistogram() { reset(); }
+
+      static int bucketOf(uint64_t ns) {
+#if defined(__GNUC__) || defined(__clang__)
+	int b = ns ? 63 - __builtin_clzll(ns) : 0;
+#else
+	int b = 0;
+	while (ns >>= 1) b++;
+#endif
+	return b < NUM_BUCKETS ? b : NUM_BUCKETS - 1;
+      }
+
+    public:
+      void add(const uint64_t ns) {
+	relaxedIncrement(buckets_[bucketOf(ns)]);
+	relaxedIncrement(count_);
+	relaxedIncrement(total_, ns);
+	if (ns > max_.load(std::memory_order_relaxed)) max_.store(ns, std::memory_order_relaxed);
+      }
+
+      void reset() {
+	for (int i = 0; i < NUM_BUCKETS; i++) buckets_[i].store(0, std::memory_order_relaxed);
+	count_.store(0, std::memory_order_relaxed);
+	total_.store(0, std::memory_order_relaxed);
+	max_.store(0, std::memory_order_relaxed);
+      }
+
+      LatencyHistogramSnapshot snapshot() const {
+	LatencyHistogramSnapshot s;
+	for (int i = 0; i < NUM_BUCKETS; i++) s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+	s.count = count_.load(std::memory_order_relaxed);
+	s.total = total_.load(std::memory_order_relaxed);
+	s.max = max_.load(std::memory_order_relaxed);
+	return s;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,112 @@
+/********************************************************
+ * inputlatency.h
+ *
+ * Input-to-application latency of GamePad and keyboard.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+#include "histogram.h"
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief Copy of InputLatencyMonitor.
+     */
+    struct InputLatencySnapshot {
+      int source;                          ///< InputLatencyMonitor::KERNEL_TIME, CALLBACK_TIME or READ_TIME
+      LatencyHistogramSnapshot latency;    ///< input stamped at the earliest point to consumed by application [ns]
+      LatencyHistogramSnapshot interval;   ///< between polls (update() / kbhit()) [ns]
+    };
+
+
+    /***************************************************
+     * InputLatencyMonitor
+     *
+     * @brief Histograms of how long inputs wait before the application gets them.
+     *
+     * Each input is stamped at the earliest point the device offers
+     * (source) and again when the application consumes it. With
+     * KERNEL_TIME or CALLBACK_TIME, latency includes the delay caused by
+     * polling. With READ_TIME the input is stamped when it is polled, and
+     * interval (about twice the mean hidden delay) is what to look at.
+     *
+     * One monitor per device. Updated by the thread polling the device,
+     * snapshot() from any thread. Nothing is allocated.
+     *
+     * Usage:
+     *   InputLatencyMonitor monitor;
+     *   pad.setLatencyMonitor(&monitor);
+     *   ...
+     *   std::cout << monitor.snapshot().latency.percentile(0.99) << std::endl;
+     ***************************************************/
+    class InputLatencyMonitor {
+    public:
+      const static int KERNEL_TIME = 0;    ///< event time given by driver (evdev)
+      const static int CALLBACK_TIME = 1;  ///< input callback of OS (macOS HID)
+      const static int READ_TIME = 2;      ///< when read or polled by the application (joydev, Windows, keyboard)
+
+    private:
+      int source_;
+      uint64_t lastPoll_;
+      LatencyHistogram latency_;
+      LatencyHistogram interval_;
+
+    public:
+      InputLatencyMonitor() : source_(READ_TIME), lastPoll_(0) {}
+
+    private:
+      InputLatencyMonitor(const InputLatencyMonitor&);
+      InputLatencyMonitor& operator=(const InputLatencyMonitor&);
+
+    public:
+      static uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+
+      /**
+       * @brief Set by the device the monitor is attached to.
+       */
+      void setSource(const int source) { source_ = source; }
+
+      int getSource() const { return source_; }
+
+      /**
+       * @brief Device was polled at now.
+       */
+      void poll(const uint64_t now) {
+	if (lastPoll_ && now > lastPoll_) interval_.add(now - lastPoll_);
+	lastPoll_ = now;
+      }
+
+      /**
+       * @brief Input stamped at stamp was consumed at now (both steady clock nanoseconds).
+       */
+      void consume(const uint64_t stamp, const uint64_t now) {
+	latency_.add(now > stamp ? now - stamp : 0);
+      }
+
+      void reset() {
+	lastPoll_ = 0;
+	latency_.reset();
+	interval_.reset();
+      }
+
+      InputLatencySnapshot snapshot() const {
+	InputLatencySnapshot s;
+	s.source = source_;
+	s.latency = latency_.snapshot();
+	s.interval = interval_.snapshot();
+	return s;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
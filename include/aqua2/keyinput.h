@@ -7,10 +7,18 @@
 #include <conio.h>
 
 #else
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 #include <termios.h>
 #endif
 
+#include "inputlatency.h"
+#include "spscring.h"
+#include "alignednew.h"
+
 namespace ssr {
     namespace aqua2 {
 
@@ -20,6 +28,12 @@ namespace ssr {
 
 #else
         static struct termios m_oldTermios;
+        static bool m_termiosSaved = false;
+#endif
+
+#ifdef WIN32
+        static InputLatencyMonitor* m_keyLatencyMonitor = nullptr;
+        static uint64_t m_keyStamp = 0;  ///< when kbhit() found input first
 #endif
 
 
@@ -32,6 +46,24 @@ namespace ssr {
             AQUA2_KEY_RIGHT,
             AQUA2_KEY_SPACE,
             AQUA2_KEY_ESCAPE,
+            AQUA2_KEY_HOME,
+            AQUA2_KEY_END,
+            AQUA2_KEY_INSERT,
+            AQUA2_KEY_DELETE,
+            AQUA2_KEY_PAGE_UP,
+            AQUA2_KEY_PAGE_DOWN,
+            AQUA2_KEY_F1,
+            AQUA2_KEY_F2,
+            AQUA2_KEY_F3,
+            AQUA2_KEY_F4,
+            AQUA2_KEY_F5,
+            AQUA2_KEY_F6,
+            AQUA2_KEY_F7,
+            AQUA2_KEY_F8,
+            AQUA2_KEY_F9,
+            AQUA2_KEY_F10,
+            AQUA2_KEY_F11,
+            AQUA2_KEY_F12,
         };
 
         static void init_scr() {
@@ -39,7 +71,7 @@ namespace ssr {
             system("cls");
         #else
             struct termios myTermios;
-            tcgetattr(fileno(stdin), &m_oldTermios);
+            m_termiosSaved = tcgetattr(fileno(stdin), &m_oldTermios) == 0;
             tcgetattr(fileno(stdin), &myTermios);
             
             myTermios.c_cc[VTIME] = 0;
@@ -54,11 +86,16 @@ namespace ssr {
         #endif
         }
 
+        /**
+         * @brief Clear the screen. See TerminalScreen (terminalscreen.h) for redrawing dashboards.
+         */
         static void clear_scr() {
         #ifdef WIN32
             system("cls");
         #else
-            system("clear");
+            static const char clear[] = "\x1b[H\x1b[2J";
+            fflush(stdout);
+            if (::write(fileno(stdout), clear, sizeof(clear) - 1) < 0) return;
         #endif
         }
 
@@ -66,66 +103,331 @@ namespace ssr {
         #ifdef WIN32
             system("cls");
         #else
-            system("reset");
+            static const char reset[] = "\x1b[0m\x1b[?25h\x1b[H\x1b[2J";
+            fflush(stdout);
+            if (m_termiosSaved) tcsetattr(fileno(stdin), TCSANOW, &m_oldTermios);
+            if (::write(fileno(stdout), reset, sizeof(reset) - 1) < 0) return;
         #endif
         }
 
-        static int kbhit() {
+#ifndef WIN32
+        /***************************************************
+         * KeyInput
+         *
+         * @brief Non-blocking buffered keyboard decoder (Unix only).
+         *
+         * update() reads everything pending on fd with one read() and
+         * decodes it with an incremental state machine, so escape
+         * sequences split across reads are still decoded. Keys are
+         * queued until get(). A lone ESC is reported as AQUA2_KEY_ESCAPE
+         * when no byte follows within escape timeout.
+         *
+         * A terminal is set to non-canonical, no echo, VMIN=0 / VTIME=0,
+         * other files (eg., pipe) to O_NONBLOCK. Both are restored by the
+         * destructor. With configure false, the mode is left to the caller
+         * (eg., init_scr() or TerminalScreen) and update() polls fd before
+         * read() so that it never blocks. getFileDescriptor() can be waited with poll / epoll,
+         * which also reports hang up of a terminal (POLLHUP): read() of a
+         * VMIN=0 terminal returns 0 both when idle and after hang up.
+         *
+         * Usage:
+         *   KeyInput keys;
+         *   while (true) {
+         *     keys.update();
+         *     for (int key; (key = keys.get()) != -1;) { ... }
+         *   }
+         ***************************************************/
+        class KeyInput : public AlignedNew<KeyInput> {
+        public:
+            const static int DEFAULT_ESCAPE_TIMEOUT_MSEC = 25;
+            const static size_t READ_SIZE = 256;
+
+            struct KeyEvent {
+                int key;
+                uint64_t stamp;  ///< steady clock nanoseconds when read
+            };
+
+        private:
+            enum State { GROUND, ESCAPE, CSI, SS3 };
+
+            int fd_;
+            bool tty_;
+            bool configure_;
+            struct termios oldTermios_;
+            int oldFlags_;
+            State state_;
+            int param_;          ///< first numeric parameter of CSI
+            bool paramDone_;
+            uint64_t lastByte_;
+            uint64_t escapeTimeout_;
+            bool eof_;
+            SpscRing<KeyEvent, 256> keys_;
+            uint64_t dropped_;
+            InputLatencyMonitor* monitor_;
+
+        public:
+            /**
+             * @param configure false to leave the terminal mode and file flags of fd as they are.
+             */
+            KeyInput(const int fd = 0, const bool configure = true) : fd_(fd), tty_(isatty(fd) != 0), configure_(configure), oldFlags_(-1),
+                state_(GROUND), param_(0), paramDone_(false), lastByte_(0), escapeTimeout_((uint64_t)DEFAULT_ESCAPE_TIMEOUT_MSEC * 1000000),
+                eof_(false), dropped_(0), monitor_(nullptr) {
+                if (configure_ && tty_) {
+                    struct termios t;
+                    tcgetattr(fd_, &oldTermios_);
+                    t = oldTermios_;
+                    t.c_lflag &= ~(ECHO | ICANON);
+                    t.c_cc[VMIN] = 0;
+                    t.c_cc[VTIME] = 0;
+                    tcsetattr(fd_, TCSANOW, &t);
+                } else if (configure_) {
+                    oldFlags_ = fcntl(fd_, F_GETFL);
+                    if (oldFlags_ >= 0) fcntl(fd_, F_SETFL, oldFlags_ | O_NONBLOCK);
+                }
+            }
+
+            ~KeyInput() {
+                if (!configure_) return;
+                if (tty_) tcsetattr(fd_, TCSANOW, &oldTermios_);
+                else if (oldFlags_ >= 0) fcntl(fd_, F_SETFL, oldFlags_);
+            }
+
+        private:
+            KeyInput(const KeyInput&);
+            KeyInput& operator=(const KeyInput&);
+
+        public:
+            int getFileDescriptor() const { return fd_; }
+
+            void setEscapeTimeout(const int msec) { escapeTimeout_ = (uint64_t)msec * 1000000; }
+
+            /**
+             * @brief Stamp keys at read() and consume them at get(). nullptr to detach.
+             */
+            void setLatencyMonitor(InputLatencyMonitor* monitor) {
+                monitor_ = monitor;
+                if (monitor_) monitor_->setSource(InputLatencyMonitor::READ_TIME);
+            }
+
+            /**
+             * @brief Read pending input and decode it.
+             * @return number of keys decoded, -1 if fd is closed and no key is left.
+             */
+            int update() {
+                const uint64_t now = InputLatencyMonitor::now();
+                if (monitor_) monitor_->poll(now);
+                const size_t before = keys_.size();
+                uint8_t buffer[READ_SIZE];
+                for (;;) {
+                    if (!configure_ && !readable()) break;
+                    const ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+                    if (n < 0) {
+                        if (errno == EINTR) continue;
+                        if (errno != EAGAIN && errno != EWOULDBLOCK) eof_ = true; // eg., EIO of hung up terminal
+                        break;
+                    }
+                    if (n == 0) {
+                        if (!tty_) eof_ = true;
+                        break;
+                    }
+                    for (ssize_t i = 0; i < n; i++) decode(buffer[i], now);
+                    lastByte_ = now;
+                    if ((size_t)n < sizeof(buffer)) break;
+                }
+                if (state_ != GROUND && now - lastByte_ >= escapeTimeout_) {
+                    if (state_ == ESCAPE) push(AQUA2_KEY_ESCAPE, lastByte_);
+                    state_ = GROUND; // incomplete sequence is discarded
+                }
+                if (eof_ && keys_.empty()) return -1;
+                return (int)(keys_.size() - before);
+            }
+
+            bool available() const { return !keys_.empty(); }
+
+            size_t size() const { return keys_.size(); }
+
+            /**
+             * @return next key, or -1 if no key is queued.
+             */
+            int get() {
+                KeyEvent e;
+                return get(e) ? e.key : -1;
+            }
+
+            /**
+             * @brief Next key with the time it was read.
+             * @return false if no key is queued.
+             */
+            bool get(KeyEvent& e) {
+                if (!keys_.pop(e)) return false;
+                if (monitor_) monitor_->consume(e.stamp, InputLatencyMonitor::now());
+                return true;
+            }
+
+            /**
+             * @brief true while an escape sequence is partially read. update() again within escape timeout.
+             */
+            bool isIncomplete() const { return state_ != GROUND; }
+
+            /**
+             * @brief Keys which did not fit the queue.
+             */
+            uint64_t getDroppedKeys() const { return dropped_; }
+
+        private:
+            /// true if read() of fd left blocking returns at once
+            bool readable() const {
+                struct pollfd pfd;
+                pfd.fd = fd_;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+                return poll(&pfd, 1, 0) > 0;
+            }
+
+            void push(const int key, const uint64_t stamp) {
+                KeyEvent e;
+                e.key = key;
+                e.stamp = stamp;
+                if (!keys_.push(e)) dropped_++;
+            }
+
+            void decode(const uint8_t c, const uint64_t now) {
+                switch (state_) {
+                case GROUND:
+                    if (c == 27) state_ = ESCAPE;
+                    else if (c == ' ') push(AQUA2_KEY_SPACE, now);
+                    else if (c != 0) push(c, now);
+                    break;
+                case ESCAPE:
+                    if (c == '[') {
+                        state_ = CSI;
+                        param_ = 0;
+                        paramDone_ = false;
+                    } else if (c == 'O') {
+                        state_ = SS3;
+                    } else if (c == 27) {
+                        push(AQUA2_KEY_ESCAPE, now);
+                    } else {
+                        push(AQUA2_KEY_ESCAPE, now); // Alt + key
+                        state_ = GROUND;
+                        decode(c, now);
+                    }
+                    break;
+                case CSI:
+                    if (c >= '0' && c <= '9') {
+                        if (!paramDone_) param_ = param_ * 10 + (c - '0');
+                    } else if (c >= 0x20 && c <= 0x3F) {
+                        paramDone_ = true; // ';' and other parameter / intermediate bytes
+                    } else {
+                        state_ = GROUND;
+                        if (c >= 0x40 && c <= 0x7E) {
+                            const int key = csiKey(c, param_);
+                            if (key >= 0) push(key, now);
+                        }
+                    }
+                    break;
+                case SS3:
+                    state_ = GROUND;
+                    switch (c) {
+                    case 'A': push(AQUA2_KEY_UP, now); break;
+                    case 'B': push(AQUA2_KEY_DOWN, now); break;
+                    case 'C': push(AQUA2_KEY_RIGHT, now); break;
+                    case 'D': push(AQUA2_KEY_LEFT, now); break;
+                    case 'H': push(AQUA2_KEY_HOME, now); break;
+                    case 'F': push(AQUA2_KEY_END, now); break;
+                    case 'P': case 'Q': case 'R': case 'S': push(AQUA2_KEY_F1 + (c - 'P'), now); break;
+                    }
+                    break;
+                }
+            }
+
+            static int csiKey(const uint8_t final, const int param) {
+                switch (final) {
+                case 'A': return AQUA2_KEY_UP;
+                case 'B': return AQUA2_KEY_DOWN;
+                case 'C': return AQUA2_KEY_RIGHT;
+                case 'D': return AQUA2_KEY_LEFT;
+                case 'H': return AQUA2_KEY_HOME;
+                case 'F': return AQUA2_KEY_END;
+                case '~':
+                    switch (param) {
+                    case 1: case 7: return AQUA2_KEY_HOME;
+                    case 2: return AQUA2_KEY_INSERT;
+                    case 3: return AQUA2_KEY_DELETE;
+                    case 4: case 8: return AQUA2_KEY_END;
+                    case 5: return AQUA2_KEY_PAGE_UP;
+                    case 6: return AQUA2_KEY_PAGE_DOWN;
+                    case 11: case 12: case 13: case 14: case 15: return AQUA2_KEY_F1 + (param - 11);
+                    case 17: case 18: case 19: case 20: case 21: return AQUA2_KEY_F6 + (param - 17);
+                    case 23: case 24: return AQUA2_KEY_F11 + (param - 23);
+                    }
+                }
+                return -1;
+            }
+        };
+
+        /**
+         * @brief KeyInput of stdin used by kbhit() / getch().
+         *
+         * The terminal mode is owned by init_scr() / exit_scr() (or
+         * TerminalScreen), not by this static object: its destructor runs
+         * at exit, after they restored the user's settings.
+         */
+        inline KeyInput& stdin_key_input() {
+            static KeyInput input(0, false);
+            return input;
+        }
+#endif
+
+        /**
+         * @brief Measure latency of keys from the read which found them
+         *        to getch() returning them. nullptr to detach.
+         */
+        static void set_key_latency_monitor(InputLatencyMonitor* monitor) {
         #ifdef WIN32
-            return _kbhit();
+            m_keyLatencyMonitor = monitor;
+            m_keyStamp = 0;
+            if (monitor) monitor->setSource(InputLatencyMonitor::READ_TIME);
         #else
-            fd_set fdset;
-            struct timeval timeout;
-            FD_ZERO( &fdset ); 
-            FD_SET( 0, &fdset );
-            timeout.tv_sec = 0; 
-            timeout.tv_usec = 0;
-            //  std::cout << "selecting.." << std::ends;
-            int ret = select(0+1 , &fdset , NULL , NULL , &timeout );
-            //  std::cout << "selected(" << ret << ")" << std::endl;
-            return ret;
+            stdin_key_input().setLatencyMonitor(monitor);
         #endif
         }
 
+        /**
+         * @return non 0 if a key is available. Without syscall while keys are queued (Unix).
+         */
+        static int kbhit() {
+        #ifdef WIN32
+            const int ret = _kbhit();
+            if (m_keyLatencyMonitor) {
+                const uint64_t now = InputLatencyMonitor::now();
+                m_keyLatencyMonitor->poll(now);
+                if (ret > 0 && !m_keyStamp) m_keyStamp = now;
+            }
+            return ret;
+        #else
+            KeyInput& input = stdin_key_input();
+            if (!input.available()) input.update();
+            return input.available() ? 1 : 0;
+        #endif
+        }
 
+        /**
+         * @return next key, or -1 if no key is available (never blocks on Unix).
+         */
         static int getch() {
         #ifdef WIN32
-            return _getch();
-        #else
-            int keys[5] = {-1, -1, -1, -1, -1};
-            int key = getchar();
-            switch(key) {
-                case -1:
-                case 0:
-                    return -1;
-                    
-                case ' ':
-                    return AQUA2_KEY_SPACE;
-                case 27:
-                    key = getchar();
-                    switch(key) {
-                        case -1:
-                            return AQUA2_KEY_ESCAPE;
-                        case 79:
-                            key = getchar();
-                            return key;
-                        case '[':
-                            for(int i = 0;i < 5;i++) {
-                                if(key == -1 || key == 27) break;
-                                keys[i] = key = getchar();
-                            }
-                            ungetc(key, stdin);
-                            
-                            switch(keys[0]) {
-                                case 65: return AQUA2_KEY_UP;
-                                case 66: return AQUA2_KEY_DOWN;
-                                case 67: return AQUA2_KEY_RIGHT;
-                                case 68: return AQUA2_KEY_LEFT;
-                                default: return keys[0];
-                            }
-                    }
+            const int key = _getch();
+            if (m_keyLatencyMonitor && key != -1) {
+                const uint64_t now = InputLatencyMonitor::now();
+                m_keyLatencyMonitor->consume(m_keyStamp ? m_keyStamp : now, now);
+                m_keyStamp = 0;
             }
             return key;
+        #else
+            KeyInput& input = stdin_key_input();
+            if (!input.available()) input.update();
+            return input.get();
         #endif
         }
 
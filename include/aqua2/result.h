@@ -0,0 +1,92 @@
+/********************************************************
+ * result.h
+ *
+ * Value or errno-like error code, returned by the
+ * non-throwing (try*) I/O functions.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <string.h>
+#include <errno.h>
+#include <utility>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief Error code (errno value) to construct a failed Result.
+     */
+    struct ErrorCode {
+      int code;
+      explicit ErrorCode(const int c) noexcept : code(c) {}
+    };
+
+    /***************************************************
+     * Result
+     *
+     * @brief Value of T, or an errno value telling why there is none.
+     *
+     * Returned by the try* functions of Socket, ServerSocket and SerialPort,
+     * which never throw: timeouts (ETIMEDOUT) and would-block (EAGAIN) are
+     * ordinary results on a hot path, not exceptions. T must be default
+     * constructible; value() of a failed Result is T().
+     *
+     * Usage:
+     *   Result<Socket> r = server.tryAccept(1000);
+     *   if (!r) {
+     *     if (r.error() == ETIMEDOUT) continue;
+     *     std::cerr << r.message() << std::endl;
+     *   }
+     *   Socket client = r.value();
+     ***************************************************/
+    template<typename T>
+    class Result {
+    private:
+      T value_;
+      int error_;
+
+    public:
+      Result(const T& value) : value_(value), error_(0) {}
+      Result(T&& value) noexcept : value_(std::move(value)), error_(0) {}
+      Result(const ErrorCode& e) noexcept : value_(), error_(e.code) {}
+
+      bool ok() const noexcept { return error_ == 0; }
+      explicit operator bool() const noexcept { return error_ == 0; }
+
+      /**
+       * @brief errno value. 0 if ok().
+       */
+      int error() const noexcept { return error_; }
+
+      const char* message() const noexcept { return strerror(error_); }
+
+      const T& value() const noexcept { return value_; }
+      T& value() noexcept { return value_; }
+
+      T valueOr(const T& alternative) const { return error_ == 0 ? value_ : alternative; }
+    };
+
+    /**
+     * @brief Success or errno value.
+     */
+    template<>
+    class Result<void> {
+    private:
+      int error_;
+
+    public:
+      Result() noexcept : error_(0) {}
+      Result(const ErrorCode& e) noexcept : error_(e.code) {}
+
+      bool ok() const noexcept { return error_ == 0; }
+      explicit operator bool() const noexcept { return error_ == 0; }
+      int error() const noexcept { return error_; }
+      const char* message() const noexcept { return strerror(error_); }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,94 @@
+/********************************************************
+ * seqlock.h
+ *
+ * Sequence lock for small trivially copyable values.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * SeqLock
+     *
+     * @brief One writer publishes T, any number of readers take torn-free copies.
+     *
+     * store() is wait-free and never blocks on readers. load() never
+     * blocks the writer and retries only when it overlaps a store().
+     * The value is kept in relaxed atomic words, so concurrent access
+     * is well defined. Nothing is allocated.
+     ***************************************************/
+    template<typename T>
+    class SeqLock {
+      static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires trivially copyable type");
+      const static size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    private:
+      alignas(64) std::atomic<uint64_t> sequence_;
+      std::atomic<uint64_t> words_[WORDS];
+
+    public:
+      SeqLock() : sequence_(0) {
+	for (size_t i = 0; i < WORDS; i++) words_[i].store(0, std::memory_order_relaxed);
+      }
+
+    private:
+      SeqLock(const SeqLock&);
+      SeqLock& operator=(const SeqLock&);
+
+    public:
+      /**
+       * @brief Publish value. Called from one writer thread.
+       */
+      void store(const T& value) {
+	uint64_t buf[WORDS];
+	buf[WORDS - 1] = 0;
+	memcpy(buf, &value, sizeof(T));
+	const uint64_t seq = sequence_.load(std::memory_order_relaxed);
+	sequence_.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t i = 0; i < WORDS; i++) words_[i].store(buf[i], std::memory_order_relaxed);
+	sequence_.store(seq + 2, std::memory_order_release);
+      }
+
+      /**
+       * @brief Copy of the last published value.
+       * @return version (number of store() calls) of the copy.
+       */
+      uint64_t load(T& value) const {
+	uint64_t buf[WORDS];
+	for (;;) {
+	  const uint64_t begin = sequence_.load(std::memory_order_acquire);
+	  if (begin & 1) continue; // writer is in store()
+	  for (size_t i = 0; i < WORDS; i++) buf[i] = words_[i].load(std::memory_order_relaxed);
+	  std::atomic_thread_fence(std::memory_order_acquire);
+	  if (sequence_.load(std::memory_order_relaxed) == begin) {
+	    memcpy(&value, buf, sizeof(T));
+	    return begin / 2;
+	  }
+	}
+      }
+
+      T load() const {
+	T value;
+	load(value);
+	return value;
+      }
+
+      /**
+       * @brief Number of store() calls. Cheap check for new value.
+       */
+      uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,453 @@
+/********************************************************
+ * serialbridge.h
+ *
+ * Serial to TCP bridge server (Unix only).
+ *
+ * SerialBridge forwards bytes between SerialPort and
+ * clients accepted by ServerSocket. On Linux, forwarding
+ * uses splice() through pipes to avoid user space copies.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "serialport.h"
+#include "serversocket.h"
+
+#ifndef WIN32
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief Snapshot of forwarding counters of one direction.
+     */
+    struct SerialBridgeCounters {
+      uint64_t bytes;         ///< forwarded bytes
+      uint64_t chunks;        ///< forwarded chunks
+      uint64_t dropped;       ///< discarded bytes (no client / slow client / written by observer)
+      uint64_t latencyTotal;  ///< sum of forwarding latency in nanoseconds
+      uint64_t latencyMax;    ///< maximum forwarding latency in nanoseconds
+      double elapsed;         ///< seconds since SerialBridge is constructed
+
+      double throughput() const { return elapsed > 0 ? bytes / elapsed : 0.0; }
+      double averageLatency() const { return chunks > 0 ? (double)latencyTotal / chunks : 0.0; }
+    };
+
+    class SerialBridgeCounter {
+    private:
+      std::atomic<uint64_t> bytes_;
+      std::atomic<uint64_t> chunks_;
+      std::atomic<uint64_t> dropped_;
+      std::atomic<uint64_t> latencyTotal_;
+      std::atomic<uint64_t> latencyMax_;
+
+    public:
+      SerialBridgeCounter() : bytes_(0), chunks_(0), dropped_(0), latencyTotal_(0), latencyMax_(0) {}
+
+      /// Called only from the thread running SerialBridge.
+      void add(const uint64_t bytes, const uint64_t latency) {
+	bytes_.fetch_add(bytes, std::memory_order_relaxed);
+	chunks_.fetch_add(1, std::memory_order_relaxed);
+	latencyTotal_.fetch_add(latency, std::memory_order_relaxed);
+	if (latency > latencyMax_.load(std::memory_order_relaxed)) latencyMax_.store(latency, std::memory_order_relaxed);
+      }
+
+      void drop(const uint64_t bytes) { dropped_.fetch_add(bytes, std::memory_order_relaxed); }
+
+      SerialBridgeCounters snapshot(const double elapsed) const {
+	SerialBridgeCounters c;
+	c.bytes = bytes_.load(std::memory_order_relaxed);
+	c.chunks = chunks_.load(std::memory_order_relaxed);
+	c.dropped = dropped_.load(std::memory_order_relaxed);
+	c.latencyTotal = latencyTotal_.load(std::memory_order_relaxed);
+	c.latencyMax = latencyMax_.load(std::memory_order_relaxed);
+	c.elapsed = elapsed;
+	return c;
+      }
+    };
+
+
+    /***************************************************
+     * SerialBridge
+     *
+     * @brief ser2net style bridge between SerialPort and TCP clients.
+     *
+     * Bytes received by SerialPort are sent to every client.
+     * The first client which sends data acquires the writer lock and
+     * only its data are written to SerialPort until it disconnects.
+     * Data from other (observer) clients are discarded.
+     *
+     * Client sockets are non-blocking. Bytes which a client can not take
+     * at once (its socket buffer is full) are dropped for that client and
+     * counted in SerialBridgeCounters::dropped, so one slow client never
+     * stalls the serial port or the other clients.
+     *
+     * When SerialPort has SerialTrafficObserver (eg., SerialRecorder),
+     * the bridge copies through SerialPort::read/write instead of splice
+     * so that the observer sees the traffic.
+     *
+     * SIGPIPE is blocked in the thread launched by start(). Block or
+     * ignore SIGPIPE when calling spinOnce() from your own thread.
+     *
+     * Usage:
+     *   ServerSocket server; server.bind(2000); server.listen();
+     *   SerialBridge bridge(port, server);
+     *   bridge.start();
+     ***************************************************/
+    class SerialBridge {
+    public:
+      const static size_t CHUNK_SIZE = 65536;
+
+    private:
+      SerialPort& port_;
+      ServerSocket& server_;
+      std::vector<Socket> clients_;
+      std::vector<struct pollfd> pollfds_;
+      std::vector<uint8_t> buffer_;
+      int writer_;          ///< file descriptor of client holding writer lock. -1 if free.
+      std::atomic<size_t> numClients_;
+#ifdef __linux__
+      int rxPipe_[2];       ///< serial -> network
+      int txPipe_[2];       ///< network -> serial
+      int teePipe_[2];      ///< duplicates rxPipe_ for multiple clients
+      bool spliceSerialIn_;
+      bool spliceSerialOut_;
+#endif
+      SerialBridgeCounter toNetwork_;
+      SerialBridgeCounter toSerial_;
+      std::chrono::steady_clock::time_point startTime_;
+      std::atomic<bool> running_;
+      std::thread* thread_;
+
+    public:
+      SerialBridge(SerialPort& port, ServerSocket& server) : port_(port), server_(server), buffer_(CHUNK_SIZE), writer_(-1), numClients_(0),
+	startTime_(std::chrono::steady_clock::now()), running_(false), thread_(nullptr) {
+#ifdef __linux__
+	rxPipe_[0] = rxPipe_[1] = txPipe_[0] = txPipe_[1] = teePipe_[0] = teePipe_[1] = -1;
+	if (pipe(rxPipe_) < 0 || pipe(txPipe_) < 0 || pipe(teePipe_) < 0) {
+	  closePipes();
+	  throw ComException("Pipe Error");
+	}
+	spliceSerialIn_ = spliceSerialOut_ = true;
+#endif
+      }
+
+      virtual ~SerialBridge() {
+	stop();
+	for (size_t i = 0; i < clients_.size(); i++) clients_[i].close();
+#ifdef __linux__
+	closePipes();
+#endif
+      }
+
+    private:
+      SerialBridge(const SerialBridge&);
+      SerialBridge& operator=(const SerialBridge&);
+
+    public:
+      /**
+       * @brief Launch forwarding thread.
+       */
+      void start() {
+	if (thread_) return;
+	running_ = true;
+	thread_ = new std::thread([this]() {
+	  sigset_t set;
+	  sigemptyset(&set);
+	  sigaddset(&set, SIGPIPE);
+	  pthread_sigmask(SIG_BLOCK, &set, NULL);
+	  while (running_) spinOnce(100);
+	});
+      }
+
+      void stop() {
+	if (!thread_) return;
+	running_ = false;
+	thread_->join();
+	delete thread_;
+	thread_ = nullptr;
+      }
+
+      size_t getNumClients() const { return numClients_; }
+
+      /**
+       * @brief File descriptor of the client holding writer lock. -1 if free.
+       */
+      int getWriter() const { return writer_; }
+
+      SerialBridgeCounters serialToNetwork() const { return toNetwork_.snapshot(elapsed()); }
+
+      SerialBridgeCounters networkToSerial() const { return toSerial_.snapshot(elapsed()); }
+
+      /**
+       * @brief Wait events once and forward.
+       * @param timeoutMsec timeout of poll(). -1 for infinite.
+       */
+      void spinOnce(const int timeoutMsec) {
+	pollfds_.resize(2 + clients_.size());
+	pollfds_[0].fd = port_.getFileDescriptor();
+	pollfds_[1].fd = server_.getFileDescriptor();
+	for (size_t i = 0; i < clients_.size(); i++) pollfds_[2 + i].fd = clients_[i].getFileDescriptor();
+	for (size_t i = 0; i < pollfds_.size(); i++) {
+	  pollfds_[i].events = POLLIN;
+	  pollfds_[i].revents = 0;
+	}
+	if (poll(&pollfds_[0], pollfds_.size(), timeoutMsec) <= 0) return;
+	const auto t = std::chrono::steady_clock::now();
+
+	if (pollfds_[0].revents & POLLIN) {
+	  forwardToNetwork(t);
+	}
+	for (size_t i = 0; i < clients_.size(); i++) {
+	  if (pollfds_[2 + i].revents & (POLLIN | POLLHUP | POLLERR)) {
+	    if (!forwardToSerial(clients_[i].getFileDescriptor(), t)) pollfds_[2 + i].fd = -1;
+	  }
+	}
+	removeClosedClients();
+	if (pollfds_[1].revents & POLLIN) {
+	  accept();
+	}
+      }
+
+    private:
+      double elapsed() const {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_).count();
+      }
+
+      static uint64_t nanosecondsSince(const std::chrono::steady_clock::time_point& t) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t).count();
+      }
+
+      void accept() {
+	try {
+	  Socket socket = server_.accept();
+	  int flag = 1;
+	  setsockopt(socket.getFileDescriptor(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+	  fcntl(socket.getFileDescriptor(), F_SETFL, fcntl(socket.getFileDescriptor(), F_GETFL) | O_NONBLOCK);
+	  clients_.push_back(socket);
+	  numClients_ = clients_.size();
+	} catch (SocketException& ex) {
+	}
+      }
+
+      void removeClosedClients() {
+	for (size_t i = clients_.size(); i > 0; i--) {
+	  if (pollfds_[1 + i].fd >= 0) continue;
+	  if (clients_[i - 1].getFileDescriptor() == writer_) writer_ = -1;
+	  clients_[i - 1].close();
+	  clients_.erase(clients_.begin() + (i - 1));
+	}
+	numClients_ = clients_.size();
+      }
+
+      /**
+       * @brief Send data to a client without waiting. Bytes the client can not take now are dropped.
+       * @return false if the client is closed.
+       */
+      bool sendChunk(const int fd, const uint8_t* data, const size_t size) {
+	size_t sent = 0;
+	while (sent < size) {
+#ifdef MSG_NOSIGNAL
+	  ssize_t ret = ::send(fd, data + sent, size - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+	  ssize_t ret = ::send(fd, data + sent, size - sent, MSG_DONTWAIT);
+#endif
+	  if (ret < 0 && errno == EINTR) continue;
+	  if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+	  if (ret <= 0) return false;
+	  sent += ret;
+	}
+	if (sent < size) toNetwork_.drop(size - sent);
+	return true;
+      }
+
+      void writeSerial(const uint8_t* data, const size_t size) {
+	size_t written = 0;
+	while (written < size) {
+	  try {
+	    written += port_.write(data + written, size - written);
+	  } catch (ComAccessException& ex) {
+	    if (errno != EAGAIN && errno != EINTR) return;
+	    struct pollfd pfd;
+	    pfd.fd = port_.getFileDescriptor();
+	    pfd.events = POLLOUT;
+	    poll(&pfd, 1, 100);
+	  }
+	}
+      }
+
+      /// marks client closed in pollfds_
+      void closeClient(const int fd) {
+	for (size_t i = 2; i < pollfds_.size(); i++) {
+	  if (pollfds_[i].fd == fd) pollfds_[i].fd = -1;
+	}
+      }
+
+      void forwardToNetwork(const std::chrono::steady_clock::time_point& t) {
+#ifdef __linux__
+	if (spliceSerialIn_ && !port_.getTrafficObserver()) {
+	  ssize_t size = splice(port_.getFileDescriptor(), NULL, rxPipe_[1], NULL, CHUNK_SIZE, SPLICE_F_NONBLOCK | SPLICE_F_MOVE);
+	  if (size < 0 && errno == EINVAL) {
+	    spliceSerialIn_ = false; // tty without splice_read. Fall back to copy.
+	  } else {
+	    if (size <= 0) return;
+	    if (clients_.empty()) {
+	      drainPipe(rxPipe_[0], size);
+	      toNetwork_.drop(size);
+	      return;
+	    }
+	    for (size_t i = 0; i < clients_.size(); i++) {
+	      const int fd = clients_[i].getFileDescriptor();
+	      if (i + 1 == clients_.size()) {
+		if (!splicePipe(rxPipe_[0], fd, size)) closeClient(fd);
+	      } else {
+		ssize_t teed = tee(rxPipe_[0], teePipe_[1], size, 0);
+		if (teed > 0 && !splicePipe(teePipe_[0], fd, teed)) closeClient(fd);
+		if (teed != size) toNetwork_.drop(size - (teed > 0 ? teed : 0));
+	      }
+	    }
+	    toNetwork_.add(size, nanosecondsSince(t));
+	    return;
+	  }
+	}
+#endif
+	int size;
+	try {
+	  size = port_.read(&buffer_[0], CHUNK_SIZE);
+	} catch (ComAccessException& ex) {
+	  return;
+	}
+	if (size <= 0) return;
+	if (clients_.empty()) {
+	  toNetwork_.drop(size);
+	  return;
+	}
+	for (size_t i = 0; i < clients_.size(); i++) {
+	  if (!sendChunk(clients_[i].getFileDescriptor(), &buffer_[0], size)) closeClient(clients_[i].getFileDescriptor());
+	}
+	toNetwork_.add(size, nanosecondsSince(t));
+      }
+
+      /**
+       * @return false if the client is closed.
+       */
+      bool forwardToSerial(const int fd, const std::chrono::steady_clock::time_point& t) {
+	if (writer_ >= 0 && writer_ != fd) {
+	  ssize_t size = ::recv(fd, &buffer_[0], CHUNK_SIZE, 0);
+	  if (size <= 0) return size < 0 && errno == EAGAIN;
+	  toSerial_.drop(size);
+	  return true;
+	}
+#ifdef __linux__
+	if (spliceSerialOut_ && !port_.getTrafficObserver()) {
+	  ssize_t size = splice(fd, NULL, txPipe_[1], NULL, CHUNK_SIZE, SPLICE_F_NONBLOCK | SPLICE_F_MOVE);
+	  if (size < 0 && errno == EAGAIN) return true;
+	  if (size <= 0) return false;
+	  writer_ = fd;
+	  size_t moved = 0;
+	  while (moved < (size_t)size) {
+	    ssize_t ret = splice(txPipe_[0], NULL, port_.getFileDescriptor(), NULL, size - moved, SPLICE_F_MOVE);
+	    if (ret > 0) {
+	      moved += ret;
+	    } else if (ret < 0 && (errno == EAGAIN || errno == EINTR)) {
+	      struct pollfd pfd;
+	      pfd.fd = port_.getFileDescriptor();
+	      pfd.events = POLLOUT;
+	      poll(&pfd, 1, 100);
+	    } else {
+	      // tty without splice_write. Copy the rest and fall back.
+	      spliceSerialOut_ = false;
+	      while (moved < (size_t)size) {
+		ssize_t r = ::read(txPipe_[0], &buffer_[0], size - moved);
+		if (r <= 0) break;
+		writeSerial(&buffer_[0], r);
+		moved += r;
+	      }
+	    }
+	  }
+	  toSerial_.add(size, nanosecondsSince(t));
+	  return true;
+	}
+#endif
+	ssize_t size = ::recv(fd, &buffer_[0], CHUNK_SIZE, 0);
+	if (size < 0 && errno == EAGAIN) return true;
+	if (size <= 0) return false;
+	writer_ = fd;
+	writeSerial(&buffer_[0], size);
+	toSerial_.add(size, nanosecondsSince(t));
+	return true;
+      }
+
+#ifdef __linux__
+      /**
+       * @brief Move size bytes from pipe to socket without waiting.
+       *
+       * The rest is drained when the socket is closed or full. Bytes drained
+       * from a full socket are counted as dropped.
+       * @return false if the client is closed.
+       */
+      bool splicePipe(const int pipeFd, const int fd, const size_t size) {
+	size_t moved = 0;
+	while (moved < size) {
+	  ssize_t ret = splice(pipeFd, NULL, fd, NULL, size - moved, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	  if (ret < 0 && errno == EINTR) continue;
+	  if (ret < 0 && errno == EAGAIN) {
+	    drainPipe(pipeFd, size - moved);
+	    toNetwork_.drop(size - moved);
+	    return true;
+	  }
+	  if (ret <= 0) {
+	    drainPipe(pipeFd, size - moved);
+	    if (ret < 0 && errno == EPIPE) clearSigPipe();
+	    return false;
+	  }
+	  moved += ret;
+	}
+	return true;
+      }
+
+      void drainPipe(const int pipeFd, size_t size) {
+	while (size > 0) {
+	  ssize_t ret = ::read(pipeFd, &buffer_[0], size < CHUNK_SIZE ? size : CHUNK_SIZE);
+	  if (ret <= 0) return;
+	  size -= ret;
+	}
+      }
+
+      /// Consume SIGPIPE pending on this thread (raised by splice to closed socket).
+      static void clearSigPipe() {
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGPIPE);
+	struct timespec zero = {0, 0};
+	sigtimedwait(&set, NULL, &zero);
+      }
+
+      void closePipes() {
+	int* fds[] = {rxPipe_, txPipe_, teePipe_};
+	for (int i = 0; i < 3; i++) {
+	  if (fds[i][0] >= 0) ::close(fds[i][0]);
+	  if (fds[i][1] >= 0) ::close(fds[i][1]);
+	}
+      }
+#endif
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifndef WIN32
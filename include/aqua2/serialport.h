@@ -25,6 +25,7 @@
 #include <termios.h>
 #include <errno.h>
 #include <signal.h>
+#include <linux/serial.h>
 #define _POSIX_SOURCE 1
 
 #else // OSX
@@ -48,6 +49,12 @@
 #endif
 
 #include <chrono>
+#include <mutex>
+
+#include "bytebuffer.h"
+#include "histogram.h"
+#include "waitstrategy.h"
+#include "result.h"
 
 namespace ssr {
   namespace aqua2 {
@@ -92,6 +99,90 @@ namespace ssr {
 
 
 
+    /**
+     * @brief Observer interface notified with every chunk transferred through SerialPort.
+     *
+     * Called from the thread which calls SerialPort::read / SerialPort::write,
+     * so implementations must be cheap. They must not throw either: the
+     * bytes are already transferred and the caller would lose them.
+     */
+    class SerialTrafficObserver {
+    public:
+      const static int RX = 0;
+      const static int TX = 1;
+
+    public:
+      virtual ~SerialTrafficObserver() {}
+
+      /**
+       * @param direction RX (received by SerialPort) or TX (transmitted by SerialPort)
+       * @param data transferred bytes
+       * @param size size of data in bytes
+       */
+      virtual void onTraffic(const int direction, const void* data, const size_t size) = 0;
+    };
+
+    /**
+     * @brief Snapshot of SerialPort statistics. See SerialPort::getStatistics().
+     */
+    struct SerialPortStatistics {
+      double timestamp;           ///< seconds of steady clock when sampled
+      double interval;            ///< seconds since the previous sample. 0 for the first sample.
+
+      /// Line counters of UART driver (TIOCGICOUNT, Linux only).
+      bool lineCountersAvailable;
+      uint64_t rx;
+      uint64_t tx;
+      uint64_t frameErrors;
+      uint64_t overruns;          ///< UART hardware overrun
+      uint64_t parityErrors;
+      uint64_t breaks;
+      uint64_t bufferOverruns;    ///< tty buffer overrun
+
+      /// User space counters. Valid if SerialPort::enableStatistics() is called.
+      uint64_t bytesRead;
+      uint64_t bytesWritten;
+      uint64_t readCalls;
+      uint64_t writeCalls;
+      uint64_t pollCalls;         ///< getSizeInRxBuffer() calls (select + ioctl)
+      uint64_t wouldBlock;        ///< read / write failed with EAGAIN
+      uint64_t errors;
+      double rxBytesPerSecond;    ///< since the previous sample
+      double txBytesPerSecond;
+      LatencyHistogramSnapshot readLatency;   ///< duration of read() system calls
+      LatencyHistogramSnapshot waitLatency;   ///< time until read(dst, size, timeout) / waitAvailable() are satisfied
+
+      uint64_t syscalls() const { return readCalls + writeCalls + pollCalls * 2; }
+    };
+
+    /**
+     * @brief User space counters of SerialPort. Updated without lock.
+     *
+     * Counters of one direction have one writer (the reader or the writer
+     * thread). wouldBlock and errors are shared by both and use fetch_add.
+     */
+    class SerialPortCounters {
+    public:
+      std::atomic<uint64_t> bytesRead;
+      std::atomic<uint64_t> bytesWritten;
+      std::atomic<uint64_t> readCalls;
+      std::atomic<uint64_t> writeCalls;
+      std::atomic<uint64_t> pollCalls;
+      std::atomic<uint64_t> wouldBlock;
+      std::atomic<uint64_t> errors;
+      LatencyHistogram readLatency;
+      LatencyHistogram waitLatency;
+
+      std::mutex mutex;
+      bool sampled;
+      SerialPortStatistics last;
+
+      SerialPortCounters() : bytesRead(0), bytesWritten(0), readCalls(0), writeCalls(0), pollCalls(0), wouldBlock(0), errors(0), sampled(false) {}
+
+      static uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+    };
     
 
     /***************************************************
@@ -118,7 +209,10 @@ namespace ssr {
       HANDLE m_hComm;
 #else
       int m_Fd;
+      WaitStrategy* waitStrategy_;
 #endif
+      SerialTrafficObserver* observer_;
+      SerialPortCounters* counters_;
       
     public:
 
@@ -128,18 +222,37 @@ namespace ssr {
        * @param filename Filename of Serial Port (eg., "COM0", "/dev/tty0")
        * @baudrate baudrate. (eg., 9600, 115200)
        */
-    SerialPort(const char* filename, int baudrate, int parity=NO_PARITY, int stopbits=ONE_STOPBIT) : filename_(filename), baudrate_(baudrate), parity_(parity), stopbits_(stopbits) {
+    SerialPort(const char* filename, int baudrate, int parity=NO_PARITY, int stopbits=ONE_STOPBIT) : filename_(filename), baudrate_(baudrate), parity_(parity), stopbits_(stopbits),
+#ifndef WIN32
+	waitStrategy_(nullptr),
+#endif
+	observer_(nullptr), counters_(nullptr) {
 	open();
 	setup();
       }
+
+#ifndef WIN32
+      /**
+       * @brief Constructor with already opened file descriptor (eg., master side of pseudo terminal)
+       *
+       * SerialPort takes the ownership of fd. up() after down() reopens filename.
+       * @param fd opened file descriptor
+       * @param filename Filename used by open()
+       */
+    SerialPort(const int fd, const char* filename, int baudrate, int parity=NO_PARITY, int stopbits=ONE_STOPBIT) : filename_(filename), baudrate_(baudrate), parity_(parity), stopbits_(stopbits), m_Fd(fd), waitStrategy_(nullptr), observer_(nullptr), counters_(nullptr) {
+	fcntl(m_Fd, F_SETFL, fcntl(m_Fd, F_GETFL) | O_NONBLOCK);
+	setup();
+      }
+#endif
       
     SerialPort(SerialPort&& port) : filename_(port.filename_), baudrate_(port.baudrate_), parity_(port.parity_), stopbits_(port.stopbits_),
 #ifdef WIN32
-	m_hComm(port.m_hComm)
+	m_hComm(port.m_hComm),
 #else
-	m_Fd(port.m_Fd)
+	m_Fd(port.m_Fd), waitStrategy_(port.waitStrategy_),
 #endif
-	  {}
+	observer_(port.observer_), counters_(port.counters_)
+	  { port.counters_ = nullptr; }
       
 
 
@@ -148,6 +261,7 @@ namespace ssr {
        */
       virtual ~SerialPort() {
 	close();
+	delete counters_;
       }
     public:
       bool available() const {
@@ -158,6 +272,101 @@ namespace ssr {
 #endif
       }
 
+      /**
+       * @brief Set observer which receives every RX/TX chunk (eg., SerialRecorder).
+       * @param observer observer. nullptr to detach.
+       */
+      void setTrafficObserver(SerialTrafficObserver* observer) { observer_ = observer; }
+
+      SerialTrafficObserver* getTrafficObserver() const { return observer_; }
+
+#ifndef WIN32
+      int getFileDescriptor() const { return m_Fd; }
+
+      /**
+       * @brief Strategy of waitAvailable(), readLine() and read(dst, size, timeout). Not owned.
+       *
+       * nullptr (default) keeps the busy loop calling getSizeInRxBuffer(),
+       * which holds a CPU until the bytes come.
+       */
+      void setWaitStrategy(WaitStrategy* strategy) { waitStrategy_ = strategy; }
+
+      WaitStrategy* getWaitStrategy() const { return waitStrategy_; }
+#endif
+
+      const std::string& getFilename() const { return filename_; }
+
+      /**
+       * @brief Start user space counters (bytes, system calls, read latency).
+       *
+       * Call before starting I/O threads. Without this, getStatistics()
+       * reports only line counters and read() / write() cost nothing extra.
+       */
+      void enableStatistics() {
+	if (!counters_) counters_ = new SerialPortCounters();
+      }
+
+      bool isStatisticsEnabled() const { return counters_ != nullptr; }
+
+      /**
+       * @brief Sample statistics.
+       *
+       * @param minInterval seconds. If the previous sample is newer than this, it is returned
+       *        without system calls, so that the statistics can be polled from many places.
+       */
+      SerialPortStatistics getStatistics(const double minInterval = 0.0) {
+	const uint64_t now = SerialPortCounters::now();
+	std::unique_lock<std::mutex> lock;
+	if (counters_) {
+	  lock = std::unique_lock<std::mutex>(counters_->mutex);
+	  if (counters_->sampled && now * 1e-9 - counters_->last.timestamp < minInterval) return counters_->last;
+	}
+
+	SerialPortStatistics s;
+	memset(&s, 0, sizeof(s));
+	s.timestamp = now * 1e-9;
+#if defined(__linux__) && defined(TIOCGICOUNT)
+	struct serial_icounter_struct ic;
+	if (available() && ioctl(m_Fd, TIOCGICOUNT, &ic) == 0) {
+	  s.lineCountersAvailable = true;
+	  s.rx = ic.rx;
+	  s.tx = ic.tx;
+	  s.frameErrors = ic.frame;
+	  s.overruns = ic.overrun;
+	  s.parityErrors = ic.parity;
+	  s.breaks = ic.brk;
+	  s.bufferOverruns = ic.buf_overrun;
+	}
+#endif
+	if (!counters_) return s;
+
+	s.bytesRead = counters_->bytesRead.load(std::memory_order_relaxed);
+	s.bytesWritten = counters_->bytesWritten.load(std::memory_order_relaxed);
+	s.readCalls = counters_->readCalls.load(std::memory_order_relaxed);
+	s.writeCalls = counters_->writeCalls.load(std::memory_order_relaxed);
+	s.pollCalls = counters_->pollCalls.load(std::memory_order_relaxed);
+	s.wouldBlock = counters_->wouldBlock.load(std::memory_order_relaxed);
+	s.errors = counters_->errors.load(std::memory_order_relaxed);
+	s.readLatency = counters_->readLatency.snapshot();
+	s.waitLatency = counters_->waitLatency.snapshot();
+	if (counters_->sampled) {
+	  s.interval = s.timestamp - counters_->last.timestamp;
+	  if (s.interval > 0) {
+	    s.rxBytesPerSecond = (s.bytesRead - counters_->last.bytesRead) / s.interval;
+	    s.txBytesPerSecond = (s.bytesWritten - counters_->last.bytesWritten) / s.interval;
+	  }
+	}
+	counters_->last = s;
+	counters_->sampled = true;
+	return s;
+      }
+
+      int getBaudrate() const { return baudrate_; }
+
+      int getParity() const { return parity_; }
+
+      int getStopBits() const { return stopbits_; }
+
 
       void open() {
 #ifdef WIN32
@@ -300,6 +509,7 @@ namespace ssr {
        * @return Stored Data Size of Rx Buffer;
        */
       int getSizeInRxBuffer() {
+	if (counters_) relaxedIncrement(counters_->pollCalls);
 #ifdef WIN32
 	COMSTAT         stat;
 	DWORD           lper;
@@ -343,14 +553,26 @@ namespace ssr {
 #ifdef WIN32
 	DWORD WrittenBytes;
 	if(!WriteFile(m_hComm, src, size, &WrittenBytes, NULL)) {
+	  if (counters_) countError();
 	  throw ComAccessException();
 	}
+	if (counters_) {
+	  relaxedIncrement(counters_->writeCalls);
+	  relaxedIncrement(counters_->bytesWritten, WrittenBytes);
+	}
+	if (observer_ && WrittenBytes > 0) observer_->onTraffic(SerialTrafficObserver::TX, src, WrittenBytes);
 	return WrittenBytes;
 #else
 	int ret;
 	if((ret = ::write(m_Fd, src, size)) < 0) {
+	  if (counters_) countError();
 	  throw ComAccessException();
 	}
+	if (counters_) {
+	  relaxedIncrement(counters_->writeCalls);
+	  relaxedIncrement(counters_->bytesWritten, ret);
+	}
+	if (observer_ && ret > 0) observer_->onTraffic(SerialTrafficObserver::TX, src, ret);
 	return ret;
 #endif
       }
@@ -361,29 +583,62 @@ namespace ssr {
       int read(void *dst, const unsigned int size) const {
 #ifdef WIN32
 	DWORD ReadBytes;
+	const uint64_t start = counters_ ? SerialPortCounters::now() : 0;
 	if(!ReadFile(m_hComm, dst, size, &ReadBytes, NULL)) {
+	  if (counters_) countError();
 	  throw ComAccessException();
 	}
+	if (counters_) {
+	  counters_->readLatency.add(SerialPortCounters::now() - start);
+	  relaxedIncrement(counters_->readCalls);
+	  relaxedIncrement(counters_->bytesRead, ReadBytes);
+	}
+	if (observer_ && ReadBytes > 0) observer_->onTraffic(SerialTrafficObserver::RX, dst, ReadBytes);
       
 	return ReadBytes;
 #else
 	int ret;
-	if((ret = ::read(m_Fd, dst, size))< 0) {
+	if (counters_) {
+	  const uint64_t start = SerialPortCounters::now();
+	  ret = ::read(m_Fd, dst, size);
+	  counters_->readLatency.add(SerialPortCounters::now() - start);
+	  relaxedIncrement(counters_->readCalls);
+	  if (ret > 0) relaxedIncrement(counters_->bytesRead, ret);
+	} else {
+	  ret = ::read(m_Fd, dst, size);
+	}
+	if(ret < 0) {
+	  if (counters_) countError();
 	  throw ComAccessException();
 	}
+	if (observer_ && ret > 0) observer_->onTraffic(SerialTrafficObserver::RX, dst, ret);
 	return ret;
 #endif
       }
 
+      /**
+       * @brief Wait until bytes are in Rx Buffer.
+       * @param timeout seconds. 0 or less waits for ever.
+       * @return 0 if available, -2 if timeout, -1 if error.
+       */
       int waitAvailable(const uint32_t bytes, const double timeout=0.0) {
+#ifndef WIN32
+	if (waitStrategy_) {
+	  auto start = std::chrono::system_clock::now();
+	  const int r = waitStrategy_->wait(m_Fd, bytes, timeout);
+	  if (r == WaitStrategy::READY && counters_) countWait(start);
+	  return r == WaitStrategy::READY ? 0 : (r == WaitStrategy::TIMEOUT ? -2 : -1);
+	}
+#endif
 	try {
 	  auto start = std::chrono::system_clock::now();
 	  while (true) {
 	    if (getSizeInRxBuffer() >= bytes) {
+	      if (counters_) countWait(start);
 	      return 0;
 	    }
 	    if (timeout > 0.0) {
-	      double duration = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now()-start).count();
+	      double duration = std::chrono::duration<double>(std::chrono::system_clock::now()-start).count();
 	      if (duration > timeout) return -2;
 	    }
 	  }
@@ -396,15 +651,21 @@ namespace ssr {
 	int endMarkLen = strlen(endMark);
 	int counter = 0;
 	while(true) {
+#ifndef WIN32
+	  if (waitStrategy_) {
+	    if (waitAvailable(1) < 0) return -1;
+	  } else
+#endif
 	  try {
 	    while (true) {
 	      if (getSizeInRxBuffer() >= 1) {
-		return 0;
+		break;
 	      }
 	    }
 	  } catch (ComAccessException& ex) {
 	    return -1;
 	  }
+	  if(counter >= (int)maxSize) return -1;
 	  if(read(dst+counter, 1) != 1) return -1;
 	  counter++;
 	  if(counter >= endMarkLen) {
@@ -434,55 +695,150 @@ namespace ssr {
     
 
       /**
-       *
+       * @brief read size bytes once they are in Rx Buffer.
+       * @param timeout seconds. 0 or less waits for ever, with or without WaitStrategy.
+       * @return size, or -1 if timeout or error.
        */
       int read(void *dst, const unsigned int size, const double timeout) {
-	auto start = std::chrono::system_clock::now();
-	while(true) {
-	  if(this->getSizeInRxBuffer() >= size) { 
-	    return read(dst, size);
-	  }
-	  double duration = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now()-start).count();
-	  if (duration > timeout) {
-	    return -1;
+	if (waitAvailable(size, timeout) != 0) return -1;
+	return read(dst, size);
+      }
+
+#ifndef WIN32
+      /// Non-throwing I/O. Results carry errno values instead of exceptions / -1.
+
+      /**
+       * @return bytes read (0 if nothing to read on a raw tty), or errno (EAGAIN if nothing to read on a pty master, EIO, ...).
+       */
+      Result<int> tryRead(void* dst, const unsigned int size) const noexcept {
+	const uint64_t start = counters_ ? SerialPortCounters::now() : 0;
+	const ssize_t ret = ::read(m_Fd, dst, size);
+	const int e = errno;
+	if (counters_) {
+	  counters_->readLatency.add(SerialPortCounters::now() - start);
+	  relaxedIncrement(counters_->readCalls);
+	  if (ret > 0) relaxedIncrement(counters_->bytesRead, ret);
+	  else if (ret < 0) countError();
+	}
+	if (ret < 0) return ErrorCode(e);
+	if (observer_ && ret > 0) notifyNoThrow(SerialTrafficObserver::RX, dst, ret);
+	return (int)ret;
+      }
+
+      /**
+       * @return bytes written, or errno.
+       */
+      Result<int> tryWrite(const void* src, const unsigned int size) const noexcept {
+	if (size == 0) return 0;
+	const ssize_t ret = ::write(m_Fd, src, size);
+	const int e = errno;
+	if (counters_) {
+	  if (ret < 0) {
+	    countError();
+	  } else {
+	    relaxedIncrement(counters_->writeCalls);
+	    relaxedIncrement(counters_->bytesWritten, ret);
 	  }
 	}
+	if (ret < 0) return ErrorCode(e);
+	if (observer_ && ret > 0) notifyNoThrow(SerialTrafficObserver::TX, src, ret);
+	return (int)ret;
+      }
+
+      /**
+       * @brief Wait until bytes are in Rx Buffer with WaitStrategy (sleep in poll() if none is set).
+       * @param timeout seconds. 0 or less waits for ever.
+       * @return ETIMEDOUT, or EIO if the port is hung up or in error.
+       */
+      Result<void> tryWaitAvailable(const uint32_t bytes, const double timeout) noexcept {
+	auto start = std::chrono::system_clock::now();
+	const int r = (waitStrategy_ ? *waitStrategy_ : defaultWaitStrategy()).wait(m_Fd, bytes, timeout);
+	if (r == WaitStrategy::TIMEOUT) return ErrorCode(ETIMEDOUT);
+	if (r != WaitStrategy::READY) return ErrorCode(EIO);
+	if (counters_) countWait(start);
+	return Result<void>();
+      }
+
+      /**
+       * @brief read size bytes once they are in Rx Buffer.
+       * @return size, or ETIMEDOUT, EIO, errno of read().
+       */
+      Result<int> tryRead(void* dst, const unsigned int size, const double timeout) noexcept {
+	const Result<void> r = tryWaitAvailable(size, timeout);
+	if (!r) return ErrorCode(r.error());
+	return tryRead(dst, size);
+      }
+#endif
+
+    private:
+#ifndef WIN32
+      /**
+       * @brief Observer call of the try* functions. A chunk the observer fails on
+       *        (eg., SerialRecorder on a full disk) is dropped, not thrown through noexcept.
+       */
+      void notifyNoThrow(const int direction, const void* data, const size_t size) const noexcept {
+	try {
+	  observer_->onTraffic(direction, data, size);
+	} catch (...) {
+	}
+      }
+#endif
+
+      void countError() const {
+#ifdef WIN32
+	counters_->errors.fetch_add(1, std::memory_order_relaxed);
+#else
+	if (errno == EAGAIN) counters_->wouldBlock.fetch_add(1, std::memory_order_relaxed);
+	else counters_->errors.fetch_add(1, std::memory_order_relaxed);
+#endif
+      }
+
+      void countWait(const std::chrono::system_clock::time_point& start) const {
+	counters_->waitLatency.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - start).count());
       }
     
     };
 
 
     //// Functional interfaces
-    class ByteBuffer : public std::vector<uint8_t> {
-    private:
-      bool _available;
-    public:
-      bool available() const { return _available; }
-    public:
-    ByteBuffer(const bool flag): _available(flag) {}
-    ByteBuffer(const size_t size): std::vector<uint8_t>(size), _available(true) {}
-    };
 
-    ByteBuffer read(const SerialPort& port, const size_t length) {
-      if (!port.available()) { return ByteBuffer(false); }
+    /**
+     * @brief read length bytes into buffer taken from ByteBufferPool.
+     * @return buffer. available() is false if failed.
+     */
+    inline ByteBuffer read(const SerialPort& port, const size_t length) {
+      if (!port.available() || length == 0) { return ByteBuffer(false); }
       ByteBuffer buffer(length);
       try {
-	if (port.read(&buffer.front(), length) != length) return ByteBuffer(false); 
+	if (port.read(buffer.data(), length) != (int)length) return ByteBuffer(false); 
       } catch (std::exception& ex) {
 	return ByteBuffer(false);
       }
       return buffer;
     }
 
+    /**
+     * @brief read buffer.size() bytes into caller-provided buffer.
+     * @return true if buffer is filled.
+     */
+    inline bool read(const SerialPort& port, ByteBuffer& buffer) {
+      if (!port.available() || buffer.empty()) return false;
+      try {
+	return port.read(buffer.data(), buffer.size()) == (int)buffer.size();
+      } catch (std::exception& ex) {
+	return false;
+      }
+    }
+
     SerialPort serialport(const char* filename, int baudrate, int parity=SerialPort::NO_PARITY, int stopbits=SerialPort::ONE_STOPBIT) {
       return SerialPort(filename, baudrate, parity, stopbits);
     }
 
-    const SerialPort& write(const SerialPort& port, const ByteBuffer& buffer) {
+    inline const SerialPort& write(const SerialPort& port, const ByteView& view) {
       if (!port.available()) return port;
-      if (!buffer.available()) return port;
+      if (view.empty()) return port;
       try {
-	if (port.write(&buffer.front(), buffer.size()) != buffer.size()) {
+	if (port.write(view.data(), view.size()) != (int)view.size()) {
 	  
 	}
       } catch (std::exception& ex) {
@@ -490,6 +846,11 @@ namespace ssr {
       return port;
     }
 
+    inline const SerialPort& write(const SerialPort& port, const ByteBuffer& buffer) {
+      if (!buffer.available()) return port;
+      return write(port, buffer.view());
+    }
+
     const SerialPort& flushTxBuffer(const SerialPort& port) {
       if (!port.available()) return port;
       try {
@@ -0,0 +1,374 @@
+/********************************************************
+ * serialrecorder.h
+ *
+ * Serial traffic recorder and replayer for SerialPort (Unix only).
+ *
+ * SerialRecorder appends every RX/TX chunk of SerialPort to
+ * a memory-mapped log file. SerialReplayer feeds the log
+ * back through a pseudo terminal, so that parsers can be
+ * tested offline with the recorded traffic.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <thread>
+
+#include "serialport.h"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <stdlib.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief This exception is thrown when Serial Log file is failed to open or grow.
+     */
+    class SerialLogException : public ComException {
+    public:
+    SerialLogException(const char* msg) : ComException(msg) {}
+      ~SerialLogException(void) throw() {}
+    };
+
+    /**
+     * Log file layout:
+     *   SerialLogHeader
+     *   (SerialLogRecord, data padded to 8 bytes alignment) * N
+     * A record with size == 0 terminates the log.
+     */
+    struct SerialLogHeader {
+      char magic[4];        ///< "AQ2S"
+      uint32_t version;
+      uint64_t startTime;   ///< CLOCK_MONOTONIC in nanoseconds at the beginning of recording
+    };
+
+    struct SerialLogRecord {
+      uint64_t timestamp;   ///< nanoseconds since SerialLogHeader::startTime
+      uint32_t size;        ///< size of data in bytes
+      uint16_t direction;   ///< SerialTrafficObserver::RX or SerialTrafficObserver::TX
+      uint16_t reserved;
+    };
+
+    inline uint64_t serialLogNow() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    inline size_t serialLogAlign(const size_t size) { return (size + 7) & ~(size_t)7; }
+
+
+    /***************************************************
+     * SerialRecorder
+     *
+     * @brief Records SerialPort traffic into memory-mapped log file.
+     *
+     * Usage:
+     *   SerialRecorder recorder("traffic.log");
+     *   port.setTrafficObserver(&recorder);
+     ***************************************************/
+    class SerialRecorder : public SerialTrafficObserver {
+    private:
+      int fd_;
+      uint8_t* map_;
+      size_t capacity_;
+      size_t offset_;
+      uint64_t startTime_;
+      bool full_;             ///< log could not grow. Chunks which do not fit are dropped.
+      uint64_t droppedBytes_;
+      std::mutex mutex_;
+
+    public:
+      /**
+       * @brief Constructor
+       *
+       * @param filename Filename of log. Truncated if exists.
+       * @param initialCapacity initial size of mapping. Doubled when exhausted.
+       */
+      SerialRecorder(const char* filename, const size_t initialCapacity = 1 << 20) : fd_(-1), map_(nullptr), capacity_(0), offset_(0), full_(false), droppedBytes_(0) {
+	if ((fd_ = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+	  throw SerialLogException("Serial Log Open Error");
+	}
+	try {
+	  map(serialLogAlign(initialCapacity < 4096 ? 4096 : initialCapacity));
+	} catch (SerialLogException& ex) {
+	  ::close(fd_);
+	  throw;
+	}
+
+	startTime_ = serialLogNow();
+	SerialLogHeader* header = (SerialLogHeader*)map_;
+	memcpy(header->magic, "AQ2S", 4);
+	header->version = 1;
+	header->startTime = startTime_;
+	offset_ = sizeof(SerialLogHeader);
+      }
+
+      /**
+       * @brief Destructor. Log file is truncated to the recorded size.
+       */
+      virtual ~SerialRecorder() {
+	close();
+      }
+
+    private:
+      /**
+       * @brief Grow the file and map it. On failure the old mapping is kept, so recording can go on.
+       * @throw SerialLogException
+       */
+      void map(const size_t capacity) {
+	if (ftruncate(fd_, capacity) < 0) {
+	  throw SerialLogException("Serial Log Grow Error");
+	}
+	void* ptr = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (ptr == MAP_FAILED) {
+	  throw SerialLogException("Serial Log Map Error");
+	}
+	if (map_) munmap(map_, capacity_);
+	map_ = (uint8_t*)ptr;
+	capacity_ = capacity;
+      }
+
+    public:
+      void close() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (fd_ < 0) return;
+	munmap(map_, capacity_);
+	map_ = nullptr;
+	if (ftruncate(fd_, offset_) < 0) {
+	  // keep the zero padded tail. Reader stops at the empty record.
+	}
+	::close(fd_);
+	fd_ = -1;
+      }
+
+      /**
+       * @brief Recorded size in bytes including header.
+       */
+      size_t size() const { return offset_; }
+
+      /**
+       * @brief Bytes of the chunks not recorded because the log could not grow (eg., disk full).
+       */
+      uint64_t getDroppedBytes() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return droppedBytes_;
+      }
+
+      /**
+       * @brief Append a chunk. Called by SerialPort::read / SerialPort::write.
+       *
+       * Never throws: the bytes are already transferred by the port. If
+       * the log can not grow, the chunk is dropped and counted, and the
+       * log is not grown any more.
+       */
+      virtual void onTraffic(const int direction, const void* data, const size_t size) {
+	const uint64_t timestamp = serialLogNow();
+	const size_t required = sizeof(SerialLogRecord) + serialLogAlign(size);
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (fd_ < 0) return;
+	if (offset_ + required + sizeof(SerialLogRecord) > capacity_) {
+	  size_t capacity = capacity_ * 2;
+	  while (offset_ + required + sizeof(SerialLogRecord) > capacity) capacity *= 2;
+	  if (!full_) {
+	    try {
+	      map(capacity);
+	    } catch (SerialLogException& ex) {
+	      full_ = true;
+	    }
+	  }
+	  if (full_) {
+	    droppedBytes_ += size;
+	    return;
+	  }
+	}
+	SerialLogRecord* record = (SerialLogRecord*)(map_ + offset_);
+	record->timestamp = timestamp - startTime_;
+	record->size = (uint32_t)size;
+	record->direction = (uint16_t)direction;
+	record->reserved = 0;
+	memcpy(map_ + offset_ + sizeof(SerialLogRecord), data, size);
+	offset_ += required;
+      }
+    };
+
+
+    /***************************************************
+     * SerialLogReader
+     *
+     * @brief Iterates records of log file written by SerialRecorder.
+     ***************************************************/
+    class SerialLogReader {
+    public:
+      struct Entry {
+	uint64_t timestamp;  ///< nanoseconds since the beginning of recording
+	int direction;
+	const uint8_t* data;
+	size_t size;
+      };
+
+    private:
+      int fd_;
+      const uint8_t* map_;
+      size_t length_;
+      size_t offset_;
+
+    public:
+      SerialLogReader(const char* filename) : fd_(-1), map_(nullptr), length_(0), offset_(sizeof(SerialLogHeader)) {
+	if ((fd_ = ::open(filename, O_RDONLY)) < 0) {
+	  throw SerialLogException("Serial Log Open Error");
+	}
+	struct stat st;
+	if (fstat(fd_, &st) < 0 || (size_t)st.st_size < sizeof(SerialLogHeader)) {
+	  ::close(fd_);
+	  throw SerialLogException("Serial Log Format Error");
+	}
+	length_ = st.st_size;
+	void* ptr = mmap(NULL, length_, PROT_READ, MAP_SHARED, fd_, 0);
+	if (ptr == MAP_FAILED) {
+	  ::close(fd_);
+	  throw SerialLogException("Serial Log Map Error");
+	}
+	map_ = (const uint8_t*)ptr;
+	if (memcmp(map_, "AQ2S", 4) != 0) {
+	  munmap((void*)map_, length_);
+	  ::close(fd_);
+	  throw SerialLogException("Serial Log Format Error");
+	}
+      }
+
+      ~SerialLogReader() {
+	munmap((void*)map_, length_);
+	::close(fd_);
+      }
+
+    public:
+      const SerialLogHeader& header() const { return *(const SerialLogHeader*)map_; }
+
+      void rewind() { offset_ = sizeof(SerialLogHeader); }
+
+      /**
+       * @brief Get next record.
+       * @return false if the end of log.
+       */
+      bool next(Entry& entry) {
+	if (offset_ + sizeof(SerialLogRecord) > length_) return false;
+	const SerialLogRecord* record = (const SerialLogRecord*)(map_ + offset_);
+	if (record->size == 0 || offset_ + sizeof(SerialLogRecord) + record->size > length_) return false;
+	entry.timestamp = record->timestamp;
+	entry.direction = record->direction;
+	entry.data = map_ + offset_ + sizeof(SerialLogRecord);
+	entry.size = record->size;
+	offset_ += sizeof(SerialLogRecord) + serialLogAlign(record->size);
+	return true;
+      }
+    };
+
+
+    /***************************************************
+     * SerialReplayer
+     *
+     * @brief Feeds RX traffic of recorded log through pseudo terminal.
+     *
+     * Usage:
+     *   SerialReplayer replayer("traffic.log");
+     *   SerialPort port(replayer.deviceName(), 115200);
+     *   std::thread t([&]() { replayer.play(); });
+     ***************************************************/
+    class SerialReplayer {
+    private:
+      SerialLogReader reader_;
+      int master_;
+      int slave_;
+      std::string deviceName_;
+
+    public:
+      SerialReplayer(const char* filename) : reader_(filename), master_(-1), slave_(-1) {
+	if ((master_ = posix_openpt(O_RDWR | O_NOCTTY)) < 0) {
+	  throw ComOpenException();
+	}
+	if (grantpt(master_) < 0 || unlockpt(master_) < 0 || ptsname(master_) == NULL) {
+	  ::close(master_);
+	  throw ComOpenException();
+	}
+	deviceName_ = ptsname(master_);
+	/// Keep slave opened in raw mode so that the data is not echoed back
+	/// and the pty is not hung up when SerialPort closes it.
+	if ((slave_ = ::open(deviceName_.c_str(), O_RDWR | O_NOCTTY)) < 0) {
+	  ::close(master_);
+	  throw ComOpenException();
+	}
+	struct termios tio;
+	tcgetattr(slave_, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave_, TCSANOW, &tio);
+      }
+
+      ~SerialReplayer() {
+	::close(slave_);
+	::close(master_);
+      }
+
+    public:
+      /**
+       * @brief Filename of pseudo terminal to be opened by SerialPort.
+       */
+      const char* deviceName() const { return deviceName_.c_str(); }
+
+      /**
+       * @brief Replay RX records. TX records written by SerialPort are drained and discarded.
+       *
+       * @param speed time scale. 1.0 for original speed, 2.0 for double speed, 0.0 for maximum speed.
+       * @return number of replayed bytes. -1 if failed.
+       */
+      int64_t play(const double speed = 1.0) {
+	reader_.rewind();
+	const auto start = std::chrono::steady_clock::now();
+	SerialLogReader::Entry entry;
+	int64_t total = 0;
+	while (reader_.next(entry)) {
+	  drain();
+	  if (entry.direction != SerialTrafficObserver::RX) continue;
+	  if (speed > 0.0) {
+	    std::this_thread::sleep_until(start + std::chrono::nanoseconds((int64_t)(entry.timestamp / speed)));
+	  }
+	  size_t written = 0;
+	  while (written < entry.size) {
+	    ssize_t ret = ::write(master_, entry.data + written, entry.size - written);
+	    if (ret < 0) {
+	      if (errno == EINTR || errno == EAGAIN) continue;
+	      return -1;
+	    }
+	    written += ret;
+	  }
+	  total += written;
+	}
+	return total;
+      }
+
+    private:
+      void drain() {
+	uint8_t buf[256];
+	struct pollfd pfd;
+	pfd.fd = master_;
+	pfd.events = POLLIN;
+	while (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) {
+	  if (::read(master_, buf, sizeof(buf)) <= 0) return;
+	}
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifndef WIN32
@@ -0,0 +1,292 @@
+/********************************************************
+ * serialsupervisor.h
+ *
+ * Hot-plug aware supervisor of SerialPort (Unix only).
+ *
+ * SerialPortSupervisor watches the device path of SerialPort
+ * (inotify on Linux) and reopens and reconfigures the port as
+ * soon as the device reappears, eg., after USB-serial adapters
+ * re-enumerate.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "serialport.h"
+
+#ifndef WIN32
+#include <poll.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * SerialPortSupervisor
+     *
+     * @brief Closes SerialPort when the device disappears or hangs up,
+     *        and reopens it when the device path reappears.
+     *
+     * Reconnect attempts are triggered by file system events and
+     * retried with capped exponential backoff (eg., while udev is
+     * still setting permissions). Listeners are called from the thread
+     * running spinOnce(). The port is closed and reopened from that
+     * thread, so call spinOnce() from the I/O thread, or stop I/O in
+     * the DISCONNECTED listener when using start().
+     *
+     * Usage:
+     *   SerialPort port("/dev/serial/by-id/usb-FTDI_...", 115200);
+     *   SerialPortSupervisor supervisor(port);
+     *   supervisor.addListener([](SerialPort& p, int event) { ... });
+     *   supervisor.start();
+     ***************************************************/
+    class SerialPortSupervisor {
+    public:
+      const static int CONNECTED = 0;
+      const static int DISCONNECTED = 1;
+
+    private:
+      SerialPort& port_;
+      std::vector<std::function<void(SerialPort&, const int)> > listeners_;
+      int inotify_;
+      std::vector<int> watches_;
+      double backoffMin_;
+      double backoffMax_;
+      int attempts_;
+      std::chrono::steady_clock::time_point nextRetry_;
+      std::chrono::steady_clock::time_point disconnected_;
+      std::chrono::steady_clock::time_point appeared_;
+      bool appearedValid_;
+      std::atomic<uint64_t> reconnects_;
+      std::atomic<double> lastReconnectTime_;
+      std::atomic<double> lastDowntime_;
+      std::atomic<bool> running_;
+      std::thread* thread_;
+
+    public:
+      /**
+       * @param port supervised port. The device path is port.getFilename().
+       * @param backoffMin first retry interval in seconds
+       * @param backoffMax maximum retry interval in seconds
+       */
+      SerialPortSupervisor(SerialPort& port, const double backoffMin = 0.005, const double backoffMax = 1.0) : port_(port), inotify_(-1),
+	backoffMin_(backoffMin), backoffMax_(backoffMax), attempts_(0), appearedValid_(false),
+	reconnects_(0), lastReconnectTime_(0), lastDowntime_(0), running_(false), thread_(nullptr) {
+#ifdef __linux__
+	inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	updateWatches();
+#endif
+	nextRetry_ = disconnected_ = std::chrono::steady_clock::now();
+      }
+
+      virtual ~SerialPortSupervisor() {
+	stop();
+	if (inotify_ >= 0) ::close(inotify_);
+      }
+
+    private:
+      SerialPortSupervisor(const SerialPortSupervisor&);
+      SerialPortSupervisor& operator=(const SerialPortSupervisor&);
+
+    public:
+      /**
+       * @brief Add listener called with CONNECTED or DISCONNECTED.
+       */
+      void addListener(const std::function<void(SerialPort&, const int)>& listener) { listeners_.push_back(listener); }
+
+      void start() {
+	if (thread_) return;
+	running_ = true;
+	thread_ = new std::thread([this]() {
+	  while (running_) spinOnce(100);
+	});
+      }
+
+      void stop() {
+	if (!thread_) return;
+	running_ = false;
+	thread_->join();
+	delete thread_;
+	thread_ = nullptr;
+      }
+
+      uint64_t getReconnectCount() const { return reconnects_; }
+
+      /**
+       * @brief Seconds from detecting the device to reopening it at the last reconnection.
+       */
+      double getLastReconnectTime() const { return lastReconnectTime_; }
+
+      /**
+       * @brief Seconds the port was closed before the last reconnection.
+       */
+      double getLastDowntime() const { return lastDowntime_; }
+
+      /**
+       * @brief Report I/O failure (eg., ComAccessException) to reconnect without waiting for hangup.
+       */
+      void notifyError() {
+	if (port_.available()) disconnect();
+      }
+
+      /**
+       * @brief Wait file system events / hangup once and reconnect if needed.
+       * @param timeoutMsec maximum time to wait.
+       */
+      void spinOnce(const int timeoutMsec) {
+	struct pollfd pfds[2];
+	int n = 0;
+	if (inotify_ >= 0) {
+	  pfds[n].fd = inotify_;
+	  pfds[n].events = POLLIN;
+	  pfds[n].revents = 0;
+	  n++;
+	}
+	const int portIndex = n;
+	if (port_.available()) {
+	  pfds[n].fd = port_.getFileDescriptor();
+	  pfds[n].events = 0; // POLLHUP and POLLERR only
+	  pfds[n].revents = 0;
+	  n++;
+	}
+
+	int timeout = timeoutMsec;
+	if (!port_.available()) {
+	  const auto now = std::chrono::steady_clock::now();
+	  const int retry = now >= nextRetry_ ? 0 :
+	    (int)std::chrono::duration_cast<std::chrono::milliseconds>(nextRetry_ - now).count() + 1;
+	  if (inotify_ < 0 || retry < timeout) timeout = retry < timeoutMsec ? retry : timeoutMsec;
+	}
+	if (poll(pfds, n, timeout) < 0) return;
+
+	if (inotify_ >= 0 && (pfds[0].revents & POLLIN)) {
+	  drainEvents();
+	  updateWatches();
+	  if (!appearedValid_ && exists()) {
+	    appeared_ = std::chrono::steady_clock::now();
+	    appearedValid_ = true;
+	    attempts_ = 0;
+	    nextRetry_ = appeared_;
+	  }
+	}
+
+	if (port_.available()) {
+	  if ((portIndex < n && (pfds[portIndex].revents & (POLLHUP | POLLERR | POLLNVAL))) || !exists()) {
+	    disconnect();
+	  }
+	}
+	if (!port_.available() && std::chrono::steady_clock::now() >= nextRetry_) {
+	  reconnect();
+	}
+      }
+
+    private:
+      bool exists() const {
+	struct stat st;
+	return stat(port_.getFilename().c_str(), &st) == 0;
+      }
+
+      void notify(const int event) {
+	for (size_t i = 0; i < listeners_.size(); i++) listeners_[i](port_, event);
+      }
+
+      void disconnect() {
+	port_.close();
+	disconnected_ = std::chrono::steady_clock::now();
+	appearedValid_ = false;
+	attempts_ = 0;
+	nextRetry_ = disconnected_;
+	notify(DISCONNECTED);
+      }
+
+      void reconnect() {
+	const auto start = std::chrono::steady_clock::now();
+	if (exists()) {
+	  if (!appearedValid_) {
+	    appeared_ = start;
+	    appearedValid_ = true;
+	  }
+	  try {
+	    port_.close();
+	    port_.open();
+	    port_.setup();
+	    const auto now = std::chrono::steady_clock::now();
+	    lastReconnectTime_ = std::chrono::duration<double>(now - appeared_).count();
+	    lastDowntime_ = std::chrono::duration<double>(now - disconnected_).count();
+	    reconnects_++;
+	    attempts_ = 0;
+	    appearedValid_ = false;
+#ifdef __linux__
+	    updateWatches();
+#endif
+	    notify(CONNECTED);
+	    return;
+	  } catch (ComException& ex) {
+	  }
+	}
+	double backoff = backoffMin_;
+	for (int i = 0; i < attempts_ && backoff < backoffMax_; i++) backoff *= 2;
+	if (backoff > backoffMax_) backoff = backoffMax_;
+	attempts_++;
+	nextRetry_ = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(backoff));
+      }
+
+#ifdef __linux__
+      static std::string dirname(const std::string& path) {
+	const size_t pos = path.find_last_of('/');
+	if (pos == std::string::npos) return ".";
+	if (pos == 0) return "/";
+	return path.substr(0, pos);
+      }
+
+      void addWatch(std::string dir) {
+	struct stat st;
+	while (stat(dir.c_str(), &st) != 0 && dir != "/" && dir != ".") dir = dirname(dir);
+	const int wd = inotify_add_watch(inotify_, dir.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_ATTRIB);
+	if (wd >= 0) watches_.push_back(wd);
+      }
+
+      /**
+       * @brief Watch the directory of the device path (or its nearest existing ancestor,
+       *        eg., /dev/serial when /dev/serial/by-id is removed) and the directory
+       *        of the symlink target.
+       */
+      void updateWatches() {
+	if (inotify_ < 0) return;
+	for (size_t i = 0; i < watches_.size(); i++) inotify_rm_watch(inotify_, watches_[i]);
+	watches_.clear();
+	addWatch(dirname(port_.getFilename()));
+	char target[PATH_MAX];
+	if (realpath(port_.getFilename().c_str(), target)) {
+	  if (dirname(target) != dirname(port_.getFilename())) addWatch(dirname(target));
+	}
+      }
+
+      void drainEvents() {
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	while (::read(inotify_, buf, sizeof(buf)) > 0) {}
+      }
+#else
+      void updateWatches() {}
+      void drainEvents() {}
+#endif
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifndef WIN32
@@ -0,0 +1,650 @@
+/********************************************************
+ * serialtransaction.h
+ *
+ * Request / response transaction scheduler for
+ * multi-drop serial buses (Modbus-RTU, Dynamixel 2.0).
+ *
+ * The scheduler queues requests for many slave IDs, keeps
+ * inter-frame gaps and response deadlines computed from
+ * the baudrate, merges compatible reads into a single
+ * broadcast frame (eg., Dynamixel Sync Read) and reports
+ * per-device latency.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <thread>
+
+#include "serialport.h"
+
+#ifndef WIN32
+#include <poll.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief This exception is thrown when a request can not be framed or queued.
+     */
+    class SerialTransactionException : public std::exception {
+    private:
+      std::string msg_;
+    public:
+      SerialTransactionException(const std::string& msg) : msg_(msg) {}
+      ~SerialTransactionException(void) throw() {}
+      const char* what() const throw() { return msg_.c_str(); }
+    };
+
+    /**
+     * @brief Character timing of serial line.
+     */
+    class SerialTiming {
+    private:
+      double characterTime_;
+
+    public:
+      SerialTiming(const int baudrate, const int parity=SerialPort::NO_PARITY, const int stopbits=SerialPort::ONE_STOPBIT) {
+	double bits = 1 + 8;
+	if (parity != SerialPort::NO_PARITY) bits += 1;
+	if (stopbits == SerialPort::TWO_STOPBITS) bits += 2;
+	else if (stopbits == SerialPort::ONE5_STOPBITS) bits += 1.5;
+	else bits += 1;
+	characterTime_ = bits / baudrate;
+      }
+
+      SerialTiming(const SerialPort& port) : SerialTiming(port.getBaudrate(), port.getParity(), port.getStopBits()) {}
+
+    public:
+      /**
+       * @brief Time to transmit one character in seconds.
+       */
+      double characterTime() const { return characterTime_; }
+
+      /**
+       * @brief Time to transmit n characters in seconds.
+       */
+      double characters(const double n) const { return characterTime_ * n; }
+    };
+
+
+    /**
+     * @brief Framing rules of bus protocol used by SerialTransactionScheduler.
+     */
+    class SerialProtocol {
+    public:
+      virtual ~SerialProtocol() {}
+
+      /**
+       * @brief Length of the complete frame at the head of data.
+       * @return frame length, 0 if more bytes are needed, -1 if the first byte can not start a valid frame.
+       */
+      virtual int frameLength(const ByteView& data) const = 0;
+
+      /**
+       * @brief Size of the shortest valid frame. Shorter requests are refused by enqueue().
+       */
+      virtual size_t minFrameSize() const { return 1; }
+
+      /**
+       * @brief Slave ID of frame.
+       */
+      virtual int frameId(const ByteView& frame) const = 0;
+
+      /**
+       * @brief Slave ID addressed by request.
+       */
+      virtual int requestId(const ByteView& request) const { return frameId(request); }
+
+      /**
+       * @brief Expected length of response to request. 0 if unknown.
+       */
+      virtual size_t responseLength(const ByteView& /*request*/) const { return 0; }
+
+      /**
+       * @brief false for broadcast requests without response.
+       */
+      virtual bool expectsResponse(const ByteView& /*request*/) const { return true; }
+
+      /**
+       * @brief Silent interval required between frames in seconds.
+       */
+      virtual double interFrameGap(const SerialTiming& timing) const { return timing.characters(3.5); }
+
+      /**
+       * @brief true if request can be merged with first into one broadcast frame.
+       */
+      virtual bool canMerge(const ByteView& /*first*/, const ByteView& /*request*/) const { return false; }
+
+      /**
+       * @brief Build one frame which makes every device respond to requests in order.
+       */
+      virtual void buildMerged(const std::vector<ByteView>& /*requests*/, ByteBuffer& /*frame*/) const {}
+    };
+
+
+    /**
+     * @brief Queued request and its response.
+     */
+    struct SerialTransaction {
+      const static int PENDING = 0;
+      const static int DONE = 1;
+      const static int TIMEOUT = 2;
+
+      int id;
+      int status;
+      ByteBuffer request;
+      ByteBuffer response;
+      std::function<void(const SerialTransaction&)> callback;
+      std::chrono::steady_clock::time_point enqueued;
+      std::chrono::steady_clock::time_point sent;
+      std::chrono::steady_clock::time_point completed;
+
+      SerialTransaction(const int id_, const ByteView& request_, const std::function<void(const SerialTransaction&)>& callback_) :
+	id(id_), status(PENDING), request(request_.data(), request_.size()), response(false), callback(callback_),
+	enqueued(std::chrono::steady_clock::now()) {}
+
+      /**
+       * @brief Seconds from sending request to receiving response.
+       */
+      double latency() const { return std::chrono::duration<double>(completed - sent).count(); }
+    };
+
+
+    /**
+     * @brief Per-device statistics.
+     */
+    struct SerialDeviceStatistics {
+      uint64_t transactions;
+      uint64_t timeouts;
+      double latencyTotal;  ///< seconds
+      double latencyMin;
+      double latencyMax;
+
+      SerialDeviceStatistics() : transactions(0), timeouts(0), latencyTotal(0), latencyMin(0), latencyMax(0) {}
+
+      double averageLatency() const { return transactions > timeouts ? latencyTotal / (transactions - timeouts) : 0.0; }
+    };
+
+
+    /***************************************************
+     * SerialTransactionScheduler
+     *
+     * @brief Pipelined request/response engine on SerialPort.
+     *
+     * Usage:
+     *   DynamixelProtocol2 protocol;
+     *   SerialTransactionScheduler scheduler(port, protocol);
+     *   scheduler.setMaxBatch(8);
+     *   for (int id = 1; id <= 8; id++)
+     *     scheduler.enqueue(DynamixelProtocol2::read(id, 132, 4), onPosition);
+     *   scheduler.run();
+     ***************************************************/
+    class SerialTransactionScheduler {
+    private:
+      SerialPort& port_;
+      const SerialProtocol& protocol_;
+      SerialTiming timing_;
+      std::deque<SerialTransaction> queue_;
+      std::vector<SerialTransaction> window_;
+      std::vector<ByteView> merging_;
+      ByteBuffer frame_;
+      ByteBuffer rxBuffer_;
+      size_t rxSize_;
+      std::map<int, SerialDeviceStatistics> statistics_;
+      double responseTimeout_;
+      size_t maxBatch_;
+      size_t pipelineDepth_;
+      uint64_t frames_;
+      std::chrono::steady_clock::time_point busIdle_;
+
+    public:
+      SerialTransactionScheduler(SerialPort& port, const SerialProtocol& protocol) : port_(port), protocol_(protocol), timing_(port),
+	frame_((size_t)256), rxBuffer_((size_t)4096), rxSize_(0), responseTimeout_(0.01), maxBatch_(1), pipelineDepth_(1), frames_(0),
+	busIdle_(std::chrono::steady_clock::now()) {
+	window_.reserve(64);
+      }
+
+    public:
+      /**
+       * @brief Time allowed for a device to start responding, in seconds. Default 10 ms.
+       */
+      void setResponseTimeout(const double seconds) { responseTimeout_ = seconds; }
+
+      /**
+       * @brief Maximum number of requests merged into one broadcast frame. 1 disables merging.
+       */
+      void setMaxBatch(const size_t n) { maxBatch_ = n < 1 ? 1 : n; }
+
+      /**
+       * @brief Number of requests sent back to back before waiting responses.
+       *
+       * Use larger than 1 only when devices can not collide on the bus
+       * (eg., full duplex links or daisy chains which queue responses).
+       */
+      void setPipelineDepth(const size_t n) { pipelineDepth_ = n < 1 ? 1 : n; }
+
+      const SerialTiming& timing() const { return timing_; }
+
+      size_t getQueueSize() const { return queue_.size(); }
+
+      /**
+       * @brief Number of frames written to SerialPort.
+       */
+      uint64_t getNumFrames() const { return frames_; }
+
+      const std::map<int, SerialDeviceStatistics>& statistics() const { return statistics_; }
+
+      /**
+       * @brief Queue request. callback is called from run() / runOnce().
+       * @throw SerialTransactionException if request is shorter than SerialProtocol::minFrameSize().
+       */
+      void enqueue(const ByteView& request, const std::function<void(const SerialTransaction&)>& callback = nullptr) {
+	if (request.size() < protocol_.minFrameSize()) throw SerialTransactionException("Request shorter than a frame of the protocol");
+	queue_.push_back(SerialTransaction(protocol_.requestId(request), request, callback));
+      }
+
+      /**
+       * @brief Process queued transactions until the queue is empty.
+       * @return number of completed (not timed out) transactions.
+       */
+      size_t run() {
+	size_t count = 0;
+	while (!queue_.empty()) count += runOnce();
+	return count;
+      }
+
+      /**
+       * @brief Send one window of requests and wait for the responses.
+       * @return number of completed (not timed out) transactions.
+       */
+      size_t runOnce() {
+	if (queue_.empty()) return 0;
+	window_.clear();
+	window_.push_back(std::move(queue_.front()));
+	queue_.pop_front();
+
+	while (window_.size() < maxBatch_ && !queue_.empty() && !contains(queue_.front().id) &&
+	       protocol_.canMerge(window_[0].request.view(), queue_.front().request.view())) {
+	  window_.push_back(std::move(queue_.front()));
+	  queue_.pop_front();
+	}
+
+	if (window_.size() > 1) {
+	  merging_.clear();
+	  for (size_t i = 0; i < window_.size(); i++) merging_.push_back(window_[i].request.view());
+	  protocol_.buildMerged(merging_, frame_);
+	  const auto sent = send(frame_.view());
+	  for (size_t i = 0; i < window_.size(); i++) window_[i].sent = sent;
+	} else {
+	  if (protocol_.expectsResponse(window_[0].request.view())) {
+	    while (window_.size() < pipelineDepth_ && !queue_.empty() && !contains(queue_.front().id) &&
+		   protocol_.expectsResponse(queue_.front().request.view())) {
+	      window_.push_back(std::move(queue_.front()));
+	      queue_.pop_front();
+	    }
+	  }
+	  for (size_t i = 0; i < window_.size(); i++) {
+	    window_[i].sent = send(window_[i].request.view());
+	    if (!protocol_.expectsResponse(window_[i].request.view())) {
+	      window_[i].status = SerialTransaction::DONE;
+	      window_[i].completed = busIdle_;
+	    }
+	  }
+	}
+
+	receive();
+
+	size_t count = 0;
+	for (size_t i = 0; i < window_.size(); i++) {
+	  SerialTransaction& t = window_[i];
+	  if (t.status == SerialTransaction::PENDING) t.status = SerialTransaction::TIMEOUT;
+	  SerialDeviceStatistics& s = statistics_[t.id];
+	  s.transactions++;
+	  if (t.status == SerialTransaction::TIMEOUT) {
+	    s.timeouts++;
+	  } else {
+	    const double latency = t.latency();
+	    if (s.transactions - s.timeouts == 1 || latency < s.latencyMin) s.latencyMin = latency;
+	    if (latency > s.latencyMax) s.latencyMax = latency;
+	    s.latencyTotal += latency;
+	    count++;
+	  }
+	  if (t.callback) t.callback(t);
+	}
+	return count;
+      }
+
+    private:
+      bool contains(const int id) const {
+	for (size_t i = 0; i < window_.size(); i++) {
+	  if (window_[i].id == id) return true;
+	}
+	return false;
+      }
+
+      std::chrono::steady_clock::duration seconds(const double s) const {
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(s));
+      }
+
+      /**
+       * @brief Write frame after inter-frame gap. busIdle_ is updated to the end of transmission.
+       * @return time when writing started.
+       */
+      std::chrono::steady_clock::time_point send(const ByteView& frame) {
+	const auto start = busIdle_ + seconds(protocol_.interFrameGap(timing_));
+	if (start - std::chrono::steady_clock::now() > std::chrono::microseconds(200)) {
+	  std::this_thread::sleep_until(start - std::chrono::microseconds(100));
+	}
+	while (std::chrono::steady_clock::now() < start) {}
+
+	const auto sent = std::chrono::steady_clock::now();
+	size_t written = 0;
+	while (written < frame.size()) {
+	  try {
+	    written += port_.write(frame.data() + written, frame.size() - written);
+	  } catch (ComAccessException& ex) {
+	    if (errno != EAGAIN && errno != EINTR) break;
+	    struct pollfd pfd;
+	    pfd.fd = port_.getFileDescriptor();
+	    pfd.events = POLLOUT;
+	    poll(&pfd, 1, 10);
+	  }
+	}
+	frames_++;
+	busIdle_ = std::chrono::steady_clock::now() + seconds(timing_.characters(frame.size()));
+	return sent;
+      }
+
+      /**
+       * @brief Wait readable without spinning.
+       */
+      bool waitReadable(const std::chrono::steady_clock::duration& timeout) {
+	struct pollfd pfd;
+	pfd.fd = port_.getFileDescriptor();
+	pfd.events = POLLIN;
+#ifdef __linux__
+	const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+	struct timespec ts;
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	return ppoll(&pfd, 1, &ts, NULL) > 0;
+#else
+	return poll(&pfd, 1, (int)std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count() + 1) > 0;
+#endif
+      }
+
+      void receive() {
+	auto deadline = busIdle_;
+	size_t pending = 0;
+	for (size_t i = 0; i < window_.size(); i++) {
+	  if (window_[i].status != SerialTransaction::PENDING) continue;
+	  pending++;
+	  deadline += seconds(responseTimeout_ + protocol_.interFrameGap(timing_) +
+			      timing_.characters(protocol_.responseLength(window_[i].request.view())));
+	}
+
+	rxSize_ = 0;
+	while (pending > 0) {
+	  const auto now = std::chrono::steady_clock::now();
+	  if (now >= deadline) break;
+	  if (!waitReadable(deadline - now)) continue;
+	  if (rxSize_ == rxBuffer_.size()) rxBuffer_.resize(rxBuffer_.size() * 2);
+	  int size;
+	  try {
+	    size = port_.read(rxBuffer_.data() + rxSize_, rxBuffer_.size() - rxSize_);
+	  } catch (ComAccessException& ex) {
+	    continue;
+	  }
+	  if (size <= 0) continue;
+	  rxSize_ += size;
+	  busIdle_ = std::chrono::steady_clock::now();
+
+	  size_t offset = 0;
+	  while (offset < rxSize_) {
+	    const ByteView data = rxBuffer_.slice(offset, rxSize_ - offset);
+	    const int length = protocol_.frameLength(data);
+	    if (length == 0) break;
+	    if (length < 0) {
+	      offset++;
+	      continue;
+	    }
+	    const ByteView frame = data.slice(0, length);
+	    const int id = protocol_.frameId(frame);
+	    for (size_t i = 0; i < window_.size(); i++) {
+	      if (window_[i].status == SerialTransaction::PENDING && window_[i].id == id) {
+		window_[i].response = ByteBuffer(frame.data(), frame.size());
+		window_[i].status = SerialTransaction::DONE;
+		window_[i].completed = busIdle_;
+		pending--;
+		break;
+	      }
+	    }
+	    offset += length;
+	  }
+	  if (offset > 0) {
+	    memmove(rxBuffer_.data(), rxBuffer_.data() + offset, rxSize_ - offset);
+	    rxSize_ -= offset;
+	  }
+	}
+      }
+    };
+
+
+    /***************************************************
+     * ModbusRtuProtocol
+     *
+     * @brief Modbus-RTU framing. Responses are checked with CRC.
+     ***************************************************/
+    class ModbusRtuProtocol : public SerialProtocol {
+    public:
+      const static uint8_t BROADCAST_ID = 0;
+
+      static uint16_t crc16(const uint8_t* data, const size_t size) {
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < size; i++) {
+	  crc ^= data[i];
+	  for (int b = 0; b < 8; b++) {
+	    crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	  }
+	}
+	return crc;
+      }
+
+      const static size_t MAX_PDU_SIZE = 254; ///< address + the 253 bytes of PDU of the specification
+
+      /**
+       * @brief pdu with CRC appended.
+       * @throw SerialTransactionException if size is over MAX_PDU_SIZE.
+       */
+      static ByteBuffer frame(const uint8_t* pdu, const size_t size) {
+	if (size > MAX_PDU_SIZE) throw SerialTransactionException("Modbus-RTU PDU too large");
+	ByteBuffer buffer(size + 2);
+	memcpy(buffer.data(), pdu, size);
+	const uint16_t crc = crc16(pdu, size);
+	buffer[size] = crc & 0xFF;
+	buffer[size + 1] = crc >> 8;
+	return buffer;
+      }
+
+      static ByteBuffer readHoldingRegisters(const uint8_t id, const uint16_t address, const uint16_t count) {
+	const uint8_t pdu[] = {id, 0x03, (uint8_t)(address >> 8), (uint8_t)address, (uint8_t)(count >> 8), (uint8_t)count};
+	return frame(pdu, sizeof(pdu));
+      }
+
+      static ByteBuffer readInputRegisters(const uint8_t id, const uint16_t address, const uint16_t count) {
+	const uint8_t pdu[] = {id, 0x04, (uint8_t)(address >> 8), (uint8_t)address, (uint8_t)(count >> 8), (uint8_t)count};
+	return frame(pdu, sizeof(pdu));
+      }
+
+      static ByteBuffer writeSingleRegister(const uint8_t id, const uint16_t address, const uint16_t value) {
+	const uint8_t pdu[] = {id, 0x06, (uint8_t)(address >> 8), (uint8_t)address, (uint8_t)(value >> 8), (uint8_t)value};
+	return frame(pdu, sizeof(pdu));
+      }
+
+    public:
+      /// address, function and CRC
+      virtual size_t minFrameSize() const { return 4; }
+
+      virtual int frameLength(const ByteView& data) const {
+	if (data.size() < 2) return 0;
+	const uint8_t function = data[1];
+	size_t length;
+	if (function & 0x80) {
+	  length = 5;
+	} else if (function >= 1 && function <= 4) {
+	  if (data.size() < 3) return 0;
+	  length = 5 + data[2];
+	} else if (function == 5 || function == 6 || function == 15 || function == 16) {
+	  length = 8;
+	} else {
+	  return -1;
+	}
+	if (data.size() < length) return 0;
+	const uint16_t crc = crc16(data.data(), length - 2);
+	if (data[length - 2] != (crc & 0xFF) || data[length - 1] != (crc >> 8)) return -1;
+	return (int)length;
+      }
+
+      virtual int frameId(const ByteView& frame) const { return frame[0]; }
+
+      virtual size_t responseLength(const ByteView& request) const {
+	if (request.size() < 6) return 0;
+	const size_t count = ((size_t)request[4] << 8) | request[5];
+	switch (request[1]) {
+	case 1: case 2: return 5 + (count + 7) / 8;
+	case 3: case 4: return 5 + count * 2;
+	default: return 8;
+	}
+      }
+
+      virtual bool expectsResponse(const ByteView& request) const { return request[0] != BROADCAST_ID; }
+
+      virtual double interFrameGap(const SerialTiming& timing) const {
+	/// Modbus over serial line recommends fixed 1.75 ms above 19200 bps.
+	const double gap = timing.characters(3.5);
+	return gap < 0.00175 ? 0.00175 : gap;
+      }
+    };
+
+
+    /***************************************************
+     * DynamixelProtocol2
+     *
+     * @brief Dynamixel Protocol 2.0 framing with Sync Read merging.
+     ***************************************************/
+    class DynamixelProtocol2 : public SerialProtocol {
+    public:
+      const static uint8_t BROADCAST_ID = 0xFE;
+      const static uint8_t INST_READ = 0x02;
+      const static uint8_t INST_WRITE = 0x03;
+      const static uint8_t INST_SYNC_READ = 0x82;
+      const static uint8_t INST_STATUS = 0x55;
+
+      static uint16_t crc16(const uint8_t* data, const size_t size) {
+	uint16_t crc = 0;
+	for (size_t i = 0; i < size; i++) {
+	  crc ^= (uint16_t)data[i] << 8;
+	  for (int b = 0; b < 8; b++) {
+	    crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+	  }
+	}
+	return crc;
+      }
+
+      /**
+       * @brief Build packet. Parameters are byte-stuffed.
+       */
+      static ByteBuffer packet(const uint8_t id, const uint8_t instruction, const uint8_t* params, const size_t size) {
+	ByteBuffer buffer(10 + size + size / 3);
+	uint8_t* p = buffer.data();
+	size_t n = 8;
+	for (size_t i = 0; i < size; i++) {
+	  p[n++] = params[i];
+	  if (i >= 2 && params[i] == 0xFD && params[i - 1] == 0xFF && params[i - 2] == 0xFF) p[n++] = 0xFD;
+	}
+	const size_t length = n - 8 + 3;
+	p[0] = 0xFF; p[1] = 0xFF; p[2] = 0xFD; p[3] = 0x00;
+	p[4] = id;
+	p[5] = length & 0xFF;
+	p[6] = length >> 8;
+	p[7] = instruction;
+	const uint16_t crc = crc16(p, n);
+	p[n++] = crc & 0xFF;
+	p[n++] = crc >> 8;
+	buffer.resize(n);
+	return buffer;
+      }
+
+      static ByteBuffer read(const uint8_t id, const uint16_t address, const uint16_t length) {
+	const uint8_t params[] = {(uint8_t)address, (uint8_t)(address >> 8), (uint8_t)length, (uint8_t)(length >> 8)};
+	return packet(id, INST_READ, params, sizeof(params));
+      }
+
+      static ByteBuffer write(const uint8_t id, const uint16_t address, const uint8_t* data, const size_t size) {
+	uint8_t params[258];
+	params[0] = (uint8_t)address;
+	params[1] = (uint8_t)(address >> 8);
+	const size_t n = size < sizeof(params) - 2 ? size : sizeof(params) - 2;
+	memcpy(params + 2, data, n);
+	return packet(id, INST_WRITE, params, n + 2);
+      }
+
+    public:
+      /// header, ID, length, instruction and CRC
+      virtual size_t minFrameSize() const { return 10; }
+
+      virtual int frameLength(const ByteView& data) const {
+	static const uint8_t header[] = {0xFF, 0xFF, 0xFD, 0x00};
+	for (size_t i = 0; i < 4 && i < data.size(); i++) {
+	  if (data[i] != header[i]) return -1;
+	}
+	if (data.size() < 7) return 0;
+	const size_t length = 7 + (((size_t)data[6] << 8) | data[5]);
+	if (length < 10) return -1;
+	if (data.size() < length) return 0;
+	const uint16_t crc = crc16(data.data(), length - 2);
+	if (data[length - 2] != (crc & 0xFF) || data[length - 1] != (crc >> 8)) return -1;
+	return (int)length;
+      }
+
+      virtual int frameId(const ByteView& frame) const { return frame[4]; }
+
+      virtual size_t responseLength(const ByteView& request) const {
+	if (request.size() >= 12 && request[7] == INST_READ) return 11 + (((size_t)request[11] << 8) | request[10]);
+	return 11;
+      }
+
+      virtual bool expectsResponse(const ByteView& request) const { return request[4] != BROADCAST_ID || request[7] == INST_SYNC_READ; }
+
+      /// Devices wait for their Return Delay Time. No silent interval is required.
+      virtual double interFrameGap(const SerialTiming& /*timing*/) const { return 0.0; }
+
+      virtual bool canMerge(const ByteView& first, const ByteView& request) const {
+	if (first.size() != 14 || request.size() != 14) return false;
+	if (first[7] != INST_READ || request[7] != INST_READ) return false;
+	if (first[4] == BROADCAST_ID || request[4] == BROADCAST_ID) return false;
+	return memcmp(first.data() + 8, request.data() + 8, 4) == 0;
+      }
+
+      virtual void buildMerged(const std::vector<ByteView>& requests, ByteBuffer& frame) const {
+	uint8_t params[4 + 252];
+	memcpy(params, requests[0].data() + 8, 4);
+	size_t n = 4;
+	for (size_t i = 0; i < requests.size() && n < sizeof(params); i++) params[n++] = requests[i][4];
+	frame = packet(BROADCAST_ID, INST_SYNC_READ, params, n);
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifndef WIN32
@@ -61,6 +61,25 @@ namespace ssr {
 
 
   public:
+#ifndef WIN32
+    int getFileDescriptor() const { return m_ServerSocket; }
+#endif
+
+    /**
+     * @brief Port number actually bound. Useful after bind(0).
+     */
+    unsigned int getPort() const {
+      struct sockaddr_in addr;
+#ifdef WIN32
+      int len = sizeof(addr);
+#else
+      socklen_t len = sizeof(addr);
+#endif
+      if (getsockname(m_ServerSocket, (struct sockaddr*)&addr, &len) < 0) {
+	throw SocketException("getsockname failed.");
+      }
+      return ntohs(addr.sin_port);
+    }
 
     void close() {
 #ifdef WIN32
@@ -114,8 +133,8 @@ namespace ssr {
       FD_SET(m_ServerSocket, &fds);
       
       struct timeval timeout;
-      timeout.tv_sec = timeoutUsec / 100000;
-      timeout.tv_usec = timeoutUsec % 100000;
+      timeout.tv_sec = timeoutUsec / 1000000;
+      timeout.tv_usec = timeoutUsec % 1000000;
       int result = select(m_ServerSocket+1, &fds, NULL, NULL, &timeout);
       if (result < 0) {
             perror("SELECT FAILED");
@@ -162,6 +181,28 @@ namespace ssr {
 #endif
     }
 
+#ifndef WIN32
+    /**
+     * @brief accept() without exceptions.
+     * @param timeoutUsec microseconds, negative to wait for ever.
+     * @return connected Socket, or ETIMEDOUT, or errno of poll() / accept().
+     */
+    Result<Socket> tryAccept(const int timeoutUsec = -1) noexcept {
+      struct pollfd pfd;
+      pfd.fd = m_ServerSocket;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      const int r = poll(&pfd, 1, timeoutUsec < 0 ? -1 : (timeoutUsec + 999) / 1000);
+      if (r < 0) return ErrorCode(errno);
+      if (r == 0) return ErrorCode(ETIMEDOUT);
+
+      struct sockaddr_in sockaddr_;
+      socklen_t len = sizeof(sockaddr_);
+      const int client_sock = ::accept(m_ServerSocket, (struct sockaddr*)&sockaddr_, &len);
+      if (client_sock < 0) return ErrorCode(errno);
+      return Socket(client_sock, sockaddr_);
+    }
+#endif
     
   };
   }
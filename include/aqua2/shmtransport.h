@@ -0,0 +1,508 @@
+/********************************************************
+ * shmtransport.h
+ *
+ * Shared memory publish / subscribe between processes
+ * on one host (Linux only).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <string>
+#include <atomic>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief This exception is thrown when a shared memory segment can not be created or opened.
+     */
+    class ShmException : public std::exception {
+    private:
+      std::string msg_;
+    public:
+      ShmException(const std::string& msg) : msg_(msg) {}
+      ~ShmException(void) throw() {}
+      const char* what() const throw() { return msg_.c_str(); }
+    };
+
+    namespace detail {
+
+      static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "shared memory ring needs lock-free atomics");
+
+      /**
+       * @brief Head of the segment. Slots follow at HEADER_SIZE.
+       */
+      struct ShmRingHeader {
+	const static uint32_t MAGIC = 0x41325348; // "HS2A"
+	const static uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slotSize;
+	uint32_t slotCount;
+	uint64_t stride;
+	alignas(64) std::atomic<uint64_t> written;  ///< messages committed
+	alignas(64) std::atomic<uint32_t> futex;    ///< incremented by every commit
+	std::atomic<uint32_t> waiters;              ///< subscribers in futex wait
+      };
+
+      /**
+       * @brief Slot of the ring. Message of sequence s is in slot s % slotCount,
+       *        sequence is 2s + 1 while it is written and 2s + 2 when committed.
+       */
+      struct ShmSlot {
+	const static size_t HEADER_SIZE = 16;
+
+	std::atomic<uint64_t> sequence;
+	uint32_t size;
+	uint32_t reserved;
+
+	uint8_t* data() { return (uint8_t*)this + HEADER_SIZE; }
+      };
+
+      const static size_t SHM_HEADER_SIZE = (sizeof(ShmRingHeader) + 63) / 64 * 64;
+
+      inline size_t shmStride(const uint32_t slotSize) { return (ShmSlot::HEADER_SIZE + slotSize + 63) / 64 * 64; }
+
+      inline long futex(std::atomic<uint32_t>* addr, const int op, const uint32_t value, const struct timespec* timeout) {
+	return syscall(SYS_futex, (uint32_t*)addr, op, value, timeout, NULL, 0);
+      }
+
+      /**
+       * @brief mmap()ed segment. Owns fd and mapping.
+       */
+      class ShmSegment {
+      private:
+	int fd_;
+	void* base_;
+	size_t size_;
+	std::string unlink_;
+
+      public:
+	ShmSegment() : fd_(-1), base_(MAP_FAILED), size_(0) {}
+
+	~ShmSegment() { close(); }
+
+      private:
+	ShmSegment(const ShmSegment&);
+	ShmSegment& operator=(const ShmSegment&);
+
+      public:
+	/**
+	 * @brief New segment named name (shm_open, replacing a stale one), or memfd if name is empty.
+	 */
+	void create(const std::string& name, const size_t size) {
+	  if (name.empty()) {
+	    fd_ = syscall(SYS_memfd_create, "aqua2", MFD_CLOEXEC);
+	  } else {
+	    shm_unlink(name.c_str());
+	    fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	    if (fd_ >= 0) unlink_ = name;
+	  }
+	  if (fd_ < 0) throw ShmException("can not create shared memory " + name + ": " + strerror(errno));
+	  if (ftruncate(fd_, size) != 0) {
+	    const int e = errno;
+	    close();
+	    throw ShmException(std::string("ftruncate failed: ") + strerror(e));
+	  }
+	  map(size);
+	}
+
+	void open(const std::string& name) {
+	  if ((fd_ = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0)) < 0) {
+	    throw ShmException("can not open shared memory " + name + ": " + strerror(errno));
+	  }
+	  mapAll();
+	}
+
+	/**
+	 * @brief Map segment of fd (eg., memfd received from the publisher). fd is duplicated.
+	 */
+	void open(const int fd) {
+	  if ((fd_ = fcntl(fd, F_DUPFD_CLOEXEC, 0)) < 0) throw ShmException(std::string("invalid file descriptor: ") + strerror(errno));
+	  mapAll();
+	}
+
+	void close() {
+	  if (base_ != MAP_FAILED) munmap(base_, size_);
+	  base_ = MAP_FAILED;
+	  if (fd_ >= 0) ::close(fd_);
+	  fd_ = -1;
+	  if (!unlink_.empty()) shm_unlink(unlink_.c_str());
+	  unlink_.clear();
+	}
+
+	int getFileDescriptor() const { return fd_; }
+	uint8_t* base() const { return (uint8_t*)base_; }
+	size_t size() const { return size_; }
+
+      private:
+	void mapAll() {
+	  struct stat st;
+	  if (fstat(fd_, &st) != 0 || (size_t)st.st_size < SHM_HEADER_SIZE) {
+	    close();
+	    throw ShmException("shared memory is not a ring");
+	  }
+	  map(st.st_size);
+	}
+
+	void map(const size_t size) {
+	  base_ = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	  if (base_ == MAP_FAILED) {
+	    const int e = errno;
+	    close();
+	    throw ShmException(std::string("mmap failed: ") + strerror(e));
+	  }
+	  size_ = size;
+	}
+      };
+
+    }; // namespace detail
+
+
+    /***************************************************
+     * ShmPublisher
+     *
+     * @brief Writes messages into a shared memory ring read by any number of ShmSubscribers.
+     *
+     * The segment is a ring of slotCount slots of up to slotSize bytes.
+     * Messages are written in place: allocate() returns the slot and
+     * commit() publishes it. Subscribers never slow the publisher down;
+     * a subscriber more than slotCount messages behind loses the oldest
+     * ones (counted by ShmSubscriber::getLostMessages()). A wake up
+     * system call is made only when a subscriber sleeps in wait().
+     *
+     * One publisher per segment. It is created by name with shm_open()
+     * (replacing a stale segment of the same name) and unlinked by the
+     * destructor, or anonymously with memfd_create() to hand the file
+     * descriptor to children or over a Unix socket.
+     *
+     * Usage:
+     *   ShmPublisher pub("/robot_state", 256, 64);
+     *   State* s = (State*)pub.allocate();
+     *   s->x = ...;
+     *   pub.commit(sizeof(State));
+     *   // or pub.write(&state, sizeof(state));
+     ***************************************************/
+    class ShmPublisher {
+    private:
+      detail::ShmSegment segment_;
+      detail::ShmRingHeader* header_;
+      uint32_t slotSize_;
+      uint32_t slotCount_;
+      uint64_t stride_;
+      uint64_t next_;
+      detail::ShmSlot* current_;
+
+    public:
+      /**
+       * @param name shm_open() name ("/name"). Empty for memfd.
+       * @param slotSize maximum message size
+       * @param slotCount messages kept in the ring (2 or more)
+       */
+      ShmPublisher(const std::string& name, const uint32_t slotSize, const uint32_t slotCount = 64) :
+	header_(nullptr), slotSize_(slotSize), slotCount_(slotCount), stride_(detail::shmStride(slotSize)), next_(0), current_(nullptr) {
+	if (slotSize == 0 || slotCount < 2) throw ShmException("slotSize must be positive and slotCount 2 or more");
+	segment_.create(name, detail::SHM_HEADER_SIZE + stride_ * slotCount);
+	header_ = new (segment_.base()) detail::ShmRingHeader();
+	header_->slotSize = slotSize;
+	header_->slotCount = slotCount;
+	header_->stride = stride_;
+	header_->written.store(0, std::memory_order_relaxed);
+	header_->futex.store(0, std::memory_order_relaxed);
+	header_->waiters.store(0, std::memory_order_relaxed);
+	for (uint32_t i = 0; i < slotCount; i++) {
+	  detail::ShmSlot* slot = new (segment_.base() + detail::SHM_HEADER_SIZE + stride_ * i) detail::ShmSlot();
+	  slot->sequence.store(0, std::memory_order_relaxed);
+	  slot->size = 0;
+	}
+	header_->magic = detail::ShmRingHeader::MAGIC;
+	header_->version = detail::ShmRingHeader::VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+      }
+
+    private:
+      ShmPublisher(const ShmPublisher&);
+      ShmPublisher& operator=(const ShmPublisher&);
+
+    public:
+      /**
+       * @brief Segment to pass to ShmSubscriber(int fd) in another process.
+       */
+      int getFileDescriptor() const { return segment_.getFileDescriptor(); }
+
+      uint32_t getSlotSize() const { return slotSize_; }
+      uint32_t getSlotCount() const { return slotCount_; }
+
+      /**
+       * @brief Slot (slotSize bytes) of the next message. Write into it and commit().
+       */
+      void* allocate() {
+	if (!current_) {
+	  current_ = (detail::ShmSlot*)(segment_.base() + detail::SHM_HEADER_SIZE + stride_ * (next_ % slotCount_));
+	  current_->sequence.store(2 * next_ + 1, std::memory_order_relaxed);
+	  std::atomic_thread_fence(std::memory_order_release);
+	}
+	return current_->data();
+      }
+
+      /**
+       * @brief Publish size bytes written in the slot given by allocate().
+       */
+      void commit(const uint32_t size) {
+	if (!current_) throw ShmException("commit() without allocate()");
+	if (size > slotSize_) throw ShmException("message is larger than slotSize");
+	current_->size = size;
+	current_->sequence.store(2 * next_ + 2, std::memory_order_release);
+	current_ = nullptr;
+	header_->written.store(++next_, std::memory_order_release);
+	header_->futex.fetch_add(1, std::memory_order_seq_cst);
+	if (header_->waiters.load(std::memory_order_seq_cst) > 0) {
+	  detail::futex(&header_->futex, FUTEX_WAKE, INT_MAX, NULL);
+	}
+      }
+
+      /**
+       * @brief Copy and publish one message.
+       * @return size, or -1 if it is larger than slotSize.
+       */
+      int write(const void* src, const unsigned int size) {
+	if (size > slotSize_) return -1;
+	memcpy(allocate(), src, size);
+	commit(size);
+	return size;
+      }
+
+      /**
+       * @brief Messages published.
+       */
+      uint64_t getMessages() const { return next_; }
+    };
+
+
+    /***************************************************
+     * ShmSubscriber
+     *
+     * @brief Reads messages of a ShmPublisher from the shared memory ring without copy.
+     *
+     * Each subscriber has its own position and sees every message
+     * committed after it was opened, unless it falls more than slotCount
+     * behind. receive() returns a pointer into the ring; the publisher
+     * may overwrite the slot while it is in use, so release() tells
+     * whether what was read is valid (as a sequence lock). read() copies.
+     *
+     * wait() spins for the busy poll time (no system call, lowest latency
+     * when a CPU is free for it) and then sleeps on a futex.
+     *
+     * Usage:
+     *   ShmSubscriber sub("/robot_state");
+     *   sub.setBusyPoll(20000);
+     *   while (sub.wait(100)) {
+     *     uint32_t size;
+     *     while (const void* p = sub.receive(size)) {
+     *       State s = *(const State*)p;
+     *       if (sub.release()) use(s);
+     *     }
+     *   }
+     ***************************************************/
+    class ShmSubscriber {
+    private:
+      detail::ShmSegment segment_;
+      detail::ShmRingHeader* header_;
+      uint32_t slotSize_;
+      uint32_t slotCount_;
+      uint64_t stride_;
+      uint64_t next_;
+      detail::ShmSlot* current_;
+      uint64_t currentSequence_;
+      uint64_t busyPoll_;
+      uint64_t lost_;
+
+    public:
+      ShmSubscriber(const std::string& name) : busyPoll_(0), lost_(0) {
+	segment_.open(name);
+	init();
+      }
+
+      /**
+       * @param fd segment of ShmPublisher::getFileDescriptor() (duplicated).
+       */
+      ShmSubscriber(const int fd) : busyPoll_(0), lost_(0) {
+	segment_.open(fd);
+	init();
+      }
+
+    private:
+      ShmSubscriber(const ShmSubscriber&);
+      ShmSubscriber& operator=(const ShmSubscriber&);
+
+      void init() {
+	header_ = (detail::ShmRingHeader*)segment_.base();
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (header_->magic != detail::ShmRingHeader::MAGIC || header_->version != detail::ShmRingHeader::VERSION ||
+	    header_->slotCount < 2 || header_->stride != detail::shmStride(header_->slotSize) ||
+	    detail::SHM_HEADER_SIZE + header_->stride * header_->slotCount > segment_.size()) {
+	  segment_.close();
+	  throw ShmException("shared memory is not a ring");
+	}
+	slotSize_ = header_->slotSize;
+	slotCount_ = header_->slotCount;
+	stride_ = header_->stride;
+	next_ = header_->written.load(std::memory_order_acquire);
+	current_ = nullptr;
+	currentSequence_ = 0;
+      }
+
+      detail::ShmSlot* slot(const uint64_t s) const {
+	return (detail::ShmSlot*)(segment_.base() + detail::SHM_HEADER_SIZE + stride_ * (s % slotCount_));
+      }
+
+    public:
+      uint32_t getSlotSize() const { return slotSize_; }
+
+      /**
+       * @brief Spin this long [ns] in wait() before sleeping. 0 to sleep at once.
+       */
+      void setBusyPoll(const uint64_t nanoseconds) { busyPoll_ = nanoseconds; }
+
+      /**
+       * @brief Messages not read yet (some of them may be lost before read).
+       */
+      uint64_t available() const {
+	return header_->written.load(std::memory_order_acquire) - next_;
+      }
+
+      /**
+       * @brief Messages overwritten before this subscriber read them.
+       */
+      uint64_t getLostMessages() const { return lost_; }
+
+      /**
+       * @brief Wait for a message.
+       * @param timeout milliseconds, -1 for ever.
+       * @return true if a message is available.
+       */
+      bool wait(const int timeout) {
+	if (available()) return true;
+	if (busyPoll_) {
+	  const uint64_t end = now() + busyPoll_;
+	  while (now() < end) if (available()) return true;
+	}
+	const uint64_t deadline = timeout >= 0 ? now() + (uint64_t)timeout * 1000000ULL : 0;
+	for (;;) {
+	  header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+	  const uint32_t value = header_->futex.load(std::memory_order_seq_cst);
+	  if (available()) {
+	    header_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+	    return true;
+	  }
+	  struct timespec ts, *pts = NULL;
+	  if (timeout >= 0) {
+	    const uint64_t t = now();
+	    const uint64_t rest = deadline > t ? deadline - t : 0;
+	    ts.tv_sec = rest / 1000000000ULL;
+	    ts.tv_nsec = rest % 1000000000ULL;
+	    pts = &ts;
+	  }
+	  const long r = detail::futex(&header_->futex, FUTEX_WAIT, value, pts);
+	  const int e = errno;
+	  header_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+	  if (available()) return true;
+	  if (r != 0 && e == ETIMEDOUT) return false;
+	  if (timeout >= 0 && now() >= deadline) return false;
+	}
+      }
+
+      /**
+       * @brief Next message in place, or nullptr if none. Call release() when done with it.
+       */
+      const void* receive(uint32_t& size) {
+	for (;;) {
+	  const uint64_t written = header_->written.load(std::memory_order_acquire);
+	  if (next_ >= written) return nullptr;
+	  if (written - next_ >= slotCount_) { // the slot of next_ may be being overwritten
+	    lost_ += written - slotCount_ + 1 - next_;
+	    next_ = written - slotCount_ + 1;
+	  }
+	  current_ = slot(next_);
+	  currentSequence_ = 2 * next_ + 2;
+	  if (current_->sequence.load(std::memory_order_acquire) == currentSequence_) {
+	    size = current_->size;
+	    if (size > slotSize_) size = slotSize_;
+	    return current_->data();
+	  }
+	  lost_++;
+	  next_++;
+	  current_ = nullptr;
+	}
+      }
+
+      /**
+       * @brief Done with the message of receive().
+       * @return false if it was overwritten meanwhile (and what was read must be discarded).
+       */
+      bool release() {
+	if (!current_) return false;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const bool valid = current_->sequence.load(std::memory_order_relaxed) == currentSequence_;
+	current_ = nullptr;
+	next_++;
+	if (!valid) lost_++;
+	return valid;
+      }
+
+      /**
+       * @brief Size of the next message, 0 if none.
+       */
+      int getSizeInRxBuffer() {
+	uint32_t size = 0;
+	for (;;) {
+	  if (!receive(size)) return 0;
+	  current_ = nullptr; // peek only
+	  std::atomic_thread_fence(std::memory_order_acquire);
+	  if (slot(next_)->sequence.load(std::memory_order_relaxed) == currentSequence_) return size;
+	}
+      }
+
+      /**
+       * @brief Copy the next message (truncated to size) without waiting.
+       * @return size of the message, 0 if none.
+       */
+      int read(void* dst, const unsigned int size) {
+	uint32_t n;
+	while (const void* p = receive(n)) {
+	  memcpy(dst, p, n < size ? n : size);
+	  if (release()) return n;
+	}
+	return 0;
+      }
+
+    private:
+      static uint64_t now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifdef __linux__
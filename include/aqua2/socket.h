@@ -21,6 +21,10 @@
 #include <netdb.h>
 #include <sys/ioctl.h>
 #include <poll.h>
+
+#ifndef POLLSTANDARD // not defined on Linux
+#define POLLSTANDARD (POLLIN|POLLPRI|POLLOUT|POLLRDNORM|POLLRDBAND|POLLWRBAND|POLLERR|POLLHUP|POLLNVAL)
+#endif
 #endif // WIN32
 
 
@@ -29,6 +33,8 @@
 #include <string>
 #include <sstream>
 
+#include "waitstrategy.h"
+#include "result.h"
 
 #pragma comment(lib, "Ws2_32.lib")
 
@@ -76,14 +82,14 @@ namespace ssr {
     private:
       std::string msg;
     public:
-      SocketException() : msg("Unknown") {}
-      SocketException(const char* msg_) : msg(msg_) {}
+      SocketException() : msg("SocketException: Unknown") {}
+      SocketException(const char* msg_) : msg(std::string("SocketException: ") + msg_) {}
       ~SocketException() throw() {}
       
       
     public:
       const char* what() const throw() {
-	return (("SocketException: ") + msg).c_str();
+	return msg.c_str(); // kept in the member, the pointer lives as long as the exception
       }
       
     };
@@ -105,6 +111,7 @@ namespace ssr {
       int m_Socket;
       struct sockaddr_in  m_SockAddr;
       struct hostent*     m_HostEnt;
+      WaitStrategy* waitStrategy_;
 #endif // WIN32
       
     private:
@@ -125,6 +132,10 @@ namespace ssr {
     public:
       bool okay() const { return okay_ ; }
 
+#ifndef WIN32
+      int getFileDescriptor() const { return m_Socket; }
+#endif
+
       bool isConnected() {
             /*
             fd_set read_sd;
@@ -171,13 +182,19 @@ namespace ssr {
 
 
     public:
-      Socket() {
+      Socket() : okay_(false) {
+#ifndef WIN32
+       waitStrategy_ = nullptr;
+#endif
       }
       
       /**
        * Constructor
        */
       Socket(const char* address, const uint32_t port) : okay_(false) {
+#ifndef WIN32
+	      waitStrategy_ = nullptr;
+#endif
 	      connect(address, port);
       }
       
@@ -253,6 +270,7 @@ namespace ssr {
        okay_ = socket.okay_;
        m_SockAddr = socket.m_SockAddr;
        m_Socket = socket.m_Socket;
+       waitStrategy_ = socket.waitStrategy_;
 #endif
       }
       
@@ -264,7 +282,7 @@ namespace ssr {
        m_SockAddr = sockaddr_;
       }
 #else // WIN32
-      Socket(int hsocket, struct sockaddr_in& sockaddr_): okay_(true)
+      Socket(int hsocket, struct sockaddr_in& sockaddr_): okay_(true), waitStrategy_(nullptr)
 	{
             m_Socket = hsocket;
             m_SockAddr = sockaddr_;
@@ -318,6 +336,74 @@ namespace ssr {
        return recv(m_Socket, dst, size, 0);
 #endif      
       }
+
+#ifndef WIN32
+      /**
+       * @brief Strategy of waitAvailable() / read(dst, size, timeout). Not owned. nullptr to poll() at once.
+       */
+      void setWaitStrategy(WaitStrategy* strategy) { waitStrategy_ = strategy; }
+
+      WaitStrategy* getWaitStrategy() const { return waitStrategy_; }
+
+      /**
+       * @brief Wait until bytes are received.
+       * @param timeout seconds. 0 or less waits for ever.
+       * @return 0 if received, -2 if timeout, -1 if closed by peer or error.
+       */
+      int waitAvailable(const uint32_t bytes, const double timeout = 0.0) {
+       const int r = (waitStrategy_ ? *waitStrategy_ : defaultWaitStrategy()).wait(m_Socket, bytes, timeout);
+       return r == WaitStrategy::READY ? 0 : (r == WaitStrategy::TIMEOUT ? -2 : -1);
+      }
+
+      /**
+       * @brief Read size bytes once they are all received.
+       * @return size, or -1 if timeout, closed by peer or error.
+       */
+      int read(void* dst, const unsigned int size, const double timeout)
+      {
+       if (waitAvailable(size, timeout) != 0) return -1;
+       return read(dst, size);
+      }
+
+      /// Non-throwing I/O. Results carry errno values instead of exceptions / -1.
+
+      /**
+       * @return bytes received (0 if closed by peer), or errno (EAGAIN, ECONNRESET, ...).
+       */
+      Result<int> tryRead(void* dst, const unsigned int size) noexcept
+      {
+       const ssize_t n = recv(m_Socket, dst, size, 0);
+       if (n < 0) return ErrorCode(errno);
+       return (int)n;
+      }
+
+      /**
+       * @brief read size bytes once they are all received.
+       * @param timeout seconds. 0 or less waits for ever.
+       * @return size, or ETIMEDOUT, ECONNRESET (closed by peer or error), errno of recv().
+       */
+      Result<int> tryRead(void* dst, const unsigned int size, const double timeout) noexcept
+      {
+       const int r = (waitStrategy_ ? *waitStrategy_ : defaultWaitStrategy()).wait(m_Socket, size, timeout);
+       if (r == WaitStrategy::TIMEOUT) return ErrorCode(ETIMEDOUT);
+       if (r != WaitStrategy::READY) return ErrorCode(ECONNRESET);
+       return tryRead(dst, size);
+      }
+
+      /**
+       * @return bytes sent, or errno (EPIPE if closed by peer: no SIGPIPE is raised).
+       */
+      Result<int> tryWrite(const void* src, const unsigned int size) noexcept
+      {
+#ifdef MSG_NOSIGNAL
+       const ssize_t n = send(m_Socket, src, size, MSG_NOSIGNAL);
+#else
+       const ssize_t n = send(m_Socket, src, size, 0);
+#endif
+       if (n < 0) return ErrorCode(errno);
+       return (int)n;
+      }
+#endif
       
       int close()
       {
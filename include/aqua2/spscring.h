@@ -0,0 +1,130 @@
+/********************************************************
+ * spscring.h
+ *
+ * Fixed-capacity lock-free single-producer / single-consumer ring.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * SpscRing
+     *
+     * @brief Wait-free ring of Capacity (power of two) items.
+     *
+     * push() is called from one producer thread, and peek() / pop() /
+     * consume() from one consumer thread. Items are copied in place,
+     * so nothing is allocated after construction.
+     ***************************************************/
+    template<typename T, size_t Capacity>
+    class SpscRing {
+      static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+      const static size_t MASK = Capacity - 1;
+
+    private:
+      alignas(64) std::atomic<size_t> head_; ///< written by producer
+      alignas(64) std::atomic<size_t> tail_; ///< written by consumer
+      alignas(64) T items_[Capacity];
+
+    public:
+      /***************************************************
+       * View
+       *
+       * @brief First items of the ring at the time of peek(). Valid until consume().
+       ***************************************************/
+      class View {
+      private:
+	const SpscRing* ring_;
+	size_t begin_;
+	size_t size_;
+
+      public:
+	class iterator {
+	private:
+	  const SpscRing* ring_;
+	  size_t pos_;
+	public:
+	  iterator(const SpscRing* ring, const size_t pos) : ring_(ring), pos_(pos) {}
+	  const T& operator*() const { return ring_->items_[pos_ & MASK]; }
+	  const T* operator->() const { return &ring_->items_[pos_ & MASK]; }
+	  iterator& operator++() { pos_++; return *this; }
+	  bool operator==(const iterator& it) const { return pos_ == it.pos_; }
+	  bool operator!=(const iterator& it) const { return pos_ != it.pos_; }
+	};
+
+	View() : ring_(nullptr), begin_(0), size_(0) {}
+	View(const SpscRing* ring, const size_t begin, const size_t size) : ring_(ring), begin_(begin), size_(size) {}
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	const T& operator[](const size_t i) const { return ring_->items_[(begin_ + i) & MASK]; }
+	iterator begin() const { return iterator(ring_, begin_); }
+	iterator end() const { return iterator(ring_, begin_ + size_); }
+      };
+
+    public:
+      SpscRing() : head_(0), tail_(0) {}
+
+    private:
+      SpscRing(const SpscRing&);
+      SpscRing& operator=(const SpscRing&);
+
+    public:
+      static size_t capacity() { return Capacity; }
+
+      /**
+       * @brief Producer side.
+       * @return false if ring is full (item is not stored).
+       */
+      bool push(const T& item) {
+	const size_t head = head_.load(std::memory_order_relaxed);
+	if (head - tail_.load(std::memory_order_acquire) == Capacity) return false;
+	items_[head & MASK] = item;
+	head_.store(head + 1, std::memory_order_release);
+	return true;
+      }
+
+      /**
+       * @brief Number of items (exact on consumer side).
+       */
+      size_t size() const {
+	return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+      }
+
+      bool empty() const { return size() == 0; }
+
+      /**
+       * @brief Consumer side. First n items (n is clamped to size()).
+       */
+      View peek(size_t n = (size_t)-1) const {
+	const size_t tail = tail_.load(std::memory_order_relaxed);
+	const size_t available = head_.load(std::memory_order_acquire) - tail;
+	return View(this, tail, n < available ? n : available);
+      }
+
+      /**
+       * @brief Consumer side. Release first n items (n <= size()).
+       */
+      void consume(const size_t n) {
+	tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+      }
+
+      bool pop(T& item) {
+	const size_t tail = tail_.load(std::memory_order_relaxed);
+	if (head_.load(std::memory_order_acquire) == tail) return false;
+	item = items_[tail & MASK];
+	tail_.store(tail + 1, std::memory_order_release);
+	return true;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,337 @@
+/********************************************************
+ * terminalscreen.h
+ *
+ * Double-buffered ANSI terminal renderer (Unix only).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#ifndef WIN32
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief Colors and attributes of a cell.
+     *
+     * Colors are 0 - 7 (BLACK - WHITE), 8 - 15 (bright), 16 - 254 (xterm 256 colors) or DEFAULT.
+     */
+    struct TerminalStyle {
+      const static uint8_t BLACK = 0;
+      const static uint8_t RED = 1;
+      const static uint8_t GREEN = 2;
+      const static uint8_t YELLOW = 3;
+      const static uint8_t BLUE = 4;
+      const static uint8_t MAGENTA = 5;
+      const static uint8_t CYAN = 6;
+      const static uint8_t WHITE = 7;
+      const static uint8_t DEFAULT = 255;
+
+      const static uint8_t BOLD = 0x01;
+      const static uint8_t UNDERLINE = 0x02;
+      const static uint8_t REVERSE = 0x04;
+
+      uint8_t fg;
+      uint8_t bg;
+      uint8_t attr;
+
+      TerminalStyle(const uint8_t fg_ = DEFAULT, const uint8_t bg_ = DEFAULT, const uint8_t attr_ = 0) : fg(fg_), bg(bg_), attr(attr_) {}
+
+      bool operator==(const TerminalStyle& s) const { return fg == s.fg && bg == s.bg && attr == s.attr; }
+      bool operator!=(const TerminalStyle& s) const { return !(*this == s); }
+    };
+
+    struct TerminalCell {
+      uint32_t ch;  ///< unicode code point (one column)
+      TerminalStyle style;
+
+      bool operator==(const TerminalCell& c) const { return ch == c.ch && style == c.style; }
+      bool operator!=(const TerminalCell& c) const { return !(*this == c); }
+    };
+
+
+    /***************************************************
+     * TerminalScreen
+     *
+     * @brief Draw into back buffer, present() only the difference.
+     *
+     * present() compares the back buffer with what the terminal shows
+     * (front buffer) and writes the changed cells as ANSI escape
+     * sequences with one write(). An unchanged frame costs no system call.
+     *
+     * The screen switches to the alternate screen and hides the cursor.
+     * Input terminal is set to non-canonical, no echo mode. Everything
+     * is restored by the destructor (use it instead of init_scr() /
+     * clear_scr() / exit_scr()).
+     *
+     * Usage:
+     *   TerminalScreen screen;
+     *   while (true) {
+     *     screen.clear();
+     *     screen.print(0, 0, "speed", TerminalStyle(TerminalStyle::GREEN));
+     *     screen.present();
+     *   }
+     ***************************************************/
+    class TerminalScreen {
+    private:
+      int fd_;
+      int inputFd_;
+      bool restoreTermios_;
+      struct termios oldTermios_;
+      int width_;
+      int height_;
+      std::vector<TerminalCell> back_;
+      std::vector<TerminalCell> front_;
+      std::string out_;
+      bool started_;
+      bool full_;
+      uint64_t frames_;
+      uint64_t bytes_;
+      uint64_t writes_;
+
+    public:
+      /**
+       * @param fd output terminal
+       * @param inputFd input terminal set to non-canonical, no echo mode. -1 to leave it.
+       * @param width, height size. 0 to ask the terminal (80 x 24 if it is not a terminal).
+       */
+      TerminalScreen(const int fd = 1, const int inputFd = 0, const int width = 0, const int height = 0) :
+	fd_(fd), inputFd_(inputFd), restoreTermios_(false), width_(0), height_(0), started_(false), full_(true), frames_(0), bytes_(0), writes_(0) {
+	if (inputFd_ >= 0 && isatty(inputFd_) && tcgetattr(inputFd_, &oldTermios_) == 0) {
+	  struct termios t = oldTermios_;
+	  t.c_lflag &= ~(ECHO | ICANON);
+	  t.c_cc[VMIN] = 0;
+	  t.c_cc[VTIME] = 0;
+	  restoreTermios_ = tcsetattr(inputFd_, TCSANOW, &t) == 0;
+	}
+	int w = width, h = height;
+	if (w <= 0 || h <= 0) querySize(w, h);
+	resize(w, h);
+      }
+
+      ~TerminalScreen() {
+	if (started_) {
+	  static const char restore[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+	  writeAll(restore, sizeof(restore) - 1);
+	}
+	if (restoreTermios_) tcsetattr(inputFd_, TCSANOW, &oldTermios_);
+      }
+
+    private:
+      TerminalScreen(const TerminalScreen&);
+      TerminalScreen& operator=(const TerminalScreen&);
+
+    public:
+      int getWidth() const { return width_; }
+      int getHeight() const { return height_; }
+
+      /**
+       * @brief Size of the output terminal (eg., after SIGWINCH). false if it is not a terminal.
+       */
+      bool querySize(int& width, int& height) const {
+	struct winsize ws;
+	if (ioctl(fd_, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+	  width = ws.ws_col;
+	  height = ws.ws_row;
+	  return true;
+	}
+	width = 80;
+	height = 24;
+	return false;
+      }
+
+      /**
+       * @brief Resize buffers. Back buffer is cleared and next present() redraws everything.
+       */
+      void resize(const int width, const int height) {
+	width_ = width;
+	height_ = height;
+	back_.assign((size_t)width_ * height_, blank(TerminalStyle()));
+	front_ = back_;
+	out_.reserve((size_t)width_ * height_ * 8 + 64);
+	full_ = true;
+      }
+
+      /**
+       * @brief Redraw everything at next present() (eg., terminal was disturbed by other output).
+       */
+      void invalidate() { full_ = true; }
+
+      void clear(const TerminalStyle& style = TerminalStyle()) {
+	const TerminalCell cell = blank(style);
+	for (size_t i = 0; i < back_.size(); i++) back_[i] = cell;
+      }
+
+      void put(const int x, const int y, const uint32_t ch, const TerminalStyle& style = TerminalStyle()) {
+	if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
+	TerminalCell& cell = back_[(size_t)y * width_ + x];
+	cell.ch = ch < 0x20 || ch == 0x7F ? (uint32_t)' ' : ch;
+	cell.style = style;
+      }
+
+      /**
+       * @brief Write UTF-8 text from (x, y) on one line. Clipped at the right edge.
+       * @return number of columns written.
+       */
+      int print(int x, const int y, const char* text, const TerminalStyle& style = TerminalStyle()) {
+	const int start = x;
+	const uint8_t* p = (const uint8_t*)text;
+	while (*p && x < width_) {
+	  uint32_t ch = *p++;
+	  int follow = ch >= 0xF0 ? 3 : (ch >= 0xE0 ? 2 : (ch >= 0xC0 ? 1 : 0));
+	  if (follow) ch &= 0x3F >> follow;
+	  for (; follow > 0 && (*p & 0xC0) == 0x80; follow--) ch = (ch << 6) | (*p++ & 0x3F);
+	  put(x++, y, ch, style);
+	}
+	return x - start;
+      }
+
+      const TerminalCell& at(const int x, const int y) const { return back_[(size_t)y * width_ + x]; }
+
+      /**
+       * @brief Write difference of back buffer from the terminal with one write().
+       * @return bytes written (0 if nothing changed), -1 on error.
+       */
+      int present() {
+	out_.clear();
+	if (!started_) {
+	  out_ += "\x1b[?1049h\x1b[?25l";
+	  started_ = true;
+	}
+	if (full_) {
+	  out_ += "\x1b[0m\x1b[2J";
+	  const TerminalCell cleared = blank(TerminalStyle());
+	  for (size_t i = 0; i < front_.size(); i++) front_[i] = cleared;
+	  full_ = false;
+	}
+
+	int cx = -1, cy = -1;
+	bool styled = false;
+	TerminalStyle current;
+	for (int y = 0; y < height_; y++) {
+	  const size_t row = (size_t)y * width_;
+	  for (int x = 0; x < width_; x++) {
+	    const TerminalCell& cell = back_[row + x];
+	    if (cell == front_[row + x]) continue;
+	    if (cy == y && x > cx && x - cx <= 4 && sameStyle(row + cx, row + x, current)) {
+	      for (int i = cx; i < x; i++) appendChar(back_[row + i].ch); // cheaper than moving cursor
+	    } else if (cx != x || cy != y) {
+	      char move[24];
+	      const int n = snprintf(move, sizeof(move), "\x1b[%d;%dH", y + 1, x + 1);
+	      out_.append(move, n);
+	    }
+	    if (!styled || cell.style != current) {
+	      appendStyle(cell.style);
+	      current = cell.style;
+	      styled = true;
+	    }
+	    appendChar(cell.ch);
+	    front_[row + x] = cell;
+	    cx = x + 1;
+	    cy = cx < width_ ? y : -1; // no assumption on pending wrap at the right edge
+	  }
+	}
+	if (out_.empty()) {
+	  frames_++;
+	  return 0;
+	}
+	if (!writeAll(out_.data(), out_.size())) return -1;
+	frames_++;
+	bytes_ += out_.size();
+	return (int)out_.size();
+      }
+
+      uint64_t getFrames() const { return frames_; }
+      uint64_t getBytesWritten() const { return bytes_; }
+
+      /**
+       * @brief Number of write() system calls.
+       */
+      uint64_t getWrites() const { return writes_; }
+
+    private:
+      static TerminalCell blank(const TerminalStyle& style) {
+	TerminalCell cell;
+	cell.ch = ' ';
+	cell.style = style;
+	return cell;
+      }
+
+      bool sameStyle(const size_t from, const size_t to, const TerminalStyle& style) const {
+	for (size_t i = from; i < to; i++) if (back_[i].style != style) return false;
+	return true;
+      }
+
+      void appendColor(const int base, const uint8_t color) {
+	char buf[16];
+	int n;
+	if (color == TerminalStyle::DEFAULT) n = snprintf(buf, sizeof(buf), ";%d", base + 9);
+	else if (color < 8) n = snprintf(buf, sizeof(buf), ";%d", base + color);
+	else if (color < 16) n = snprintf(buf, sizeof(buf), ";%d", base + 60 + color - 8);
+	else n = snprintf(buf, sizeof(buf), ";%d;5;%d", base + 8, color);
+	out_.append(buf, n);
+      }
+
+      void appendStyle(const TerminalStyle& style) {
+	out_ += "\x1b[0";
+	if (style.attr & TerminalStyle::BOLD) out_ += ";1";
+	if (style.attr & TerminalStyle::UNDERLINE) out_ += ";4";
+	if (style.attr & TerminalStyle::REVERSE) out_ += ";7";
+	if (style.fg != TerminalStyle::DEFAULT) appendColor(30, style.fg);
+	if (style.bg != TerminalStyle::DEFAULT) appendColor(40, style.bg);
+	out_ += 'm';
+      }
+
+      void appendChar(const uint32_t ch) {
+	if (ch < 0x80) {
+	  out_ += (char)ch;
+	} else if (ch < 0x800) {
+	  out_ += (char)(0xC0 | (ch >> 6));
+	  out_ += (char)(0x80 | (ch & 0x3F));
+	} else if (ch < 0x10000) {
+	  out_ += (char)(0xE0 | (ch >> 12));
+	  out_ += (char)(0x80 | ((ch >> 6) & 0x3F));
+	  out_ += (char)(0x80 | (ch & 0x3F));
+	} else {
+	  out_ += (char)(0xF0 | (ch >> 18));
+	  out_ += (char)(0x80 | ((ch >> 12) & 0x3F));
+	  out_ += (char)(0x80 | ((ch >> 6) & 0x3F));
+	  out_ += (char)(0x80 | (ch & 0x3F));
+	}
+      }
+
+      /**
+       * @brief One write() unless the terminal takes it partially.
+       */
+      bool writeAll(const char* data, size_t size) {
+	while (size > 0) {
+	  const ssize_t n = ::write(fd_, data, size);
+	  writes_++;
+	  if (n < 0) {
+	    if (errno == EINTR || errno == EAGAIN) continue;
+	    return false;
+	  }
+	  data += n;
+	  size -= n;
+	}
+	return true;
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifndef WIN32
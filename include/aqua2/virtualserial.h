@@ -0,0 +1,104 @@
+/********************************************************
+ * virtualserial.h
+ *
+ * Virtual serial device built on pseudo terminal (Unix only).
+ * Link with libutil on Linux (openpty).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <string>
+
+#include "serialport.h"
+
+#ifndef WIN32
+#ifdef __linux__
+#include <pty.h>
+#else // OSX
+#include <util.h>
+#endif
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * VirtualSerialPair
+     *
+     * @brief Two connected SerialPort endpoints for testing without hardware.
+     *
+     * Bytes written to first() are read from second() and vice versa.
+     * first() wraps the master side of pseudo terminal, second() opens
+     * the slave device file (name()) like a real serial port, so any code
+     * which takes a device filename can be pointed to name().
+     *
+     * Usage:
+     *   VirtualSerialPair pair(115200);
+     *   pair.first().write("hello", 5);
+     *   pair.second().read(buf, 5, 1.0);
+     ***************************************************/
+    class VirtualSerialPair {
+    private:
+      int slave_;
+      std::string name_;
+      SerialPort* first_;
+      SerialPort* second_;
+
+    public:
+      VirtualSerialPair(int baudrate=115200, int parity=SerialPort::NO_PARITY, int stopbits=SerialPort::ONE_STOPBIT) : slave_(-1), first_(nullptr), second_(nullptr) {
+	int master;
+	char name[256];
+	if (openpty(&master, &slave_, name, NULL, NULL) < 0) {
+	  throw ComOpenException();
+	}
+	name_ = name;
+	/// Slave is kept opened in raw mode so that the data is not echoed back
+	/// and the pty is not hung up while second() is closed.
+	struct termios tio;
+	tcgetattr(slave_, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave_, TCSANOW, &tio);
+	try {
+	  first_ = new SerialPort(master, name_.c_str(), baudrate, parity, stopbits);
+	  second_ = new SerialPort(name_.c_str(), baudrate, parity, stopbits);
+	} catch (ComException& ex) {
+	  if (!first_) ::close(master);
+	  delete first_;
+	  ::close(slave_);
+	  throw;
+	}
+      }
+
+      ~VirtualSerialPair() {
+	delete second_;
+	delete first_;
+	::close(slave_);
+      }
+
+    private:
+      VirtualSerialPair(const VirtualSerialPair&);
+      VirtualSerialPair& operator=(const VirtualSerialPair&);
+
+    public:
+      /**
+       * @brief Master side endpoint.
+       */
+      SerialPort& first() { return *first_; }
+
+      /**
+       * @brief Slave side endpoint, opened from name().
+       */
+      SerialPort& second() { return *second_; }
+
+      /**
+       * @brief Device filename of slave side (eg., "/dev/pts/3").
+       */
+      const char* name() const { return name_.c_str(); }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifndef WIN32
@@ -0,0 +1,274 @@
+/********************************************************
+ * waitstrategy.h
+ *
+ * Spin-then-park wait for input of SerialPort and Socket
+ * (Unix only).
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#ifndef WIN32
+
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <atomic>
+#include <chrono>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "histogram.h"
+
+namespace ssr {
+  namespace aqua2 {
+
+    /**
+     * @brief Hint to the CPU in spin loops (pause / yield instruction).
+     */
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      __asm__ __volatile__("yield");
+#endif
+    }
+
+    /**
+     * @brief Copy of WaitStrategy statistics.
+     */
+    struct WaitStatistics {
+      uint64_t waits;
+      uint64_t spun;       ///< satisfied while spinning (no sleep)
+      uint64_t parked;     ///< slept in poll()
+      uint64_t timeouts;
+      uint64_t errors;     ///< hang up or error of the file descriptor
+      LatencyHistogramSnapshot spinWait;  ///< time waited, of the waits satisfied while spinning [ns]
+      LatencyHistogramSnapshot parkWait;  ///< time waited, of the waits which slept [ns]
+    };
+
+
+    /***************************************************
+     * WaitStrategy
+     *
+     * @brief Waits until a file descriptor has some bytes: spin first, then sleep in poll().
+     *
+     * Spinning (checking FIONREAD with a pause instruction between)
+     * notices input within a microsecond but keeps a CPU busy; poll()
+     * frees the CPU but costs the kernel wake up latency (several to tens
+     * of usec, more without SCHED_FIFO). The spin time picks the trade:
+     *   - 0 (default)     : sleep at once
+     *   - N nanoseconds   : spin N, then sleep (input expected soon, eg., reply of a servo bus)
+     *   - SPIN_FOREVER    : never sleep (a dedicated, pinned CPU)
+     *
+     * Optionally the waiting thread is pinned to a CPU at its first wait.
+     * One strategy can be shared by several ports of one thread; the
+     * statistics are updated without lock by one thread at a time.
+     *
+     * Usage:
+     *   WaitStrategy strategy(20000);   // spin 20 usec, then poll()
+     *   strategy.setCpuAffinity(3);
+     *   port.setWaitStrategy(&strategy);
+     *   port.read(buf, 8, 0.01);
+     *   std::cout << strategy.snapshot().spun << std::endl;
+     ***************************************************/
+    class WaitStrategy {
+    public:
+      const static uint64_t SPIN_FOREVER = UINT64_MAX;
+
+      const static int READY = 1;
+      const static int TIMEOUT = 0;
+      const static int FAILED = -1;
+
+    private:
+      const static int CHECK_INTERVAL = 256;  ///< spins between timeout / hang up checks
+      const static long PARTIAL_SLEEP = 20000; ///< nanoseconds to sleep while fewer bytes than requested are there
+
+      uint64_t spinTime_;
+      int cpu_;
+      std::atomic<uint64_t> waits_;
+      std::atomic<uint64_t> spun_;
+      std::atomic<uint64_t> parked_;
+      std::atomic<uint64_t> timeouts_;
+      std::atomic<uint64_t> errors_;
+      LatencyHistogram spinWait_;
+      LatencyHistogram parkWait_;
+
+    public:
+      /**
+       * @param spinTime nanoseconds to spin before sleeping, or SPIN_FOREVER.
+       * @param cpu CPU to pin the waiting thread to, -1 to leave it.
+       */
+      WaitStrategy(const uint64_t spinTime = 0, const int cpu = -1) : spinTime_(spinTime), cpu_(cpu) {
+	reset();
+      }
+
+    private:
+      WaitStrategy(const WaitStrategy&);
+      WaitStrategy& operator=(const WaitStrategy&);
+
+    public:
+      static uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+
+      void setSpinTime(const uint64_t spinTime) { spinTime_ = spinTime; }
+
+      uint64_t getSpinTime() const { return spinTime_; }
+
+      /**
+       * @brief Pin threads waiting with this strategy to cpu (Linux). -1 to leave them.
+       */
+      void setCpuAffinity(const int cpu) { cpu_ = cpu; }
+
+      int getCpuAffinity() const { return cpu_; }
+
+      /**
+       * @brief Wait until fd has bytes or more to read.
+       * @param timeout seconds. 0 or less waits for ever.
+       * @return READY, TIMEOUT, or FAILED (hang up, closed or error).
+       */
+      int wait(const int fd, const uint32_t bytes, const double timeout = 0.0) {
+	pin();
+	relaxedIncrement(waits_);
+	const uint64_t start = now();
+	const uint64_t deadline = timeout > 0.0 ? start + (uint64_t)(timeout * 1e9) : UINT64_MAX;
+	const uint64_t spinEnd = spinTime_ == SPIN_FOREVER ? UINT64_MAX : start + spinTime_;
+
+	/// spin
+	for (int i = 1; ; i++) {
+	  const int r = check(fd, bytes);
+	  if (r == READY) relaxedIncrement(spun_);
+	  if (r != 0) return finish(r, start, spinWait_);
+	  if (i % CHECK_INTERVAL == 0) {
+	    const uint64_t t = now();
+	    if (t >= deadline) return finish(TIMEOUT, start, spinWait_);
+	    if (t >= spinEnd) break;
+	    if (hungUp(fd, 0)) return finish(FAILED, start, spinWait_);
+	  } else if (spinTime_ == 0) {
+	    break;
+	  }
+	  cpuRelax();
+	}
+
+	/// park
+	relaxedIncrement(parked_);
+	for (;;) {
+	  const uint64_t t = now();
+	  if (t >= deadline) return finish(TIMEOUT, start, parkWait_);
+	  if (partial(fd)) {
+	    /// poll() does not wait for more bytes than the ones already there
+	    if (hungUp(fd, 0)) return finish(check(fd, bytes) == READY ? READY : FAILED, start, parkWait_);
+	    const struct timespec ts = {0, PARTIAL_SLEEP};
+	    nanosleep(&ts, NULL);
+	  } else {
+	    const int msec = deadline == UINT64_MAX ? -1 : (int)((deadline - t + 999999) / 1000000);
+	    if (hungUp(fd, msec)) return finish(check(fd, bytes) == READY ? READY : FAILED, start, parkWait_);
+	  }
+	  const int r = check(fd, bytes);
+	  if (r != 0) return finish(r, start, parkWait_);
+	}
+      }
+
+      void reset() {
+	waits_.store(0, std::memory_order_relaxed);
+	spun_.store(0, std::memory_order_relaxed);
+	parked_.store(0, std::memory_order_relaxed);
+	timeouts_.store(0, std::memory_order_relaxed);
+	errors_.store(0, std::memory_order_relaxed);
+	spinWait_.reset();
+	parkWait_.reset();
+      }
+
+      WaitStatistics snapshot() const {
+	WaitStatistics s;
+	s.waits = waits_.load(std::memory_order_relaxed);
+	s.spun = spun_.load(std::memory_order_relaxed);
+	s.parked = parked_.load(std::memory_order_relaxed);
+	s.timeouts = timeouts_.load(std::memory_order_relaxed);
+	s.errors = errors_.load(std::memory_order_relaxed);
+	s.spinWait = spinWait_.snapshot();
+	s.parkWait = parkWait_.snapshot();
+	return s;
+      }
+
+    private:
+      /**
+       * @return READY, 0 (not yet) or FAILED.
+       */
+      static int check(const int fd, const uint32_t bytes) {
+	int n = 0;
+	if (ioctl(fd, FIONREAD, &n) != 0) return FAILED;
+	return n >= (int)bytes && n > 0 ? READY : 0;
+      }
+
+      static bool partial(const int fd) {
+	int n = 0;
+	return ioctl(fd, FIONREAD, &n) == 0 && n > 0;
+      }
+
+      /**
+       * @brief poll() for input. true if fd is hung up or in error (eg., peer closed a socket).
+       *
+       * A socket whose peer shut down writing is hung up even with bytes
+       * left to read: no more bytes will come to complete a partial wait.
+       */
+      static bool hungUp(const int fd, const int msec) {
+	struct pollfd pfd;
+	pfd.fd = fd;
+#ifdef POLLRDHUP
+	pfd.events = POLLIN | POLLRDHUP;
+#else
+	pfd.events = POLLIN;
+#endif
+	pfd.revents = 0;
+	const int r = ::poll(&pfd, 1, msec);
+	if (r < 0) return errno != EINTR;
+	if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) return true;
+#ifdef POLLRDHUP
+	if (pfd.revents & POLLRDHUP) return true;
+#endif
+	if (pfd.revents & POLLIN) {
+	  int n = 0;
+	  return ioctl(fd, FIONREAD, &n) != 0 || n == 0; // readable with nothing to read: end of stream
+	}
+	return false;
+      }
+
+      int finish(const int result, const uint64_t start, LatencyHistogram& histogram) {
+	if (result == READY) histogram.add(now() - start);
+	else if (result == TIMEOUT) relaxedIncrement(timeouts_);
+	else relaxedIncrement(errors_);
+	return result;
+      }
+
+      void pin() {
+#ifdef __linux__
+	static thread_local int pinned = -1;
+	if (cpu_ < 0 || pinned == cpu_) return;
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu_, &cpus);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0) pinned = cpu_;
+#endif
+      }
+    };
+
+    /**
+     * @brief Strategy used when none is set (sleep in poll() at once). One per thread.
+     */
+    inline WaitStrategy& defaultWaitStrategy() {
+      static thread_local WaitStrategy strategy;
+      return strategy;
+    }
+
+  }; //namespace aqua2
+};//namespace ssr
+
+#endif // ifndef WIN32
@@ -0,0 +1,192 @@
+/********************************************************
+ * workstealingpool.h
+ *
+ * Thread pool with per-thread task deques and stealing.
+ *
+ * @author ysuga (Sugar Sweet Robotics Co., LTD.
+ * @date 2026/10/18
+ ********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "alignednew.h"
+
+namespace ssr {
+  namespace aqua2 {
+
+    /***************************************************
+     * WorkStealingPool
+     *
+     * @brief Runs tasks on a fixed number of threads which steal from each other.
+     *
+     * Each thread has its own deque. submit() from a pool thread pushes to
+     * its own deque (run last in first out, cache warm), from any other
+     * thread to the deques in turn. An idle thread takes the oldest task of
+     * another deque, so a thread busy with a long task does not hold back
+     * the ones queued behind it. Idle threads sleep; submit() makes a
+     * system call only when some thread sleeps.
+     *
+     * An exception thrown by a task is caught and counted. The destructor
+     * runs the tasks left and joins the threads.
+     *
+     * Usage:
+     *   WorkStealingPool pool;  // one thread per CPU
+     *   pool.submit([]() { ... });
+     ***************************************************/
+    class WorkStealingPool {
+    public:
+      typedef std::function<void()> Task;
+
+    private:
+      /// one cache line each, also on the heap (AlignedNew)
+      struct alignas(64) Worker : public AlignedNew<Worker> {
+	std::mutex mutex;
+	std::deque<Task> tasks;
+      };
+
+      std::vector<Worker*> workers_;
+      std::vector<std::thread> threads_;
+      std::atomic<uint64_t> pending_;
+      std::atomic<uint32_t> sleepers_;
+      std::atomic<bool> stopping_;
+      std::atomic<uint32_t> next_;
+      std::mutex sleepMutex_;
+      std::condition_variable sleep_;
+      std::atomic<uint64_t> executed_;
+      std::atomic<uint64_t> steals_;
+      std::atomic<uint64_t> exceptions_;
+
+      struct Current {
+	const WorkStealingPool* pool;
+	int index;
+      };
+
+      static Current& current() {
+	static thread_local Current c = {nullptr, -1};
+	return c;
+      }
+
+    public:
+      /**
+       * @param threads number of threads. 0 for one per CPU.
+       */
+      WorkStealingPool(const int threads = 0) : pending_(0), sleepers_(0), stopping_(false), next_(0), executed_(0), steals_(0), exceptions_(0) {
+	int n = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+	if (n <= 0) n = 1;
+	for (int i = 0; i < n; i++) workers_.push_back(new Worker());
+	for (int i = 0; i < n; i++) threads_.push_back(std::thread(&WorkStealingPool::run, this, i));
+      }
+
+      ~WorkStealingPool() {
+	{
+	  std::lock_guard<std::mutex> lock(sleepMutex_);
+	  stopping_ = true;
+	}
+	sleep_.notify_all();
+	for (size_t i = 0; i < threads_.size(); i++) threads_[i].join();
+	for (size_t i = 0; i < workers_.size(); i++) delete workers_[i];
+      }
+
+    private:
+      WorkStealingPool(const WorkStealingPool&);
+      WorkStealingPool& operator=(const WorkStealingPool&);
+
+    public:
+      int getThreads() const { return (int)threads_.size(); }
+
+      /**
+       * @brief Index of the pool thread calling this, -1 from other threads.
+       */
+      int getCurrentThread() const {
+	return current().pool == this ? current().index : -1;
+      }
+
+      void submit(const Task& task) {
+	int i = getCurrentThread();
+	if (i < 0) i = next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+	pending_.fetch_add(1, std::memory_order_seq_cst); // before push, never below the tasks in deques
+	{
+	  std::lock_guard<std::mutex> lock(workers_[i]->mutex);
+	  workers_[i]->tasks.push_back(task);
+	}
+	if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+	  std::lock_guard<std::mutex> lock(sleepMutex_);
+	  sleep_.notify_one();
+	}
+      }
+
+      /**
+       * @brief Tasks submitted and not started yet.
+       */
+      uint64_t getPendingTasks() const { return pending_.load(std::memory_order_relaxed); }
+
+      uint64_t getExecutedTasks() const { return executed_.load(std::memory_order_relaxed); }
+
+      /**
+       * @brief Tasks run by another thread than the one whose deque they were in.
+       */
+      uint64_t getSteals() const { return steals_.load(std::memory_order_relaxed); }
+
+      uint64_t getExceptions() const { return exceptions_.load(std::memory_order_relaxed); }
+
+    private:
+      bool take(const int self, Task& task) {
+	{
+	  Worker& w = *workers_[self];
+	  std::lock_guard<std::mutex> lock(w.mutex);
+	  if (!w.tasks.empty()) {
+	    task.swap(w.tasks.back());
+	    w.tasks.pop_back();
+	    return true;
+	  }
+	}
+	const int n = (int)workers_.size();
+	for (int k = 1; k < n; k++) {
+	  Worker& w = *workers_[(self + k) % n];
+	  std::lock_guard<std::mutex> lock(w.mutex);
+	  if (!w.tasks.empty()) {
+	    task.swap(w.tasks.front());
+	    w.tasks.pop_front();
+	    steals_.fetch_add(1, std::memory_order_relaxed);
+	    return true;
+	  }
+	}
+	return false;
+      }
+
+      void run(const int self) {
+	current().pool = this;
+	current().index = self;
+	Task task;
+	for (;;) {
+	  if (pending_.load(std::memory_order_acquire) > 0 && take(self, task)) {
+	    pending_.fetch_sub(1, std::memory_order_relaxed);
+	    try {
+	      task();
+	    } catch (...) {
+	      exceptions_.fetch_add(1, std::memory_order_relaxed);
+	    }
+	    task = Task();
+	    executed_.fetch_add(1, std::memory_order_relaxed);
+	    continue;
+	  }
+	  std::unique_lock<std::mutex> lock(sleepMutex_);
+	  sleepers_.fetch_add(1, std::memory_order_seq_cst);
+	  while (pending_.load(std::memory_order_seq_cst) == 0 && !stopping_) sleep_.wait(lock);
+	  sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+	  if (stopping_ && pending_.load(std::memory_order_seq_cst) == 0) return;
+	}
+      }
+    };
+
+  }; //namespace aqua2
+};//namespace ssr
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cmath>
+
+#include "aqua2/gamepad.h"
+
+using namespace ssr::aqua2;
+
+static bool near(const float a, const float b) { return std::fabs(a - b) < 1e-4f; }
+
+int main(void) {
+  std::cout << "libaqua2 / AxisConditioner test" << std::endl;
+
+  AxisConditioner c;
+  float in[4], out[4];
+
+  /// calibration: measured -0.8 / 0.1 / 0.9
+  c.setCalibration(2, -0.8f, 0.1f, 0.9f);
+  in[0] = 0.5f; in[1] = -0.5f; in[2] = 0.5f; in[3] = -0.8f;
+  c.process(in, out, 4, 0.0f);
+  if (!near(out[0], 0.5f) || !near(out[1], -0.5f) || !near(out[2], 0.5f)) {
+    std::cout << "calibration failed " << out[2] << std::endl;
+    return(1);
+  }
+  c.setCalibration(2, -1.0f, 0.0f, 1.0f);
+
+  /// axial deadzone 0.2 with saturation 0.8, expo 1 (cubic)
+  c.setDeadzone(0, 0.2f, 0.8f);
+  c.setExpo(1, 1.0f);
+  in[0] = 0.5f; in[1] = -0.5f;
+  c.process(in, out, 4, 0.0f);
+  if (!near(out[0], 0.5f) || !near(out[1], -0.125f)) {
+    std::cout << "deadzone / expo failed " << out[0] << " " << out[1] << std::endl;
+    return(1);
+  }
+  in[0] = 0.1f;
+  c.process(in, out, 4, 0.0f);
+  if (out[0] != 0.0f) return(1);
+  c.setDeadzone(0, 0.0f);
+  c.setExpo(1, 0.0f);
+
+  /// radial deadzone keeps direction
+  c.setRadialDeadzone(2, 3, 0.5f);
+  in[2] = 0.3f; in[3] = 0.3f;
+  c.process(in, out, 4, 0.0f);
+  if (out[2] != 0.0f || out[3] != 0.0f) {
+    std::cout << "radial deadzone failed" << std::endl;
+    return(1);
+  }
+  in[2] = 0.6f; in[3] = 0.8f; // length 1.0
+  c.process(in, out, 4, 0.0f);
+  if (!near(out[2], 0.6f) || !near(out[3], 0.8f)) {
+    std::cout << "radial saturation failed" << std::endl;
+    return(1);
+  }
+
+  /// EMA and one-euro
+  c.setEma(0, 0.5f);
+  c.setOneEuro(1, 1.0f, 0.0f);
+  in[0] = 0.0f; in[1] = 0.0f;
+  c.process(in, out, 4, 0.0f);
+  in[0] = 1.0f; in[1] = 1.0f;
+  c.process(in, out, 4, 0.01f);
+  const float euro = 6.2831853f * 0.01f / (1.0f + 6.2831853f * 0.01f);
+  if (!near(out[0], 0.5f) || !near(out[1], euro)) {
+    std::cout << "filter failed " << out[0] << " " << out[1] << std::endl;
+    return(1);
+  }
+  c.setOneEuro(1, 1.0f, 10.0f);
+  c.process(in, out, 4, 0.0f);
+  in[1] = 0.0f;
+  c.process(in, out, 4, 0.01f);
+  if (!(out[1] < 1.0f - euro)) {
+    std::cout << "one-euro does not follow fast motion" << std::endl;
+    return(1);
+  }
+
+  /// in GamePad
+  int fds[2];
+  if (pipe(fds) != 0) return(1);
+  GamePad pad(fds[0], 2, 1);
+  AxisConditioner conditioner;
+  conditioner.setDeadzone(0, 0.1f);
+  pad.setAxisConditioner(&conditioner);
+  js_event e;
+  e.time = 0;
+  e.type = JS_EVENT_AXIS;
+  e.number = 0;
+  e.value = 3000;
+  if (write(fds[1], &e, sizeof(e)) != sizeof(e)) return(1);
+  pad.update();
+  if (pad.axis[0] != 0.0f || pad.state().axes[0] != 0.0f || !near(pad.events()[0].value, 3000 / 32767.0f)) {
+    std::cout << "GamePad conditioning failed" << std::endl;
+    return(1);
+  }
+  close(fds[1]);
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "aqua2/serialport.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+/// Counting allocator
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+static const int CYCLES = 1000;
+
+/// Allocations of the former std::vector backed ByteBuffer per read/write
+static size_t vectorCycle(const SerialPort& a, const SerialPort& b) {
+  size_t before = allocations;
+  std::vector<uint8_t> src(32, 0x5A);
+  a.write(&src.front(), src.size());
+  std::vector<uint8_t> dst(32);
+  b.read(&dst.front(), dst.size());
+  return allocations - before;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / ByteBuffer test" << std::endl;
+
+  ByteBuffer buffer((size_t)100);
+  for (size_t i = 0; i < buffer.size(); i++) buffer[i] = (uint8_t)i;
+  ByteView view = buffer.slice(10, 20);
+  if (view.size() != 20 || view[0] != 10 || view.slice(15).size() != 5 || view.slice(30).size() != 0) {
+    std::cout << "slice failed" << std::endl;
+    return(1);
+  }
+  ByteBuffer copied(buffer);
+  ByteBuffer moved(std::move(copied));
+  if (moved.size() != 100 || moved[99] != 99 || copied.size() != 0) {
+    std::cout << "copy/move failed" << std::endl;
+    return(1);
+  }
+
+  VirtualSerialPair pair(115200);
+  const SerialPort& a = pair.first();
+  SerialPort& b = pair.second();
+
+  size_t vectorAllocations = 0;
+  for (int i = 0; i < CYCLES; i++) {
+    vectorAllocations += vectorCycle(a, b);
+  }
+
+  ByteBuffer src((size_t)32);
+  for (size_t i = 0; i < src.size(); i++) src[i] = (uint8_t)i;
+  ByteBuffer dst((size_t)32);
+
+  /// warm up pool
+  write(a, src);
+  b.waitAvailable(32, 1.0);
+  read(b, 32);
+
+  size_t before = allocations;
+  for (int i = 0; i < CYCLES; i++) {
+    write(a, src.slice(0, 16));
+    write(a, src.slice(16));
+    b.waitAvailable(32, 1.0);
+    if (i % 2 == 0) {
+      if (!read(b, dst) || dst[31] != 31) {
+	std::cout << "read into buffer failed" << std::endl;
+	return(1);
+      }
+    } else {
+      ByteBuffer pooled = read(b, 32);
+      if (!pooled.available() || pooled[31] != 31) {
+	std::cout << "pooled read failed" << std::endl;
+	return(1);
+      }
+    }
+  }
+  size_t pooledAllocations = allocations - before;
+
+  std::cout << "allocations per cycle: vector " << (double)vectorAllocations / CYCLES
+	    << ", pooled " << (double)pooledAllocations / CYCLES << std::endl;
+  if (pooledAllocations != 0) {
+    std::cout << "heap allocation in steady state" << std::endl;
+    return(1);
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
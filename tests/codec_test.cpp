@@ -0,0 +1,84 @@
+#include <iostream>
+#include <cstring>
+
+#include "aqua2/codec.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+enum Mode : uint8_t { IDLE = 0, POSITION = 3 };
+
+struct ServoCommand {
+  uint8_t id;
+  Mode mode;
+  int16_t position;
+  uint32_t timestamp;
+  float speed;
+  uint16_t gains[3];
+};
+
+typedef MessageCodec<ServoCommand,
+		     MessageConstant<uint16_t, 0xFFFD, BigEndian>,
+		     AQUA2_FIELD(ServoCommand, id),
+		     AQUA2_FIELD(ServoCommand, mode),
+		     AQUA2_FIELD_BE(ServoCommand, position),
+		     AQUA2_FIELD(ServoCommand, timestamp),
+		     MessagePadding<1>,
+		     AQUA2_FIELD(ServoCommand, speed),
+		     AQUA2_FIELD_BE(ServoCommand, gains)> ServoCommandCodec;
+typedef CheckedCodec<ServoCommandCodec, Crc16Modbus> ServoCommandFrame;
+
+static_assert(ServoCommandCodec::SIZE == 2 + 1 + 1 + 2 + 4 + 1 + 4 + 6, "size");
+static_assert(ServoCommandCodec::offset<3>() == 4, "offset of position");
+static_assert(ServoCommandCodec::offset<6>() == 11, "offset of speed");
+static_assert(ServoCommandFrame::SIZE == ServoCommandCodec::SIZE + 2, "size with crc");
+
+int main(void) {
+  std::cout << "libaqua2 / MessageCodec test" << std::endl;
+
+  ServoCommand command = {7, POSITION, -2, 0x01020304, 1.5f, {1, 2, 0x0304}};
+  uint8_t buf[ServoCommandFrame::SIZE];
+  ServoCommandFrame::encode(command, buf);
+
+  const uint8_t expected[] = {0xFF, 0xFD, 7, 3, 0xFF, 0xFE, 0x04, 0x03, 0x02, 0x01, 0x00,
+			      0x00, 0x00, 0xC0, 0x3F, 0x00, 0x01, 0x00, 0x02, 0x03, 0x04};
+  if (memcmp(buf, expected, sizeof(expected)) != 0) {
+    std::cout << "unexpected encoding" << std::endl;
+    return(1);
+  }
+
+  /// CRC-16/MODBUS of "123456789" is 0x4B37, CRC-32 is 0xCBF43926
+  if (Crc16Modbus::compute((const uint8_t*)"123456789", 9) != 0x4B37 ||
+      Crc32::compute((const uint8_t*)"123456789", 9) != 0xCBF43926) {
+    std::cout << "wrong crc" << std::endl;
+    return(1);
+  }
+
+  ServoCommand decoded;
+  memset(&decoded, 0, sizeof(decoded));
+  if (!ServoCommandFrame::decode(ByteView(buf, sizeof(buf)), decoded) ||
+      decoded.id != 7 || decoded.mode != POSITION || decoded.position != -2 || decoded.timestamp != 0x01020304 ||
+      decoded.speed != 1.5f || decoded.gains[2] != 0x0304) {
+    std::cout << "round trip failed" << std::endl;
+    return(1);
+  }
+
+  buf[5] ^= 0x10;
+  if (ServoCommandFrame::decode(ByteView(buf, sizeof(buf)), decoded) ||
+      ServoCommandFrame::decode(ByteView(buf, sizeof(buf) - 1), decoded)) {
+    std::cout << "corrupted frame accepted" << std::endl;
+    return(1);
+  }
+
+  VirtualSerialPair pair(115200);
+  writeMessage<ServoCommandFrame>(pair.first(), command);
+  uint8_t received[ServoCommandFrame::SIZE];
+  if (pair.second().read(received, sizeof(received), 1.0) != (int)sizeof(received) ||
+      !ServoCommandFrame::decode(ByteView(received, sizeof(received)), decoded) || decoded.position != -2) {
+    std::cout << "writeMessage failed" << std::endl;
+    return(1);
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
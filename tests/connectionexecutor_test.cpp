@@ -0,0 +1,124 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <stdexcept>
+
+#include "aqua2/connectionexecutor.h"
+
+using namespace ssr::aqua2;
+
+static bool waitFor(const std::function<bool()>& condition) {
+  for (int i = 0; i < 2000 && !condition(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return condition();
+}
+
+int main(void) {
+  std::cout << "libaqua2 / ConnectionExecutor test" << std::endl;
+
+  {
+    /// tasks run, a busy thread's queue is stolen, exceptions are counted
+    WorkStealingPool pool(2);
+    if (pool.getThreads() != 2 || pool.getCurrentThread() != -1) return(1);
+    std::atomic<int> sum(0);
+    std::atomic<int> nested(-2);
+    std::atomic<bool> started(false);
+    pool.submit([&]() {
+	started = true;
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      });
+    if (!waitFor([&]() { return started.load(); })) return(1);
+    for (int i = 1; i <= 20; i++) pool.submit([&sum, i]() { sum += i; });
+    pool.submit([&]() {
+	const int self = pool.getCurrentThread();
+	pool.submit([&, self]() { nested = pool.getCurrentThread() >= 0 ? self : -1; });
+      });
+    pool.submit([]() { throw std::runtime_error("task failed"); });
+    if (!waitFor([&]() { return pool.getExecutedTasks() == 24; })) {
+      std::cout << "tasks not executed" << std::endl;
+      return(1);
+    }
+    if (sum != 210 || nested < 0 || pool.getSteals() == 0 || pool.getExceptions() != 1 || pool.getPendingTasks() != 0) {
+      std::cout << "pool failed" << std::endl;
+      return(1);
+    }
+  }
+
+  ServerSocket server;
+  server.bind(0);
+  server.listen(16);
+  WorkStealingPool pool(3);
+  std::atomic<int> closed(0);
+  ConnectionExecutor executor(server, pool, [&](Socket& socket) {
+      static thread_local char buf[256];
+      const int n = socket.read(buf, sizeof(buf));
+      if (n <= 0) {
+	closed++;
+	return false;
+      }
+      if (n == 1 && buf[0] == '!') throw std::runtime_error("bad request");
+      return socket.tryWrite(buf, n).valueOr(0) == n;
+    });
+  executor.start();
+
+  /// echo on several clients at once
+  const int CLIENTS = 8;
+  const int MESSAGES = 50;
+  std::vector<std::thread> clients;
+  std::atomic<int> failed(0);
+  for (int c = 0; c < CLIENTS; c++) {
+    clients.push_back(std::thread([&, c]() {
+	  Socket client("127.0.0.1", server.getPort());
+	  for (int m = 0; m < MESSAGES; m++) {
+	    const int sent = c * 1000 + m;
+	    int echoed = -1;
+	    client.write(&sent, sizeof(sent));
+	    for (int n = 0; n < (int)sizeof(echoed); ) {
+	      const int r = client.read((char*)&echoed + n, sizeof(echoed) - n);
+	      if (r <= 0) break;
+	      n += r;
+	    }
+	    if (echoed != sent) failed++;
+	  }
+	  client.close();
+	}));
+  }
+  for (size_t i = 0; i < clients.size(); i++) clients[i].join();
+  if (failed != 0 || executor.getAccepted() != CLIENTS) {
+    std::cout << "echo failed" << std::endl;
+    return(1);
+  }
+
+  /// peer close: handler reads 0 and the connection is closed
+  if (!waitFor([&]() { return executor.getConnections() == 0; }) || closed != CLIENTS) {
+    std::cout << "close failed" << std::endl;
+    return(1);
+  }
+  if (executor.getDispatched() < (uint64_t)CLIENTS * MESSAGES) return(1);
+
+  /// handler throwing something else than SocketException: the connection is closed
+  {
+    Socket bad("127.0.0.1", server.getPort());
+    bad.write("!", 1);
+    char c;
+    if (bad.read(&c, 1, 2.0) == 1 || !waitFor([&]() { return executor.getConnections() == 0; })) {
+      std::cout << "throwing handler did not close" << std::endl;
+      return(1);
+    }
+    bad.close();
+  }
+
+  /// stop() closes the open connections
+  Socket idle("127.0.0.1", server.getPort());
+  if (!waitFor([&]() { return executor.getConnections() == 1; })) return(1);
+  executor.stop();
+  if (executor.isRunning() || executor.getConnections() != 0) return(1);
+  char c;
+  if (idle.read(&c, 1) != 0) return(1);
+  idle.close();
+  server.close();
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "aqua2/controlloop.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+int main(void) {
+  std::cout << "libaqua2 / ControlLoop test" << std::endl;
+
+  /// stages run in phase order, every period
+  int padPipe[2];
+  if (pipe(padPipe) != 0) return(1);
+  GamePad pad(padPipe[0], 2, 2);
+  VirtualSerialPair serial(115200);
+
+  ControlLoop loop(1000);
+  if (loop.getPeriod() != 1000000) return(1);
+  std::string order;
+  std::string received;
+  int cycle = 0;
+  loop.addStage(ControlLoop::WRITE, [&]() {
+      order += 'w';
+      if (++cycle == 10) serial.second().write("ping", 4);
+    });
+  loop.addStage(ControlLoop::COMPUTE, [&]() { order += 'c'; });
+  loop.addGamePad(pad);
+  loop.addSerialPort(serial.first(), [&](const uint8_t* data, int size) { received.append((const char*)data, size); });
+  loop.addStage(ControlLoop::READ, [&]() { order += 'r'; });
+
+  js_event e;
+  e.time = 0;
+  e.type = JS_EVENT_AXIS;
+  e.number = 1;
+  e.value = 32767;
+  if (write(padPipe[1], &e, sizeof(e)) != sizeof(e)) return(1);
+
+  const uint64_t start = ControlLoop::now();
+  loop.run(200);
+  const uint64_t elapsed = ControlLoop::now() - start;
+  ControlLoopSnapshot s = loop.snapshot();
+  if (s.cycles != 200 || order.substr(0, 9) != "rcwrcwrcw") {
+    std::cout << "cycles / order failed" << std::endl;
+    return(1);
+  }
+  if (received != "ping" || pad.axis[1] < 0.99) {
+    std::cout << "read stages failed" << std::endl;
+    return(1);
+  }
+  /// absolute deadlines: 200 cycles take 200 msec (plus the skipped ones) regardless of work
+  if (elapsed < 199000000ULL || elapsed > (201 + s.skipped) * 1000000ULL + 20000000ULL) {
+    std::cout << "period failed: " << elapsed << " ns" << std::endl;
+    return(1);
+  }
+  std::cout << "jitter p50 " << s.jitter.percentile(0.5) << " ns, p99 " << s.jitter.percentile(0.99)
+	    << " ns, max " << s.jitter.max << " ns" << std::endl;
+
+  /// overrun skips passed deadlines and keeps the phase
+  ControlLoop slow(1000);
+  int count = 0;
+  slow.addStage(ControlLoop::COMPUTE, [&]() {
+      if (++count == 5) usleep(3500);
+      if (count == 20) slow.stop();
+    });
+  const uint64_t begin = ControlLoop::now();
+  slow.run();
+  s = slow.snapshot();
+  if (s.cycles != 20 || s.overruns < 1 || s.skipped < 3 || s.overrun.count != s.overruns) {
+    std::cout << "overrun failed" << std::endl;
+    return(1);
+  }
+  if (ControlLoop::now() - begin < (20 + s.skipped) * 1000000ULL - 1000000ULL) return(1);
+
+  /// real-time settings are optional, failures throw and leave the thread as it was
+  ControlLoop pinned(2000);
+  pinned.setCpuAffinity(0);
+  pinned.setSpinMargin(50000);
+  pinned.run(10);
+  if (pinned.snapshot().cycles != 10) return(1);
+  pinned.setRealtimePriority(200);
+  try {
+    pinned.run(1);
+    std::cout << "invalid priority accepted" << std::endl;
+    return(1);
+  } catch (ControlLoopException& ex) {
+  }
+  int policy;
+  struct sched_param param;
+  if (pthread_getschedparam(pthread_self(), &policy, &param) != 0 || policy != SCHED_OTHER) return(1);
+  try {
+    ControlLoop(0);
+    return(1);
+  } catch (ControlLoopException& ex) {
+  }
+
+  close(padPipe[1]);
+  std::cout << "OK" << std::endl;
+  return(0);
+}
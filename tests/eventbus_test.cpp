@@ -0,0 +1,116 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+
+#include "aqua2/eventbus.h"
+#include "aqua2/serversocket.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+int main(void) {
+  std::cout << "libaqua2 / EventBus test" << std::endl;
+
+  EventBus bus;
+  std::vector<InputEvent> received;
+  bus.setHandler([&](const InputEvent& e) { received.push_back(e); });
+
+  int keyPipe[2], padPipe[2];
+  if (pipe(keyPipe) != 0 || pipe(padPipe) != 0) return(1);
+  KeyInput keys(keyPipe[0]);
+  GamePad pad(padPipe[0], 2, 2);
+  VirtualSerialPair serial(115200);
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  Socket client("127.0.0.1", server.getPort());
+  Socket peer = server.accept();
+
+  const int keyId = bus.addKeyInput(keys);
+  const int padId = bus.addGamePad(pad);
+  const int serialId = bus.addSerialPort(serial.second());
+  const int socketId = bus.addSocket(client);
+  try {
+    bus.addSocket(client);
+    std::cout << "same source added twice" << std::endl;
+    return(1);
+  } catch (EventBusException& ex) {
+  }
+
+  if (bus.spinOnce(0) != 0) return(1);
+
+  /// one input on each source
+  js_event e;
+  e.time = 0;
+  e.type = JS_EVENT_BUTTON;
+  e.number = 1;
+  e.value = 1;
+  if (write(padPipe[1], &e, sizeof(e)) != sizeof(e)) return(1);
+  if (write(keyPipe[1], "q\x1b[A", 4) != 4) return(1);
+  char bytes[100];
+  for (int i = 0; i < 100; i++) bytes[i] = (char)i;
+  serial.first().write(bytes, sizeof(bytes));
+  peer.write("ping", 4);
+  usleep(20000);
+
+  int total = 0;
+  for (int i = 0; i < 10 && total < 7; i++) total += bus.spinOnce(100);
+  if (total != 7 || received.size() != 7) {
+    std::cout << "wrong number of events " << total << std::endl;
+    return(1);
+  }
+  int keyEvents = 0, padEvents = 0, serialBytes = 0, socketEvents = 0;
+  for (size_t i = 0; i < received.size(); i++) {
+    const InputEvent& r = received[i];
+    if (r.type == InputEvent::KEY && r.source == keyId) keyEvents++;
+    if (r.type == InputEvent::GAMEPAD && r.source == padId && r.gamepad.type == GamePadEvent::BUTTON && r.gamepad.number == 1 && r.gamepad.value == 1.0f) padEvents++;
+    if (r.type == InputEvent::SERIAL && r.source == serialId) {
+      if (r.size > InputEvent::DATA_SIZE || r.data[0] != serialBytes) return(1);
+      serialBytes += r.size;
+    }
+    if (r.type == InputEvent::SOCKET && r.source == socketId && r.size == 4 && memcmp(r.data, "ping", 4) == 0) socketEvents++;
+  }
+  if (keyEvents != 2 || padEvents != 1 || serialBytes != 100 || socketEvents != 1) {
+    std::cout << "wrong events " << keyEvents << " " << padEvents << " " << serialBytes << " " << socketEvents << std::endl;
+    return(1);
+  }
+
+  /// events posted by another thread wake spinOnce()
+  received.clear();
+  std::thread poster([&]() {
+    usleep(20000);
+    bus.post(100, 42);
+  });
+  const uint64_t start = InputLatencyMonitor::now();
+  const int n = bus.spinOnce(2000);
+  poster.join();
+  if (n != 1 || received[0].type != InputEvent::USER || received[0].value != 42 || received[0].source != 100 ||
+      InputLatencyMonitor::now() - start > 1000000000ULL) {
+    std::cout << "post failed" << std::endl;
+    return(1);
+  }
+
+  /// lone ESC is delivered after the escape timeout without new input
+  received.clear();
+  keys.setEscapeTimeout(10);
+  if (write(keyPipe[1], "\x1b", 1) != 1) return(1);
+  for (int i = 0; i < 20 && received.empty(); i++) bus.spinOnce(100);
+  if (received.size() != 1 || received[0].key != AQUA2_KEY_ESCAPE) {
+    std::cout << "escape failed" << std::endl;
+    return(1);
+  }
+
+  /// peer closed
+  received.clear();
+  peer.close();
+  for (int i = 0; i < 10 && received.empty(); i++) bus.spinOnce(100);
+  if (received.size() != 1 || received[0].type != InputEvent::DISCONNECTED || received[0].source != socketId || bus.isActive(socketId)) {
+    std::cout << "disconnect failed" << std::endl;
+    return(1);
+  }
+  client.close();
+  server.close();
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
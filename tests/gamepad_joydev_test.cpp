@@ -0,0 +1,97 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "aqua2/gamepad.h"
+
+using namespace ssr::aqua2;
+
+static void push(std::vector<js_event>& events, const uint8_t type, const uint8_t number, const int16_t value) {
+  js_event e;
+  e.time = (uint32_t)events.size();
+  e.type = type;
+  e.number = number;
+  e.value = value;
+  events.push_back(e);
+}
+
+int main(void) {
+  std::cout << "libaqua2 / GamePad joydev test" << std::endl;
+
+  int fds[2];
+  if (pipe(fds) != 0) return(1);
+  GamePad gamePad(fds[0], 4, 8);
+
+  /// initial state, then a 500 Hz stick stream (several reads worth) with a short button press
+  std::vector<js_event> events;
+  for (uint8_t i = 0; i < 4; i++) push(events, JS_EVENT_AXIS | JS_EVENT_INIT, i, 0);
+  for (uint8_t i = 0; i < 8; i++) push(events, JS_EVENT_BUTTON | JS_EVENT_INIT, i, 0);
+  for (int i = 0; i < 200; i++) push(events, JS_EVENT_AXIS, 0, (int16_t)(i * 100));
+  push(events, JS_EVENT_BUTTON, 3, 1);
+  push(events, JS_EVENT_AXIS, 1, -32767);
+  push(events, JS_EVENT_BUTTON, 9, 1); // out of range, ignored
+  if (write(fds[1], events.data(), events.size() * sizeof(js_event)) != (ssize_t)(events.size() * sizeof(js_event))) return(1);
+
+  if (gamePad.update() != (int)events.size()) {
+    std::cout << "events were not drained in one update()" << std::endl;
+    return(1);
+  }
+  if (std::fabs(gamePad.axis[0] - 19900 / 32767.0f) > 1e-6 || gamePad.axis[1] != -1.0f || !gamePad.buttons[3] || gamePad.old_buttons[3]) {
+    std::cout << "wrong state" << std::endl;
+    return(1);
+  }
+
+  GamePadState state = gamePad.state();
+  if (state.sequence != 1 || state.numAxes != 4 || state.numButtons != 8 || state.buttons != 0x08 ||
+      !gamePad.pressed(3) || !state.pressed(3) || state.released(3) || state.axes[1] != -1.0f) {
+    std::cout << "wrong state snapshot" << std::endl;
+    return(1);
+  }
+
+  /// every change except the out-of-range button is kept in the event queue
+  GamePadEvents changes = gamePad.events();
+  if (changes.size() != events.size() - 1 || !changes[0].init || changes[12].init ||
+      changes[212].type != GamePadEvent::BUTTON || changes[212].number != 3 || changes[212].value != 1.0f ||
+      changes[212].timestamp != 212 * 1000000ULL || changes[212].received == 0) {
+    std::cout << "wrong events" << std::endl;
+    return(1);
+  }
+  size_t axisEvents = 0;
+  for (GamePadEvents::iterator it = changes.begin(); it != changes.end(); ++it) {
+    if (it->type == GamePadEvent::AXIS && it->number == 0 && !it->init) axisEvents++;
+  }
+  if (axisEvents != 200) {
+    std::cout << "axis events lost" << std::endl;
+    return(1);
+  }
+
+  gamePad.setAxisScale(2.0f);
+  if (gamePad.axis[1] != -2.0f || gamePad.update() != 0 || !gamePad.old_buttons[3] || !gamePad.events().empty()) {
+    std::cout << "axis scale / old_buttons failed" << std::endl;
+    return(1);
+  }
+
+  events.clear();
+  push(events, JS_EVENT_BUTTON, 3, 0);
+  push(events, JS_EVENT_AXIS, 1, 32767);
+  if (write(fds[1], events.data(), events.size() * sizeof(js_event)) < 0) return(1);
+  if (gamePad.update() != 2 || gamePad.buttons[3] || !gamePad.old_buttons[3] || gamePad.axis[1] != 2.0f ||
+      gamePad.events().size() != 2 || gamePad.events()[1].value != 2.0f || gamePad.getDroppedEvents() != 0) {
+    std::cout << "release failed" << std::endl;
+    return(1);
+  }
+  if (!gamePad.released(3) || gamePad.pressed(3) || gamePad.state().releasedMask() != 0x08 || gamePad.state().sequence != 3) {
+    std::cout << "release edge not detected" << std::endl;
+    return(1);
+  }
+
+  /// writer side closed, like an unplugged device
+  close(fds[1]);
+  if (gamePad.update() != -1) {
+    std::cout << "hangup not reported" << std::endl;
+    return(1);
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -1,14 +1,18 @@
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <cstdlib>
 #include "aqua2/gamepad.h"
 
 using namespace ssr::aqua2;
 
-int main(void) {
+/// Interactive: prints the state of a connected pad. Not run by ctest.
+/// usage: gamepad_test [updates] (0 or none: for ever)
+int main(int argc, char* argv[]) {
   std::cout << "libaqua2 / GamePad test" << std::endl;
+  const int updates = argc > 1 ? atoi(argv[1]) : 0;
   GamePad* gamePad = new GamePad("");
-  while(true) {
+  for (int n = 0; updates <= 0 || n < updates; n++) {
       std::this_thread::sleep_for(std::chrono::milliseconds(500));
       gamePad->update();
       
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+#include "aqua2/gamepadmanager.h"
+
+using namespace ssr::aqua2;
+
+static bool misaligned = false;
+
+/// FIFOs stand in for joystick devices. Opened read-write so that they never report EOF.
+static GamePad* openFifo(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+  if (fd < 0) throw DeviceNotFoundException();
+  GamePad* pad = new GamePad(fd, 2, 4);
+  if ((uintptr_t)pad % alignof(GamePad) != 0) misaligned = true;
+  return pad;
+}
+
+static void send(const std::string& path, const uint8_t type, const uint8_t number, const int16_t value) {
+  js_event e;
+  e.time = 0;
+  e.type = type;
+  e.number = number;
+  e.value = value;
+  const int fd = ::open(path.c_str(), O_WRONLY | O_NONBLOCK);
+  if (write(fd, &e, sizeof(e)) != sizeof(e)) std::cout << "write failed" << std::endl;
+  close(fd);
+}
+
+static bool spinUntil(GamePadManager& manager, const std::function<bool()>& condition) {
+  for (int i = 0; i < 100; i++) {
+    manager.spinOnce(10);
+    if (condition()) return true;
+  }
+  return false;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / GamePadManager test" << std::endl;
+
+  char dir[] = "/tmp/aqua2_gamepads_XXXXXX";
+  if (!mkdtemp(dir)) return(1);
+  const std::string js0 = std::string(dir) + "/js0", js1 = std::string(dir) + "/js1";
+  mkfifo(js0.c_str(), 0600);
+  mkfifo((std::string(dir) + "/event0").c_str(), 0600); // not a joystick
+
+  GamePadManager manager(dir, "js", openFifo);
+  int connected = 0, disconnected = 0;
+  manager.addListener([&](const int /*id*/, const int event) {
+    if (event == GamePadManager::CONNECTED) connected++;
+    else disconnected++;
+  });
+  if (manager.getNumIds() != 1 || connected != 1 || manager.getPath(0) != js0) {
+    std::cout << "initial scan failed" << std::endl;
+    return(1);
+  }
+
+  mkfifo(js1.c_str(), 0600);
+  if (!spinUntil(manager, [&]() { return connected == 2; }) || !manager.isConnected(1)) {
+    std::cout << "attach not detected" << std::endl;
+    return(1);
+  }
+
+  /// input on js1 only, edge lasts one spin
+  send(js1, JS_EVENT_BUTTON, 2, 1);
+  send(js1, JS_EVENT_AXIS, 1, 32767);
+  if (!spinUntil(manager, [&]() { return manager.getPad(1)->pressed(2); }) || manager.getPad(1)->axis[1] != 1.0f ||
+      manager.getPad(0)->buttons[2]) {
+    std::cout << "input not delivered" << std::endl;
+    return(1);
+  }
+  manager.spinOnce(0);
+  if (manager.getPad(1)->pressed(2) || !manager.getPad(1)->buttons[2] || manager.spinOnce(0) != 0) {
+    std::cout << "edge not cleared" << std::endl;
+    return(1);
+  }
+
+  /// unplug and plug js0 again: same ID
+  unlink(js0.c_str());
+  if (!spinUntil(manager, [&]() { return disconnected == 1; }) || manager.isConnected(0) || manager.getNumConnected() != 1) {
+    std::cout << "detach not detected" << std::endl;
+    return(1);
+  }
+  mkfifo(js0.c_str(), 0600);
+  if (!spinUntil(manager, [&]() { return connected == 3; }) || !manager.isConnected(0) || manager.getNumIds() != 2) {
+    std::cout << "reattach failed" << std::endl;
+    return(1);
+  }
+
+  unlink(js0.c_str());
+  unlink(js1.c_str());
+  unlink((std::string(dir) + "/event0").c_str());
+  rmdir(dir);
+  if (misaligned) {
+    std::cout << "GamePad is not cache line aligned" << std::endl;
+    return(1);
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <thread>
+
+#include "aqua2/gamepadrecorder.h"
+
+using namespace ssr::aqua2;
+
+static void send(const int fd, const uint8_t type, const uint8_t number, const int16_t value, const uint32_t time) {
+  js_event e;
+  e.time = time;
+  e.type = type;
+  e.number = number;
+  e.value = value;
+  if (write(fd, &e, sizeof(e)) != sizeof(e)) std::cout << "write failed" << std::endl;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / GamePadRecorder test" << std::endl;
+
+  char filename[] = "/tmp/aqua2_gamepad_XXXXXX";
+  const int tmp = mkstemp(filename);
+  if (tmp < 0) return(1);
+  close(tmp);
+
+  /// record three updates 20 msec apart
+  std::vector<GamePadState> recorded;
+  {
+    int fds[2];
+    if (pipe(fds) != 0) return(1);
+    GamePad pad(fds[0], 2, 4);
+    GamePadRecorder recorder(filename, pad);
+    pad.setInputObserver(&recorder);
+    send(fds[1], JS_EVENT_AXIS | JS_EVENT_INIT, 0, 0, 1000);
+    send(fds[1], JS_EVENT_BUTTON | JS_EVENT_INIT, 1, 0, 1000);
+    pad.update();
+    recorded.push_back(pad.state());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    send(fds[1], JS_EVENT_AXIS, 0, 16384, 1020);
+    send(fds[1], JS_EVENT_BUTTON, 1, 1, 1020);
+    pad.update();
+    recorded.push_back(pad.state());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    send(fds[1], JS_EVENT_AXIS, 1, -32767, 1040);
+    send(fds[1], JS_EVENT_BUTTON, 1, 0, 1040);
+    pad.update();
+    recorded.push_back(pad.state());
+    if (recorder.getNumRecords() != 6) {
+      std::cout << "records missing" << std::endl;
+      return(1);
+    }
+    close(fds[1]);
+  }
+
+  /// virtual time: each 20 msec step reproduces one recorded update
+  {
+    GamePadReplayer replayer(filename);
+    GamePad pad(replayer);
+    if (replayer.getNumRecords() != 6 || pad.getNumAxes() != 2 || pad.getNumButtons() != 4 ||
+	replayer.getDuration() < 0.035 || replayer.getDuration() > 0.5) {
+      std::cout << "wrong log (duration " << replayer.getDuration() << ")" << std::endl;
+      return(1);
+    }
+    replayer.advance(0.01);
+    for (size_t i = 0; i < recorded.size(); i++) {
+      pad.update();
+      const GamePadState state = pad.state();
+      if (state.buttons != recorded[i].buttons || state.axes[0] != recorded[i].axes[0] || state.axes[1] != recorded[i].axes[1]) {
+	std::cout << "step " << i << " differs" << std::endl;
+	return(1);
+      }
+      if (i == 2 && (!pad.released(1) || pad.events()[0].timestamp != 1040 * 1000000ULL)) {
+	std::cout << "edge / timestamp not reproduced" << std::endl;
+	return(1);
+      }
+      replayer.advance(0.02);
+    }
+    if (replayer.advance(1.0)) {
+      std::cout << "replay did not finish" << std::endl;
+      return(1);
+    }
+  }
+
+  /// real time at 4x speed
+  {
+    GamePadReplayer replayer(filename);
+    GamePad pad(replayer);
+    const uint64_t start = GamePadEvent::now();
+    replayer.start(4.0);
+    while (replayer.isPlaying()) {
+      pad.update();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pad.update();
+    const double elapsed = (GamePadEvent::now() - start) * 1e-9;
+    if (pad.state().axes[1] != -1.0f || pad.buttons[1] || elapsed > replayer.getDuration()) {
+      std::cout << "real time replay failed (" << elapsed << " s)" << std::endl;
+      return(1);
+    }
+  }
+
+  /// a log which can not be written stops recording without throwing from update()
+  {
+    int fds[2];
+    if (pipe(fds) != 0) return(1);
+    GamePad pad(fds[0], 2, 4);
+    GamePadRecorder recorder("/dev/full", pad);
+    pad.setInputObserver(&recorder);
+    send(fds[1], JS_EVENT_AXIS, 0, 16384, 2000);
+    pad.update();
+    recorder.flush();
+    send(fds[1], JS_EVENT_AXIS, 0, 0, 2001);
+    pad.update();
+    if (!recorder.hasError() || recorder.getNumRecords() != 1 || pad.state().axes[0] != 0.0f) {
+      std::cout << "write error not recorded" << std::endl;
+      return(1);
+    }
+    close(fds[1]);
+  }
+
+  unlink(filename);
+  std::cout << "OK" << std::endl;
+  return(0);
+}
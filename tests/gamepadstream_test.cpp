@@ -0,0 +1,159 @@
+#include <iostream>
+#include <cmath>
+
+#include "aqua2/gamepadstream.h"
+#include "aqua2/serversocket.h"
+
+using namespace ssr::aqua2;
+
+static GamePadState makeState(const uint64_t sequence) {
+  GamePadState s;
+  memset(&s, 0, sizeof(s));
+  s.sequence = sequence;
+  s.timestamp = GamePadEvent::now();
+  s.numAxes = 6;
+  s.numButtons = 12;
+  return s;
+}
+
+static bool same(const GamePadState& a, const GamePadState& b) {
+  if (a.numAxes != b.numAxes || a.numButtons != b.numButtons || a.buttons != b.buttons) return false;
+  for (int i = 0; i < a.numAxes; i++) {
+    if (std::fabs(a.axes[i] - b.axes[i]) > 1.0f / 32767) return false;
+  }
+  return true;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / GamePadStream test" << std::endl;
+
+  /// UDP on loopback
+  GamePadStreamSubscriber subscriber(0);
+  GamePadStreamPublisher publisher("127.0.0.1", subscriber.getPort(), 50);
+
+  GamePadState state = makeState(1);
+  state.axes[0] = 0.5f;
+  state.setButton(3, true);
+  const int keyframeSize = publisher.publish(state);
+  if (keyframeSize != 12 + 2 + 4 + 2 * 6 + 2) {
+    std::cout << "wrong keyframe size " << keyframeSize << std::endl;
+    return(1);
+  }
+  if (subscriber.spinOnce(1000) != 1 || !subscriber.isSynchronized() || !same(subscriber.state(), state) || !subscriber.state().pressed(3)) {
+    std::cout << "keyframe not received" << std::endl;
+    return(1);
+  }
+
+  /// no change: nothing is sent
+  state.sequence++;
+  if (publisher.publish(state) != 0) return(1);
+
+  /// one axis: 18 bytes
+  state.sequence++;
+  state.axes[4] = -0.25f;
+  if (publisher.publish(state) != 12 + 4 + 2) {
+    std::cout << "wrong delta size" << std::endl;
+    return(1);
+  }
+  state.sequence++;
+  state.setButton(3, false);
+  state.setButton(11, true);
+  if (publisher.publish(state) != 12 + 2) return(1);
+  if (subscriber.spinOnce(1000) != 2 || !same(subscriber.state(), state) || !subscriber.state().released(3) || !subscriber.state().pressed(11)) {
+    std::cout << "deltas not applied" << std::endl;
+    return(1);
+  }
+  if (subscriber.spinOnce(0) != 0 || subscriber.state().pressed(11)) {
+    std::cout << "edges must last one spin" << std::endl;
+    return(1);
+  }
+  if (subscriber.latency().count != 3 || subscriber.latency().max > 1000000000ULL) {
+    std::cout << "latency not measured" << std::endl;
+    return(1);
+  }
+
+  /// lost packet: out of sync until keyframe, later deltas still applied
+  uint8_t packet[GamePadStreamFormat::MAX_PACKET_SIZE];
+  uint8_t old[GamePadStreamFormat::MAX_PACKET_SIZE];
+  state.sequence++;
+  state.axes[1] = 0.75f;
+  const size_t oldSize = publisher.encode(state, GamePadEvent::now(), old); // never sent
+  state.sequence++;
+  state.axes[2] = -1.0f;
+  if (publisher.publish(state) <= 0 || subscriber.spinOnce(1000) != 1) return(1);
+  if (subscriber.isSynchronized() || subscriber.getLostPackets() != 1 || subscriber.state().axes[2] != -1.0f || subscriber.state().axes[1] != 0.0f) {
+    std::cout << "loss not detected" << std::endl;
+    return(1);
+  }
+  if (subscriber.apply(old, oldSize, GamePadEvent::now()) || subscriber.getDiscardedPackets() != 1) {
+    std::cout << "late packet applied" << std::endl;
+    return(1);
+  }
+  usleep(60000);
+  state.sequence++;
+  if (publisher.publish(state) <= 0 || subscriber.spinOnce(1000) != 1 || !subscriber.isSynchronized() || !same(subscriber.state(), state)) {
+    std::cout << "keyframe did not resync" << std::endl;
+    return(1);
+  }
+  if (publisher.getKeyframesSent() != 2) return(1);
+
+  /// restarted publisher: its first keyframe resyncs although the sequence goes back
+  {
+    GamePadStreamPublisher restarted("127.0.0.1", subscriber.getPort(), 50);
+    state.sequence++;
+    state.axes[0] = -0.25f;
+    if (restarted.publish(state) <= 0 || subscriber.spinOnce(1000) != 1 || !subscriber.isSynchronized() || !same(subscriber.state(), state)) {
+      std::cout << "keyframe of restarted publisher discarded" << std::endl;
+      return(1);
+    }
+  }
+
+  /// heap allocation keeps the cache line alignment of the published state
+  {
+    GamePadStreamSubscriber* heap = new GamePadStreamSubscriber(0);
+    const bool aligned = (uintptr_t)heap % alignof(GamePadStreamSubscriber) == 0;
+    delete heap;
+    if (!aligned) {
+      std::cout << "subscriber misaligned on heap" << std::endl;
+      return(1);
+    }
+  }
+
+  /// broken packet
+  memset(packet, 0, sizeof(packet));
+  if (subscriber.apply(packet, 5, 0)) return(1);
+
+  /// TCP
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  Socket client("127.0.0.1", server.getPort());
+  Socket accepted = server.accept();
+  {
+    GamePadStreamPublisher tcpPublisher(accepted);
+    GamePadStreamSubscriber tcpSubscriber(client);
+    GamePadState s = makeState(1);
+    for (int i = 0; i < 100; i++) {
+      s.sequence++;
+      s.axes[0] = i / 100.0f;
+      s.setButton(i % 12, !s.button(i % 12));
+      if (tcpPublisher.publish(s) <= 0) return(1);
+    }
+    int applied = 0;
+    for (int i = 0; i < 100 && applied < 100; i++) applied += tcpSubscriber.spinOnce(100);
+    if (applied != 100 || !same(tcpSubscriber.state(), s) || tcpSubscriber.getLostPackets() != 0) {
+      std::cout << "TCP stream failed " << applied << std::endl;
+      return(1);
+    }
+    accepted.close();
+    if (tcpSubscriber.spinOnce(1000) != -1) {
+      std::cout << "TCP close not reported" << std::endl;
+      return(1);
+    }
+  }
+  client.close();
+  server.close();
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+
+#include "aqua2/gamepad.h"
+#include "aqua2/keyinput.h"
+
+using namespace ssr::aqua2;
+
+int main(void) {
+  std::cout << "libaqua2 / InputLatencyMonitor test" << std::endl;
+
+  /// GamePad (joydev: stamped at read() in update())
+  int fds[2];
+  if (pipe(fds) != 0) return(1);
+  GamePad pad(fds[0], 2, 2);
+  InputLatencyMonitor padMonitor;
+  pad.setLatencyMonitor(&padMonitor);
+  if (padMonitor.getSource() != InputLatencyMonitor::READ_TIME) return(1);
+
+  js_event e[3];
+  for (int i = 0; i < 3; i++) {
+    e[i].time = 0;
+    e[i].type = i == 0 ? (JS_EVENT_BUTTON | JS_EVENT_INIT) : JS_EVENT_AXIS;
+    e[i].number = 0;
+    e[i].value = (int16_t)(i * 1000);
+  }
+  if (write(fds[1], e, sizeof(e)) != sizeof(e)) return(1);
+  pad.update();
+  usleep(20000);
+  pad.update();
+  InputLatencySnapshot s = padMonitor.snapshot();
+  if (s.latency.count != 2 || s.latency.max > 20000000ULL || s.interval.count != 1 || s.interval.max < 20000000ULL) {
+    std::cout << "GamePad latency / interval failed" << std::endl;
+    return(1);
+  }
+  pad.setLatencyMonitor(nullptr);
+  pad.update();
+  if (padMonitor.snapshot().interval.count != 1) return(1);
+  close(fds[1]);
+
+  /// keyboard from a pipe: stamped by kbhit(), consumed by getch()
+  if (pipe(fds) != 0) return(1);
+  if (dup2(fds[0], 0) < 0) return(1);
+  InputLatencyMonitor keyMonitor;
+  set_key_latency_monitor(&keyMonitor);
+  if (kbhit() != 0) return(1);
+  if (write(fds[1], "a", 1) != 1) return(1);
+  if (kbhit() <= 0) return(1);
+  usleep(10000);
+  if (getch() != 'a') return(1);
+  s = keyMonitor.snapshot();
+  if (s.latency.count != 1 || s.latency.max < 10000000ULL || s.interval.count != 1) {
+    std::cout << "keyboard latency failed" << std::endl;
+    return(1);
+  }
+  set_key_latency_monitor(nullptr);
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
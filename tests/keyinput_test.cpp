@@ -0,0 +1,138 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <poll.h>
+
+#include "aqua2/keyinput.h"
+
+using namespace ssr::aqua2;
+
+static std::vector<int> keys(KeyInput& input) {
+  std::vector<int> v;
+  for (int key; (key = input.get()) != -1;) v.push_back(key);
+  return v;
+}
+
+static bool send(const int fd, const std::string& s) {
+  if (write(fd, s.data(), s.size()) != (ssize_t)s.size()) return false;
+  usleep(2000); // let the line discipline pass it to the slave
+  return true;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / KeyInput test" << std::endl;
+
+  const int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return(1);
+  const int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0) return(1);
+
+  struct termios before;
+  tcgetattr(slave, &before);
+  {
+    KeyInput input(slave);
+    input.setEscapeTimeout(20);
+    if (input.update() != 0 || input.available()) return(1);
+
+    /// everything pending is decoded by one update()
+    if (!send(master, "ab \x1b[A\x1b[5~\x1bOP\x1b[1;5C\x1b[15~")) return(1);
+    struct pollfd pfd;
+    pfd.fd = input.getFileDescriptor();
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 1000) != 1) return(1);
+    const std::vector<int> expected = { 'a', 'b', AQUA2_KEY_SPACE, AQUA2_KEY_UP, AQUA2_KEY_PAGE_UP, AQUA2_KEY_F1, AQUA2_KEY_RIGHT, AQUA2_KEY_F5 };
+    if (input.update() != (int)expected.size() || keys(input) != expected) {
+      std::cout << "decode failed" << std::endl;
+      return(1);
+    }
+
+    /// sequence split across reads
+    if (!send(master, "\x1b[")) return(1);
+    if (input.update() != 0) return(1);
+    if (!send(master, "3~x")) return(1);
+    if (input.update() != 2 || keys(input) != std::vector<int>({ AQUA2_KEY_DELETE, 'x' })) {
+      std::cout << "split sequence failed" << std::endl;
+      return(1);
+    }
+
+    /// lone ESC after timeout, Alt + key as ESC and key
+    if (!send(master, "\x1b")) return(1);
+    if (input.update() != 0) return(1);
+    usleep(30000);
+    if (input.update() != 1 || input.get() != AQUA2_KEY_ESCAPE) {
+      std::cout << "lone escape failed" << std::endl;
+      return(1);
+    }
+    if (!send(master, "\x1bq")) return(1);
+    if (input.update() != 2 || keys(input) != std::vector<int>({ AQUA2_KEY_ESCAPE, 'q' })) return(1);
+
+    /// latency from read to get
+    InputLatencyMonitor monitor;
+    input.setLatencyMonitor(&monitor);
+    if (!send(master, "z")) return(1);
+    input.update();
+    usleep(5000);
+    if (input.get() != 'z' || monitor.snapshot().latency.count != 1 || monitor.snapshot().latency.max < 5000000ULL) return(1);
+  }
+  struct termios after;
+  tcgetattr(slave, &after);
+  if (after.c_lflag != before.c_lflag || after.c_cc[VMIN] != before.c_cc[VMIN]) {
+    std::cout << "termios not restored" << std::endl;
+    return(1);
+  }
+
+  /// terminal mode owned by the caller (eg., init_scr()) is left as it is
+  {
+    KeyInput input(slave, false);
+    tcgetattr(slave, &after);
+    if (after.c_lflag != before.c_lflag || input.update() != 0) {
+      std::cout << "caller's terminal mode changed" << std::endl;
+      return(1);
+    }
+    if (!send(master, "ab")) return(1);
+    if (input.update() != 0) return(1); // canonical: nothing until the end of line, without blocking
+    if (!send(master, "\n")) return(1);
+    usleep(10000);
+    if (input.update() != 3 || keys(input) != std::vector<int>({ 'a', 'b', '\n' })) {
+      std::cout << "canonical input failed" << std::endl;
+      return(1);
+    }
+  }
+  tcgetattr(slave, &after);
+  if (after.c_lflag != before.c_lflag) return(1);
+
+  /// hang up of terminal is seen by poll(), end of pipe by update()
+  close(master);
+  struct pollfd pfd;
+  pfd.fd = slave;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLHUP)) return(1);
+  close(slave);
+
+  int fds[2];
+  if (pipe(fds) != 0) return(1);
+  {
+    KeyInput input(fds[0]);
+    if (input.update() != 0 || write(fds[1], "k", 1) != 1) return(1);
+    close(fds[1]);
+    if (input.update() != 1 || input.get() != 'k' || input.update() != -1) {
+      std::cout << "end of pipe not reported" << std::endl;
+      return(1);
+    }
+  }
+  close(fds[0]);
+
+  /// heap allocation keeps the cache line alignment of the key queue
+  {
+    KeyInput* heap = new KeyInput(0, false);
+    const bool aligned = (uintptr_t)heap % alignof(KeyInput) == 0;
+    delete heap;
+    if (!aligned) {
+      std::cout << "KeyInput misaligned on heap" << std::endl;
+      return(1);
+    }
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <stdexcept>
+
+#include "aqua2/serialport.h"
+#include "aqua2/serversocket.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+/// eg., SerialRecorder whose log can not grow
+class FailingObserver : public SerialTrafficObserver {
+public:
+  int calls = 0;
+  virtual void onTraffic(const int /*direction*/, const void* /*data*/, const size_t /*size*/) {
+    calls++;
+    throw std::runtime_error("log full");
+  }
+};
+
+static double since(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void) {
+  std::cout << "libaqua2 / Result test" << std::endl;
+
+  /// Result
+  Result<int> ok(3);
+  Result<int> failed = ErrorCode(ETIMEDOUT);
+  if (!ok || ok.value() != 3 || ok.error() != 0 || failed || failed.error() != ETIMEDOUT || failed.valueOr(-1) != -1) return(1);
+  if (std::string(failed.message()).empty() || !Result<void>() || Result<void>(ErrorCode(EIO)).error() != EIO) return(1);
+
+  /// SocketException::what() stays valid
+  try {
+    throw SocketException("bind failed.");
+  } catch (std::exception& ex) {
+    const char* what = ex.what();
+    if (std::string(what) != "SocketException: bind failed.") {
+      std::cout << "SocketException::what() failed" << std::endl;
+      return(1);
+    }
+  }
+
+  /// ServerSocket: timeouts are results, accept(timeoutUsec) waits microseconds
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  auto start = std::chrono::steady_clock::now();
+  Result<Socket> accepted = server.tryAccept(50000);
+  if (accepted || accepted.error() != ETIMEDOUT || since(start) < 0.045 || since(start) > 0.5) {
+    std::cout << "tryAccept timeout failed" << std::endl;
+    return(1);
+  }
+  start = std::chrono::steady_clock::now();
+  try {
+    server.accept(200000);
+    return(1);
+  } catch (TimeoutException& ex) {
+  }
+  if (since(start) < 0.19 || since(start) > 1.0) {
+    std::cout << "accept(timeoutUsec) waited " << since(start) << " sec" << std::endl;
+    return(1);
+  }
+
+  Socket client("127.0.0.1", server.getPort());
+  accepted = server.tryAccept(1000000);
+  if (!accepted) return(1);
+  Socket peer = accepted.value();
+
+  /// Socket
+  char buf[16];
+  if (client.tryWrite("abc", 3).value() != 3) return(1);
+  Result<int> n = peer.tryRead(buf, 3, 1.0);
+  if (!n || n.value() != 3 || memcmp(buf, "abc", 3) != 0) return(1);
+  n = peer.tryRead(buf, 1, 0.02);
+  if (n || n.error() != ETIMEDOUT) return(1);
+  client.close();
+  n = peer.tryRead(buf, 1, 1.0);
+  if (n || n.error() != ECONNRESET) {
+    std::cout << "closed peer failed" << std::endl;
+    return(1);
+  }
+  if (!peer.tryRead(buf, 1) || peer.tryRead(buf, 1).value() != 0) return(1);
+  n = peer.tryWrite("x", 1);
+  if (n) n = peer.tryWrite("x", 1);  // first one may be buffered before RST
+  if (n || n.error() != EPIPE) {
+    std::cout << "write to closed peer failed: " << n.message() << std::endl;
+    return(1);
+  }
+  peer.close();
+  server.close();
+
+  /// SerialPort: EAGAIN is a result, not ComAccessException
+  VirtualSerialPair serial(115200);
+  SerialPort& a = serial.first();   // pty master: EAGAIN when empty
+  SerialPort& b = serial.second();
+  a.enableStatistics();
+  n = a.tryRead(buf, sizeof(buf));
+  if (n || n.error() != EAGAIN || a.getStatistics().wouldBlock != 1) {
+    std::cout << "SerialPort tryRead EAGAIN failed" << std::endl;
+    return(1);
+  }
+  if (a.tryWaitAvailable(1, 0.02).error() != ETIMEDOUT) return(1);
+  if (b.tryWrite("hello", 5).value() != 5) return(1);
+  n = a.tryRead(buf, 5, 1.0);
+  if (!n || n.value() != 5 || memcmp(buf, "hello", 5) != 0 || a.getStatistics().bytesRead != 5) return(1);
+
+  /// observer throwing inside the noexcept try* functions: the I/O result is kept
+  FailingObserver observer;
+  a.setTrafficObserver(&observer);
+  b.setTrafficObserver(&observer);
+  if (b.tryWrite("again", 5).value() != 5 || a.tryRead(buf, 5, 1.0).value() != 5 || observer.calls != 2) {
+    std::cout << "throwing observer failed" << std::endl;
+    return(1);
+  }
+  a.setTrafficObserver(nullptr);
+  b.setTrafficObserver(nullptr);
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
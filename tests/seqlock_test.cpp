@@ -0,0 +1,57 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include "aqua2/seqlock.h"
+#include "aqua2/gamepad.h"
+
+using namespace ssr::aqua2;
+
+/// Writer publishes states where every axis equals sequence and buttons mirror it.
+/// Readers must never see a mix of two states.
+int main(void) {
+  std::cout << "libaqua2 / SeqLock test" << std::endl;
+
+  SeqLock<GamePadState> lock;
+  GamePadState state = GamePadState();
+  state.previousButtons = ~(uint64_t)0;
+  lock.store(state);
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> torn(0), reads(0);
+
+  std::thread readers[2];
+  for (int r = 0; r < 2; r++) {
+    readers[r] = std::thread([&]() {
+      uint64_t last = 0;
+      while (running) {
+	GamePadState s;
+	lock.load(s);
+	bool ok = s.sequence >= last && s.buttons == s.sequence && s.previousButtons == ~s.sequence;
+	for (int i = 0; i < GamePadState::MAX_AXES; i++) ok = ok && s.axes[i] == (float)(s.sequence & 0xFFFF);
+	if (!ok) torn++;
+	last = s.sequence;
+	reads++;
+      }
+    });
+  }
+
+  const uint64_t count = 2000000;
+  for (uint64_t n = 1; n <= count; n++) {
+    state.sequence = n;
+    state.buttons = n;
+    state.previousButtons = ~n;
+    state.axes.fill((float)(n & 0xFFFF));
+    lock.store(state);
+    if ((n & 0x3FFF) == 0) std::this_thread::yield(); // let readers overlap writes on one CPU
+  }
+  running = false;
+  for (int r = 0; r < 2; r++) readers[r].join();
+
+  if (torn != 0 || lock.version() != count + 1 || lock.load().sequence != count) {
+    std::cout << "torn reads " << torn << " of " << reads << std::endl;
+    return(1);
+  }
+  std::cout << reads << " reads" << std::endl;
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <vector>
+
+#include "aqua2/serialbridge.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+static bool receive(Socket& socket, char* buf, const size_t size) {
+  size_t count = 0;
+  while (count < size) {
+    struct pollfd pfd;
+    pfd.fd = socket.getFileDescriptor();
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 2000) <= 0) return false;
+    int ret = socket.read(buf + count, size - count);
+    if (ret <= 0) return false;
+    count += ret;
+  }
+  return true;
+}
+
+static bool waitFor(const std::function<bool()>& condition) {
+  for (int i = 0; i < 200; i++) {
+    if (condition()) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / SerialBridge test" << std::endl;
+
+  VirtualSerialPair pair(115200);
+  SerialPort& device = pair.first();
+
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+  SerialBridge bridge(pair.second(), server);
+  bridge.start();
+
+  Socket writer("127.0.0.1", server.getPort());
+  Socket observer("127.0.0.1", server.getPort());
+  if (!waitFor([&]() { return bridge.getNumClients() == 2; })) {
+    std::cout << "accept failed" << std::endl;
+    return(1);
+  }
+
+  char buf[64];
+  device.write("hello", 5);
+  if (!receive(writer, buf, 5) || memcmp(buf, "hello", 5) != 0 ||
+      !receive(observer, buf, 5) || memcmp(buf, "hello", 5) != 0) {
+    std::cout << "serial to network failed" << std::endl;
+    return(1);
+  }
+
+  writer.write("command", 7);
+  if (device.read(buf, 7, 2.0) != 7 || memcmp(buf, "command", 7) != 0) {
+    std::cout << "network to serial failed" << std::endl;
+    return(1);
+  }
+
+  observer.write("ignored", 7);
+  writer.write("again", 5);
+  if (device.read(buf, 5, 2.0) != 5 || memcmp(buf, "again", 5) != 0) {
+    std::cout << "writer lock failed" << std::endl;
+    return(1);
+  }
+
+  writer.close();
+  if (!waitFor([&]() { return bridge.getNumClients() == 1 && bridge.getWriter() < 0; })) {
+    std::cout << "disconnect failed" << std::endl;
+    return(1);
+  }
+  observer.write("takeover", 8);
+  if (device.read(buf, 8, 2.0) != 8 || memcmp(buf, "takeover", 8) != 0) {
+    std::cout << "writer lock release failed" << std::endl;
+    return(1);
+  }
+
+  // a client which never reads must not stall the serial port nor the other clients
+  Socket stalled("127.0.0.1", server.getPort());
+  int rcvbuf = 4096;
+  setsockopt(stalled.getFileDescriptor(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  if (!waitFor([&]() { return bridge.getNumClients() == 2; })) {
+    std::cout << "accept failed" << std::endl;
+    return(1);
+  }
+  const size_t STREAM_SIZE = 8 * 1024 * 1024;
+  size_t received = 0;
+  std::thread reader([&]() {
+      std::vector<char> chunk(65536);
+      while (received < STREAM_SIZE && observer.waitAvailable(1, 5.0) == 0) {
+	Result<int> r = observer.tryRead(&chunk[0], chunk.size());
+	if (!r || r.value() == 0) break;
+	received += r.value();
+      }
+    });
+  std::vector<uint8_t> block(4096, 'x');
+  size_t sent = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+  while (sent < STREAM_SIZE && std::chrono::steady_clock::now() < deadline) {
+    Result<int> r = device.tryWrite(&block[0], std::min(block.size(), STREAM_SIZE - sent));
+    if (r) sent += r.value();
+    else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  reader.join();
+  if (sent != STREAM_SIZE || received != STREAM_SIZE) {
+    std::cout << "slow client stalled the bridge (sent " << sent << ", received " << received << ")" << std::endl;
+    return(1);
+  }
+
+  bridge.stop();
+  SerialBridgeCounters up = bridge.serialToNetwork();
+  SerialBridgeCounters down = bridge.networkToSerial();
+  std::cout << "serial->network " << up.bytes << " bytes, avg " << up.averageLatency() << " ns, max " << up.latencyMax << " ns, dropped " << up.dropped << std::endl;
+  std::cout << "network->serial " << down.bytes << " bytes, avg " << down.averageLatency() << " ns, max " << down.latencyMax << " ns, dropped " << down.dropped << std::endl;
+  if (up.bytes != 5 + STREAM_SIZE || up.dropped == 0 || down.bytes != 20 || down.dropped != 7) {
+    std::cout << "counters mismatch" << std::endl;
+    return(1);
+  }
+
+  stalled.close();
+  observer.close();
+  server.close();
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -1,10 +1,69 @@
 #include <iostream>
+#include <cstring>
+#include <chrono>
 
 #include "aqua2/serialport.h"
+#include "aqua2/virtualserial.h"
 
+using namespace ssr::aqua2;
 
 int main(void) {
   std::cout << "libaqua2 / SerialPort test" << std::endl;
 
+  VirtualSerialPair pair(115200);
+  SerialPort& a = pair.first();
+  SerialPort& b = pair.second();
+  b.enableStatistics();
+
+  char buf[64];
+  if (a.write("hello", 5) != 5) return(1);
+  if (b.read(buf, 5, 1.0) != 5 || memcmp(buf, "hello", 5) != 0) {
+    std::cout << "read failed" << std::endl;
+    return(1);
+  }
+
+  /// timeout in seconds, not rounded to whole seconds
+  auto start = std::chrono::steady_clock::now();
+  if (b.read(buf, 1, 0.05) != -1 || std::chrono::steady_clock::now() - start > std::chrono::milliseconds(500)) {
+    std::cout << "read timeout failed" << std::endl;
+    return(1);
+  }
+
+  b.write("world", 5);
+  if (a.waitAvailable(5, 1.0) != 0 || a.read(buf, 5) != 5 || memcmp(buf, "world", 5) != 0) {
+    std::cout << "waitAvailable failed" << std::endl;
+    return(1);
+  }
+
+  a.write("line\r\n", 6);
+  if (b.readLine(buf, sizeof(buf)) != 6 || memcmp(buf, "line\r\n", 6) != 0) {
+    std::cout << "readLine failed" << std::endl;
+    return(1);
+  }
+
+  ByteBuffer src((size_t)3);
+  src[0] = 1; src[1] = 2; src[2] = 3;
+  write(b, src);
+  a.waitAvailable(3, 1.0);
+  ByteBuffer dst = read(a, 3);
+  if (!dst.available() || dst.size() != 3 || dst[2] != 3) {
+    std::cout << "functional interface failed" << std::endl;
+    return(1);
+  }
+
+  SerialPortStatistics stats = b.getStatistics();
+  if (stats.bytesRead != 5 + 6 || stats.bytesWritten != 5 + 3 || stats.readCalls != 1 + 6 ||
+      stats.readLatency.count != stats.readCalls || stats.waitLatency.count != 1 || stats.pollCalls == 0) {
+    std::cout << "statistics failed" << std::endl;
+    return(1);
+  }
+  if (b.getStatistics(60.0).timestamp != stats.timestamp) {
+    std::cout << "statistics rate limit failed" << std::endl;
+    return(1);
+  }
+  std::cout << "read p50 " << stats.readLatency.percentile(0.5) << " ns, line counters "
+	    << (stats.lineCountersAvailable ? "available" : "not available") << std::endl;
+
+  std::cout << "OK" << std::endl;
   return(0);
 }
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <cstring>
+#include <atomic>
+
+#include "aqua2/serialsupervisor.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+static bool waitFor(const std::function<bool()>& condition) {
+  for (int i = 0; i < 500; i++) {
+    if (condition()) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / SerialPortSupervisor test" << std::endl;
+
+  char dir[] = "/tmp/aqua2_supervisor_XXXXXX";
+  if (!mkdtemp(dir)) return(1);
+  const std::string link = std::string(dir) + "/by-id/usb-aqua2-test";
+
+  VirtualSerialPair* device = new VirtualSerialPair(115200);
+  mkdir((std::string(dir) + "/by-id").c_str(), 0755);
+  symlink(device->name(), link.c_str());
+
+  SerialPort port(link.c_str(), 115200);
+  SerialPortSupervisor supervisor(port);
+  std::atomic<int> connected(0), disconnected(0);
+  supervisor.addListener([&](SerialPort& /*port*/, const int event) {
+    if (event == SerialPortSupervisor::CONNECTED) connected++;
+    else disconnected++;
+  });
+  supervisor.start();
+
+  /// unplug: device and its by-id directory disappear
+  unlink(link.c_str());
+  rmdir((std::string(dir) + "/by-id").c_str());
+  delete device;
+  if (!waitFor([&]() { return disconnected == 1 && !port.available(); })) {
+    std::cout << "disconnect not detected" << std::endl;
+    return(1);
+  }
+
+  /// plug again
+  device = new VirtualSerialPair(115200);
+  mkdir((std::string(dir) + "/by-id").c_str(), 0755);
+  symlink(device->name(), link.c_str());
+  if (!waitFor([&]() { return connected == 1; })) {
+    std::cout << "reconnect not detected" << std::endl;
+    return(1);
+  }
+  supervisor.stop();
+
+  char buf[8];
+  device->first().write("back", 4);
+  if (port.read(buf, 4, 1.0) != 4 || memcmp(buf, "back", 4) != 0) {
+    std::cout << "reopened port does not work" << std::endl;
+    return(1);
+  }
+  std::cout << "reconnect time " << supervisor.getLastReconnectTime() * 1e3 << " ms, downtime "
+	    << supervisor.getLastDowntime() * 1e3 << " ms" << std::endl;
+
+  port.close();
+  delete device;
+  unlink(link.c_str());
+  rmdir((std::string(dir) + "/by-id").c_str());
+  rmdir(dir);
+  std::cout << "OK" << std::endl;
+  return(0);
+}
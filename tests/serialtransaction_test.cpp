@@ -0,0 +1,158 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include "aqua2/serialtransaction.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+/// Simulates devices on a bus.
+static void simulate(SerialPort& bus, std::atomic<bool>& running, const std::function<int(const ByteView&)>& frameLength,
+		     const std::function<void(const ByteView&, SerialPort&)>& respond) {
+  ByteBuffer buffer((size_t)1024);
+  size_t size = 0;
+  while (running) {
+    struct pollfd pfd;
+    pfd.fd = bus.getFileDescriptor();
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 10) <= 0) continue;
+    int ret = bus.read(buffer.data() + size, buffer.size() - size);
+    if (ret <= 0) continue;
+    size += ret;
+    size_t offset = 0;
+    while (offset < size) {
+      int length = frameLength(buffer.slice(offset, size - offset));
+      if (length == 0) break;
+      if (length < 0) { offset++; continue; }
+      respond(buffer.slice(offset, length), bus);
+      offset += length;
+    }
+    memmove(buffer.data(), buffer.data() + offset, size - offset);
+    size -= offset;
+  }
+}
+
+/// Devices 1, 2 and 3 respond. Other IDs do not respond.
+static void respondDynamixel(const ByteView& request, SerialPort& bus) {
+  const uint8_t inst = request[7];
+  const uint16_t length = request[10] | (request[11] << 8);
+  std::vector<uint8_t> ids;
+  if (inst == DynamixelProtocol2::INST_READ) {
+    ids.push_back(request[4]);
+  } else if (inst == DynamixelProtocol2::INST_SYNC_READ) {
+    ids.assign(request.data() + 12, request.data() + request.size() - 2);
+  }
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (ids[i] < 1 || ids[i] > 3) continue;
+    uint8_t params[64];
+    params[0] = 0; // error
+    for (int j = 0; j < length; j++) params[1 + j] = ids[i];
+    ByteBuffer status = DynamixelProtocol2::packet(ids[i], DynamixelProtocol2::INST_STATUS, params, 1 + length);
+    bus.write(status.data(), status.size());
+  }
+}
+
+/// Modbus requests used in this test are 8 bytes. Only device 1 responds.
+static int modbusRequestLength(const ByteView& data) {
+  return data.size() < 8 ? 0 : 8;
+}
+
+static void respondModbus(const ByteView& request, SerialPort& bus) {
+  if (request[0] != 1 || request[1] != 0x03) return;
+  const uint8_t pdu[] = {1, 0x03, 4, 0x12, 0x34, 0x56, 0x78};
+  ByteBuffer response = ModbusRtuProtocol::frame(pdu, sizeof(pdu));
+  bus.write(response.data(), response.size());
+}
+
+int main(void) {
+  std::cout << "libaqua2 / SerialTransactionScheduler test" << std::endl;
+
+  {
+    VirtualSerialPair pair(1000000);
+    std::atomic<bool> running(true);
+    DynamixelProtocol2 protocol;
+    std::thread device([&]() {
+      simulate(pair.first(), running, [&](const ByteView& data) { return protocol.frameLength(data); }, respondDynamixel);
+    });
+
+    SerialTransactionScheduler scheduler(pair.second(), protocol);
+    scheduler.setResponseTimeout(0.05);
+    scheduler.setMaxBatch(8);
+    int done = 0;
+    for (uint8_t id = 1; id <= 4; id++) {
+      scheduler.enqueue(DynamixelProtocol2::read(id, 132, 4), [&](const SerialTransaction& t) {
+	if (t.status == SerialTransaction::DONE && t.response[4] == t.id && t.response[9] == t.id) done++;
+      });
+    }
+    size_t completed = scheduler.run();
+    running = false;
+    device.join();
+    if (completed != 3 || done != 3 || scheduler.getNumFrames() != 1 || scheduler.statistics().at(4).timeouts != 1) {
+      std::cout << "sync read failed (completed=" << completed << ", frames=" << scheduler.getNumFrames() << ")" << std::endl;
+      return(1);
+    }
+    for (int id = 1; id <= 3; id++) {
+      std::cout << "id " << id << " latency " << scheduler.statistics().at(id).averageLatency() * 1e6 << " us" << std::endl;
+    }
+  }
+
+  {
+    VirtualSerialPair pair(115200);
+    std::atomic<bool> running(true);
+    std::thread device([&]() { simulate(pair.first(), running, modbusRequestLength, respondModbus); });
+
+    ModbusRtuProtocol protocol;
+    SerialTransactionScheduler scheduler(pair.second(), protocol);
+    scheduler.setResponseTimeout(0.05);
+    scheduler.setMaxBatch(8);
+    ByteBuffer response(false);
+    scheduler.enqueue(ModbusRtuProtocol::readHoldingRegisters(1, 0, 2), [&](const SerialTransaction& t) { response = t.response; });
+    scheduler.enqueue(ModbusRtuProtocol::readHoldingRegisters(2, 0, 2));
+    scheduler.enqueue(ModbusRtuProtocol::writeSingleRegister(ModbusRtuProtocol::BROADCAST_ID, 0, 1));
+    size_t completed = scheduler.run();
+    running = false;
+    device.join();
+    if (completed != 2 || scheduler.getNumFrames() != 3 || !response.available() || response[3] != 0x12 ||
+	scheduler.statistics().at(2).timeouts != 1) {
+      std::cout << "modbus failed (completed=" << completed << ", frames=" << scheduler.getNumFrames() << ")" << std::endl;
+      return(1);
+    }
+  }
+
+  /// over the 256 bytes of a Modbus-RTU frame
+  {
+    uint8_t pdu[ModbusRtuProtocol::MAX_PDU_SIZE + 1] = {1, 0x10};
+    bool refused = false;
+    try {
+      ModbusRtuProtocol::frame(pdu, sizeof(pdu));
+    } catch (SerialTransactionException& ex) {
+      refused = true;
+    }
+    if (ModbusRtuProtocol::frame(pdu, sizeof(pdu) - 1).size() != sizeof(pdu) + 1 || !refused) {
+      std::cout << "frame size limit failed" << std::endl;
+      return(1);
+    }
+  }
+
+  /// requests too short to carry a slave ID are not queued
+  {
+    VirtualSerialPair pair(115200);
+    ModbusRtuProtocol protocol;
+    SerialTransactionScheduler scheduler(pair.second(), protocol);
+    const uint8_t shortRequest[] = {1, 0x03, 0x00};
+    bool refused = false;
+    try {
+      scheduler.enqueue(ByteView(shortRequest, sizeof(shortRequest)));
+    } catch (SerialTransactionException& ex) {
+      refused = true;
+    }
+    if (!refused || scheduler.getQueueSize() != 0) {
+      std::cout << "short request was queued" << std::endl;
+      return(1);
+    }
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
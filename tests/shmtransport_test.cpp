@@ -0,0 +1,108 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <sys/wait.h>
+
+#include "aqua2/shmtransport.h"
+
+using namespace ssr::aqua2;
+
+int main(void) {
+  std::cout << "libaqua2 / ShmTransport test" << std::endl;
+
+  const std::string name = "/aqua2_test_" + std::to_string(getpid());
+  {
+    ShmPublisher pub(name, 64, 4);
+    pub.write("old", 3);
+
+    /// subscribers see messages published after they are opened
+    ShmSubscriber a(name), b(name);
+    if (a.available() != 0 || a.getSlotSize() != 64) return(1);
+
+    /// in place write, zero-copy read by every subscriber
+    char* p = (char*)pub.allocate();
+    memcpy(p, "hello", 5);
+    pub.commit(5);
+    uint32_t size;
+    const char* r = (const char*)a.receive(size);
+    if (!r || size != 5 || memcmp(r, "hello", 5) != 0 || (void*)r == (void*)p || !a.release()) {
+      std::cout << "zero-copy receive failed" << std::endl;
+      return(1);
+    }
+    if (a.receive(size) != nullptr) return(1);
+    char buf[80];
+    if (b.getSizeInRxBuffer() != 5 || b.read(buf, sizeof(buf)) != 5 || memcmp(buf, "hello", 5) != 0) return(1);
+
+    /// slow subscriber loses the oldest, the publisher never waits
+    for (int i = 0; i < 10; i++) pub.write(&i, sizeof(i));
+    int value = -1;
+    if (a.read(&value, sizeof(value)) != sizeof(int) || value != 7 || a.getLostMessages() != 7) {
+      std::cout << "overrun failed" << std::endl;
+      return(1);
+    }
+    while (a.read(&value, sizeof(value)) > 0) ;
+    if (value != 9) return(1);
+
+    /// message overwritten while it is in use is reported by release()
+    pub.write("x", 1);
+    if (!a.receive(size)) return(1);
+    for (int i = 0; i < 4; i++) pub.write("y", 1);
+    if (a.release()) {
+      std::cout << "overwrite in use not detected" << std::endl;
+      return(1);
+    }
+    if (pub.write(buf, 65) != -1) return(1);
+
+    /// wait() times out, then is woken up by a publisher thread
+    ShmSubscriber c(name);
+    const auto start = std::chrono::steady_clock::now();
+    if (c.wait(20)) return(1);
+    if (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20)) return(1);
+    std::thread thread([&]() {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	pub.write("wake", 4);
+      });
+    const bool woken = c.wait(2000);
+    thread.join();
+    if (!woken || c.read(buf, sizeof(buf)) != 4) {
+      std::cout << "futex wake up failed" << std::endl;
+      return(1);
+    }
+  }
+
+  /// publisher unlinks the name
+  try {
+    ShmSubscriber gone(name);
+    std::cout << "segment not unlinked" << std::endl;
+    return(1);
+  } catch (ShmException& ex) {
+  }
+
+  /// memfd segment shared with a child process
+  {
+    ShmPublisher pub("", 64, 16);
+    ShmSubscriber sub(pub.getFileDescriptor());
+    const pid_t pid = fork();
+    if (pid == 0) {
+      int sum = 0, value;
+      sub.setBusyPoll(10000);
+      while (sum < 6 && sub.wait(2000)) {
+	while (sub.read(&value, sizeof(value)) > 0) sum += value;
+      }
+      _exit(sum == 6 ? 0 : 1);
+    }
+    for (int i = 1; i <= 3; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      pub.write(&i, sizeof(i));
+    }
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cout << "memfd across fork failed" << std::endl;
+      return(1);
+    }
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <cstring>
+
+#include "aqua2/serversocket.h"
+
+using namespace ssr::aqua2;
+
+int main(void) {
+  std::cout << "libaqua2 / Socket test" << std::endl;
+
+  ServerSocket server;
+  server.bind(0);
+  server.listen();
+
+  /// no client yet
+  try {
+    server.accept(10000);
+    std::cout << "accept did not time out" << std::endl;
+    return(1);
+  } catch (TimeoutException& ex) {
+  }
+
+  Socket client("127.0.0.1", server.getPort());
+  Socket peer = server.accept(1000000);
+  if (!client.okay() || !peer.okay()) return(1);
+
+  char buf[64];
+  if (client.write("hello", 5) != 5) return(1);
+  if (peer.read(buf, 5, 1.0) != 5 || memcmp(buf, "hello", 5) != 0) {
+    std::cout << "read failed" << std::endl;
+    return(1);
+  }
+  peer.write("world", 5);
+  if (client.waitAvailable(5, 1.0) != 0 || client.getSizeInRxBuffer() != 5 || client.read(buf, sizeof(buf)) != 5) {
+    std::cout << "waitAvailable failed" << std::endl;
+    return(1);
+  }
+
+  /// closed by peer: end of stream
+  client.close();
+  if (peer.read(buf, sizeof(buf)) != 0) {
+    std::cout << "close not detected" << std::endl;
+    return(1);
+  }
+  peer.close();
+
+  /// nobody listens on a closed server's port
+  const int port = server.getPort();
+  server.close();
+  try {
+    Socket refused("127.0.0.1", port);
+    std::cout << "connect to closed port succeeded" << std::endl;
+    return(1);
+  } catch (SocketException& ex) {
+  }
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
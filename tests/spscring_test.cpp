@@ -0,0 +1,51 @@
+#include <iostream>
+#include <thread>
+#include <stdint.h>
+
+#include "aqua2/spscring.h"
+
+using namespace ssr::aqua2;
+
+int main(void) {
+  std::cout << "libaqua2 / SpscRing test" << std::endl;
+
+  SpscRing<uint64_t, 8> small;
+  for (uint64_t i = 0; i < 8; i++) small.push(i);
+  if (small.push(8) || small.size() != 8 || small.peek(3).size() != 3 || small.peek()[7] != 7) {
+    std::cout << "capacity check failed" << std::endl;
+    return(1);
+  }
+  small.consume(3);
+  uint64_t v;
+  if (!small.pop(v) || v != 3 || !small.push(8) || small.peek()[4] != 8) {
+    std::cout << "wrap around failed" << std::endl;
+    return(1);
+  }
+
+  /// one producer, one consumer, every item arrives once and in order
+  static SpscRing<uint64_t, 256> ring;
+  const uint64_t count = 1000000;
+  std::thread producer([&]() {
+    for (uint64_t i = 0; i < count;) {
+      if (ring.push(i)) i++;
+      else std::this_thread::yield();
+    }
+  });
+  uint64_t expected = 0;
+  while (expected < count) {
+    SpscRing<uint64_t, 256>::View view = ring.peek();
+    for (SpscRing<uint64_t, 256>::View::iterator it = view.begin(); it != view.end(); ++it) {
+      if (*it != expected++) {
+	std::cout << "out of order " << *it << std::endl;
+	producer.join();
+	return(1);
+      }
+    }
+    ring.consume(view.size());
+    if (view.empty()) std::this_thread::yield();
+  }
+  producer.join();
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
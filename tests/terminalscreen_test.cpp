@@ -0,0 +1,80 @@
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+
+#include "aqua2/terminalscreen.h"
+
+using namespace ssr::aqua2;
+
+static std::string drain(const int fd) {
+  std::string s;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) s.append(buf, n);
+  return s;
+}
+
+int main(void) {
+  std::cout << "libaqua2 / TerminalScreen test" << std::endl;
+
+  int fds[2];
+  if (pipe(fds) != 0) return(1);
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  const int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return(1);
+  const int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0) return(1);
+  struct termios before;
+  tcgetattr(slave, &before);
+  {
+    TerminalScreen screen(fds[1], slave, 10, 3);
+    struct termios raw;
+    tcgetattr(slave, &raw);
+    if (raw.c_lflag & (ECHO | ICANON)) return(1);
+
+    /// first frame: alternate screen, clear and the text
+    screen.print(1, 0, "ab");
+    if (screen.present() <= 0) return(1);
+    if (drain(fds[0]) != "\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J\x1b[1;2H\x1b[0mab") {
+      std::cout << "first frame failed" << std::endl;
+      return(1);
+    }
+
+    /// unchanged frame costs nothing
+    const uint64_t writes = screen.getWrites();
+    screen.clear();
+    screen.print(1, 0, "ab");
+    if (screen.present() != 0 || screen.getWrites() != writes) {
+      std::cout << "unchanged frame was written" << std::endl;
+      return(1);
+    }
+
+    /// only changed cells, short gaps are rewritten instead of moving cursor
+    screen.print(1, 0, "xbc");
+    screen.put(9, 2, 0x00B0, TerminalStyle(TerminalStyle::RED, TerminalStyle::DEFAULT, TerminalStyle::BOLD));
+    screen.present();
+    if (drain(fds[0]) != "\x1b[1;2H\x1b[0mxbc\x1b[3;10H\x1b[0;1;31m\xC2\xB0" || screen.getWrites() != writes + 1) {
+      std::cout << "diff failed" << std::endl;
+      return(1);
+    }
+
+    screen.invalidate();
+    if (drain(fds[0]) != "" || screen.present() <= 0 || drain(fds[0]).find("\x1b[2J") == std::string::npos) return(1);
+  }
+  if (drain(fds[0]) != "\x1b[0m\x1b[?25h\x1b[?1049l") {
+    std::cout << "screen not restored" << std::endl;
+    return(1);
+  }
+  struct termios after;
+  tcgetattr(slave, &after);
+  if (after.c_lflag != before.c_lflag) {
+    std::cout << "termios not restored" << std::endl;
+    return(1);
+  }
+  close(slave);
+  close(master);
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <sys/socket.h>
+
+#include "aqua2/serialport.h"
+#include "aqua2/socket.h"
+#include "aqua2/virtualserial.h"
+
+using namespace ssr::aqua2;
+
+int main(void) {
+  std::cout << "libaqua2 / WaitStrategy test" << std::endl;
+
+  VirtualSerialPair serial(115200);
+  SerialPort& a = serial.first();
+  SerialPort& b = serial.second();
+  char buf[16];
+
+  /// park at once: timeout, then woken up by a writer thread
+  WaitStrategy park;
+  b.setWaitStrategy(&park);
+  if (b.getWaitStrategy() != &park) return(1);
+  if (b.waitAvailable(1, 0.02) != -2 || b.read(buf, 1, 0.02) != -1) return(1);
+  std::thread writer([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      a.write("abc", 3);
+    });
+  if (b.read(buf, 3, 2.0) != 3 || memcmp(buf, "abc", 3) != 0) {
+    std::cout << "park read failed" << std::endl;
+    return(1);
+  }
+  writer.join();
+  WaitStatistics s = park.snapshot();
+  if (s.waits != 3 || s.timeouts != 2 || s.parked != 3 || s.spun != 0 || s.parkWait.count != 1) {
+    std::cout << "park statistics failed" << std::endl;
+    return(1);
+  }
+
+  /// spin long enough: satisfied without sleeping
+  WaitStrategy spin(200000000ULL, 0);
+  b.setWaitStrategy(&spin);
+  writer = std::thread([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      a.write("de", 2);
+    });
+  if (b.read(buf, 2, 2.0) != 2 || memcmp(buf, "de", 2) != 0) return(1);
+  writer.join();
+  s = spin.snapshot();
+  if (s.spun != 1 || s.parked != 0 || s.spinWait.count != 1) {
+    std::cout << "spin statistics failed" << std::endl;
+    return(1);
+  }
+
+  /// fewer bytes than requested: waits for the rest
+  WaitStrategy hybrid(10000);
+  b.setWaitStrategy(&hybrid);
+  writer = std::thread([&]() {
+      a.write("f", 1);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      a.write("gh", 2);
+    });
+  if (b.read(buf, 3, 2.0) != 3 || memcmp(buf, "fgh", 3) != 0) return(1);
+  writer.join();
+  a.write("line\r\n", 6);
+  if (b.readLine(buf, sizeof(buf)) != 6) return(1);
+
+  /// Socket: closed peer fails the wait instead of spinning
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return(1);
+  struct sockaddr_in addr;
+  Socket socket(fds[0], addr);
+  WaitStrategy socketWait(50000);
+  socket.setWaitStrategy(&socketWait);
+  if (::send(fds[1], "xyz", 3, 0) != 3) return(1);
+  if (socket.read(buf, 3, 1.0) != 3 || memcmp(buf, "xyz", 3) != 0) return(1);
+  if (socket.waitAvailable(1, 0.01) != -2) return(1);
+  /// hang up while parked with fewer bytes than requested
+  if (::send(fds[1], "x", 1, 0) != 1) return(1);
+  writer = std::thread([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ::close(fds[1]);
+    });
+  const auto start = std::chrono::steady_clock::now();
+  const int r = socket.waitAvailable(3, 2.0);
+  writer.join();
+  if (r != -1 || socketWait.snapshot().errors != 1 || std::chrono::steady_clock::now() - start > std::chrono::seconds(1)) {
+    std::cout << "socket hang up failed" << std::endl;
+    return(1);
+  }
+  if (socket.read(buf, 1) != 1 || socket.waitAvailable(1, 1.0) != -1 || socketWait.snapshot().errors != 2) return(1);
+  socket.setWaitStrategy(nullptr);
+  if (socket.waitAvailable(1, 1.0) != -1) return(1);
+  ::close(fds[0]);
+
+  std::cout << "OK" << std::endl;
+  return(0);
+}